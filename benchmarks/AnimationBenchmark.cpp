@@ -0,0 +1,260 @@
+// cpu cost of animation playback: CesiumMan, then a synthetic clip of 10k keys per channel played forwards and
+// seeked at random, against the linear keyframe scan playback used before the cursors. both clips are also played
+// compressed, with their memory and largest pose error against the source. last, a crowd of independently playing
+// instances of the gltf, on one thread and spread over a ThreadPool.
+// run from the build directory so the default asset path resolves, or pass a gltf path
+
+#define CGLTF_IMPLEMENTATION
+
+#include "AnimationClip.h"
+#include "ThreadPool.h"
+
+#include <chrono>
+#include <cmath>
+#include <iostream>
+#include <random>
+#include <vector>
+
+constexpr int FRAME_COUNT = 100000;
+constexpr float FRAME_TIME = 1.f / 60.f;
+constexpr uint32_t SYNTHETIC_KEY_COUNT = 10000;
+constexpr float SYNTHETIC_KEY_TIME = 1.f / 30.f;
+constexpr uint32_t CROWD_SIZE = 500;
+constexpr int CROWD_FRAME_COUNT = 1000;
+constexpr int ERROR_FRAME_COUNT = 10000;
+
+// keeps the compiler from dropping the work being measured
+static float checksum = 0.f;
+
+static std::vector<std::shared_ptr<Node> > makeNodes(size_t count) {
+    std::vector<std::shared_ptr<Node> > nodes;
+    for (size_t node_i = 0; node_i < count; node_i++) {
+        nodes.push_back(std::make_shared<Node>());
+    }
+    return nodes;
+}
+
+// the keyframe search playback did before cursors
+static uint32_t findKeyframeLinear(std::span<const float> inputs, float time) {
+    for (size_t key = 0; key + 1 < inputs.size(); key++) {
+        if (time < inputs[key + 1]) {
+            return static_cast<uint32_t>(key);
+        }
+    }
+    return static_cast<uint32_t>(inputs.size() - 1);
+}
+
+template<typename Function>
+static double nanosecondsPer(int iterations, Function &&function) {
+    auto start = std::chrono::steady_clock::now();
+    for (int iteration = 0; iteration < iterations; iteration++) {
+        function(iteration);
+    }
+    return std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count() / iterations;
+}
+
+static double playbackNanoseconds(const std::vector<Animation> &animations,
+                                 const std::vector<std::shared_ptr<Node> > &nodes) {
+    std::vector<AnimationState> states(animations.size());
+    Pose pose = AnimationClip::restPose(nodes);
+    return nanosecondsPer(FRAME_COUNT, [&](int) {
+        for (size_t animation_i = 0; animation_i < animations.size(); animation_i++) {
+            AnimationClip::play(animations[animation_i], states[animation_i], FRAME_TIME, pose);
+        }
+        checksum += pose.translations.front().x;
+    });
+}
+
+static void benchmarkPlayback(const char *name, const std::vector<Animation> &animations,
+                              const std::vector<std::shared_ptr<Node> > &nodes) {
+    size_t channelCount = 0;
+    for (const auto &animation: animations) {
+        channelCount += animation.channels.size();
+    }
+
+    double cursor = playbackNanoseconds(animations, nodes);
+
+    double linear = nanosecondsPer(FRAME_COUNT, [&](int frame) {
+        float time = static_cast<float>(frame) * FRAME_TIME;
+        for (const auto &animation: animations) {
+            float clipTime = animation.end > 0.f ? std::fmod(time, animation.end) : 0.f;
+            for (const auto &channel: animation.channels) {
+                const AnimationSampler &sampler = animation.samplers[channel.samplerIndex];
+                checksum += static_cast<float>(findKeyframeLinear(sampler.inputs, clipTime));
+            }
+        }
+    });
+
+    std::cout << name << ": " << channelCount << " channels, " << cursor << " ns per frame with cursors, "
+              << linear << " ns per frame for the linear keyframe search alone" << std::endl;
+}
+
+// compressed copies of the clips against the source ones, played side by side
+static void benchmarkCompression(const char *name, const std::vector<Animation> &animations,
+                                 const std::vector<std::shared_ptr<Node> > &nodes) {
+    std::vector<Animation> compressed = animations;
+    size_t rawSize = 0;
+    size_t compressedSize = 0;
+    for (auto &animation: compressed) {
+        rawSize += AnimationClip::memorySize(animation);
+        AnimationClip::compress(animation);
+        compressedSize += AnimationClip::memorySize(animation);
+    }
+
+    float translationError = 0.f;
+    float rotationError = 0.f;
+    float scaleError = 0.f;
+    for (size_t animation_i = 0; animation_i < animations.size(); animation_i++) {
+        AnimationState rawState;
+        AnimationState compressedState;
+        Pose rawPose = AnimationClip::restPose(nodes);
+        Pose compressedPose = rawPose;
+        for (int frame = 0; frame < ERROR_FRAME_COUNT; frame++) {
+            AnimationClip::play(animations[animation_i], rawState, FRAME_TIME, rawPose);
+            AnimationClip::play(compressed[animation_i], compressedState, FRAME_TIME, compressedPose);
+
+            for (size_t node_i = 0; node_i < nodes.size(); node_i++) {
+                glm::quat a = rawPose.rotations[node_i];
+                glm::quat b = compressedPose.rotations[node_i];
+                translationError = std::max(translationError, glm::length(rawPose.translations[node_i] -
+                                                                          compressedPose.translations[node_i]));
+                rotationError = std::max(rotationError, 2.f * glm::length(glm::dot(a, b) < 0.f ? a + b : a - b));
+                scaleError = std::max(scaleError, glm::length(rawPose.scales[node_i] - compressedPose.scales[node_i]));
+            }
+        }
+    }
+
+    double raw = playbackNanoseconds(animations, nodes);
+    double packed = playbackNanoseconds(compressed, nodes);
+
+    std::cout << name << " compressed: " << rawSize << " to " << compressedSize << " bytes, " << raw << " to "
+              << packed << " ns per frame, largest error " << translationError << " translation, " << rotationError
+              << " rad rotation, " << scaleError << " scale" << std::endl;
+}
+
+// every instance plays the first clip from its own start time, as the renderer does per render object
+static void benchmarkCrowd(const Animation &animation, const std::vector<std::shared_ptr<Node> > &nodes) {
+    std::mt19937 random(3);
+    std::uniform_real_distribution<float> distribution(0.f, std::max(animation.end, 0.f));
+
+    std::vector<AnimationState> states(CROWD_SIZE);
+    std::vector<Pose> poses(CROWD_SIZE, AnimationClip::restPose(nodes));
+    for (auto &state: states) {
+        state.time = distribution(random);
+    }
+
+    auto playInstance = [&](size_t instance_i) {
+        AnimationClip::play(animation, states[instance_i], FRAME_TIME, poses[instance_i]);
+    };
+
+    double serial = nanosecondsPer(CROWD_FRAME_COUNT, [&](int) {
+        for (size_t instance_i = 0; instance_i < CROWD_SIZE; instance_i++) {
+            playInstance(instance_i);
+        }
+    });
+
+    ThreadPool threadPool;
+    double parallel = nanosecondsPer(CROWD_FRAME_COUNT, [&](int) {
+        threadPool.parallelFor(CROWD_SIZE, playInstance);
+    });
+
+    for (const Pose &pose: poses) {
+        checksum += pose.translations.front().x;
+    }
+
+    std::cout << "crowd of " << CROWD_SIZE << ": " << serial / 1000.0 << " us per frame on one thread, "
+              << parallel / 1000.0 << " us per frame on " << threadPool.threadCount() << " threads" << std::endl;
+}
+
+static bool benchmarkGltf(const char *path) {
+    cgltf_options options = {};
+    cgltf_data *data = nullptr;
+    if (cgltf_parse_file(&options, path, &data) != cgltf_result_success) {
+        std::cerr << "Failed to load GLTF file: " << path << std::endl;
+        return false;
+    }
+    if (cgltf_load_buffers(&options, data, path) != cgltf_result_success) {
+        std::cerr << "Failed to load buffers from file: " << path << std::endl;
+        cgltf_free(data);
+        return false;
+    }
+
+    std::vector<std::shared_ptr<Node> > nodes = makeNodes(data->nodes_count);
+    std::vector<Animation> animations;
+    for (size_t animation_i = 0; animation_i < data->animations_count; animation_i++) {
+        animations.push_back(AnimationClip::parse(data, &data->animations[animation_i]));
+        AnimationClip::validate(animations.back(), nodes.size());
+    }
+    cgltf_free(data);
+
+    if (animations.empty()) {
+        std::cerr << path << " has no animations" << std::endl;
+        return false;
+    }
+
+    benchmarkPlayback(path, animations, nodes);
+    benchmarkCompression(path, animations, nodes);
+    benchmarkCrowd(animations.front(), nodes);
+    return true;
+}
+
+static Animation makeSyntheticClip() {
+    Animation animation = {};
+    animation.name = "synthetic";
+
+    std::mt19937 random(1);
+    std::uniform_real_distribution<float> distribution(-1.f, 1.f);
+
+    AnimationChannel::Path paths[3] = {AnimationChannel::eTranslation, AnimationChannel::eRotation,
+                                       AnimationChannel::eScale};
+    for (uint32_t path_i = 0; path_i < 3; path_i++) {
+        AnimationSampler sampler = {};
+        sampler.interpolation = AnimationSampler::eLinear;
+        for (uint32_t key = 0; key < SYNTHETIC_KEY_COUNT; key++) {
+            glm::vec4 value(distribution(random), distribution(random), distribution(random), distribution(random));
+            sampler.inputs.push_back(static_cast<float>(key) * SYNTHETIC_KEY_TIME);
+            sampler.outputs.push_back(paths[path_i] == AnimationChannel::eRotation ? glm::normalize(value) : value);
+        }
+        animation.samplers.push_back(std::move(sampler));
+        animation.channels.push_back({paths[path_i], 0, path_i});
+    }
+
+    animation.start = 0.f;
+    animation.end = animation.samplers.front().inputs.back();
+    return animation;
+}
+
+static void benchmarkSeeks(const Animation &animation) {
+    const std::vector<float> &inputs = animation.samplers.front().inputs;
+
+    std::mt19937 random(2);
+    std::uniform_real_distribution<float> distribution(animation.start, animation.end);
+    std::vector<float> times(FRAME_COUNT);
+    for (float &time: times) {
+        time = distribution(random);
+    }
+
+    uint32_t cursor = 0;
+    double binary = nanosecondsPer(FRAME_COUNT, [&](int frame) {
+        checksum += static_cast<float>(AnimationClip::findKeyframe(inputs, times[frame], cursor));
+    });
+
+    double linear = nanosecondsPer(FRAME_COUNT, [&](int frame) {
+        checksum += static_cast<float>(findKeyframeLinear(inputs, times[frame]));
+    });
+
+    std::cout << "random seeks over " << inputs.size() << " keys: " << binary << " ns per lookup with cursors, "
+              << linear << " ns per lookup with the linear search" << std::endl;
+}
+
+int main(int argc, char **argv) {
+    const char *path = argc > 1 ? argv[1] : "assets/models/cesium_man/CesiumMan.gltf";
+    benchmarkGltf(path);
+
+    std::vector<Animation> synthetic = {makeSyntheticClip()};
+    benchmarkPlayback("synthetic", synthetic, makeNodes(1));
+    benchmarkCompression("synthetic", synthetic, makeNodes(1));
+    benchmarkSeeks(synthetic.front());
+
+    std::cout << "checksum " << checksum << std::endl;
+}
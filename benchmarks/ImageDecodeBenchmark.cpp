@@ -0,0 +1,146 @@
+// cpu cost of decoding a gltf's images the way GltfScene::parseImages does: on the calling thread alone, then
+// spread over ThreadPools so the calling thread and its helpers make 2, 4, ... and all hardware threads.
+// with --encode every image is also BC7 encoded, as a load with compressTextures and a cold texture_cache does
+// (the loader picks BC5/BC4 for normal and single channel maps). image files are read into memory up front, so
+// only decoding is timed. run from the build directory so the default Sponza path resolves, or pass a gltf path
+
+#define CGLTF_IMPLEMENTATION
+#define STB_IMAGE_IMPLEMENTATION
+
+#include <cgltf.h>
+#include <stb_image.h>
+
+#include "TextureEncoder.h"
+#include "ThreadPool.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <vector>
+
+// keeps the compiler from dropping the work being measured
+static std::atomic<size_t> checksum = 0;
+
+// the encoded bytes of every image that has them, from a file next to the gltf or a buffer view
+static std::vector<std::vector<unsigned char> > readImages(const cgltf_data *data,
+                                                           const std::filesystem::path &directory) {
+    std::vector<std::vector<unsigned char> > images;
+    for (size_t image_i = 0; image_i < data->images_count; image_i++) {
+        const cgltf_image &image = data->images[image_i];
+        std::vector<unsigned char> bytes;
+
+        if (image.uri && strncmp(image.uri, "data:", 5) != 0) {
+            std::string uri = image.uri;
+            uri.resize(cgltf_decode_uri(uri.data()));
+            std::ifstream file(directory / uri, std::ios::binary);
+            bytes.assign(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+        } else if (image.buffer_view && image.buffer_view->buffer->data) {
+            const auto *buffer = static_cast<const unsigned char *>(image.buffer_view->buffer->data);
+            bytes.assign(buffer + image.buffer_view->offset,
+                         buffer + image.buffer_view->offset + image.buffer_view->size);
+        }
+
+        if (bytes.empty()) {
+            std::cerr << "Skipping image " << image_i << ", only files and buffer views are read" << std::endl;
+            continue;
+        }
+        images.push_back(std::move(bytes));
+    }
+    return images;
+}
+
+static void decode(const std::vector<unsigned char> &bytes, bool encode, ThreadPool *threadPool) {
+    int width;
+    int height;
+    int numChannels;
+    unsigned char *pixels = stbi_load_from_memory(bytes.data(), static_cast<int>(bytes.size()), &width, &height,
+                                                  &numChannels, 4);
+    if (!pixels) {
+        return;
+    }
+
+    if (encode) {
+        EncodedTexture encoded = encodeTexture(pixels, width, height, TextureEncoding::eColor, threadPool);
+        checksum += encoded.data.size();
+    } else {
+        checksum += pixels[0];
+    }
+    stbi_image_free(pixels);
+}
+
+// milliseconds to decode every image with threadCount threads, the calling one included
+static double decodeMilliseconds(const std::vector<std::vector<unsigned char> > &images, bool encode,
+                                 uint32_t threadCount) {
+    // started before timing, so only decoding is measured
+    std::unique_ptr<ThreadPool> threadPool = threadCount > 1 ? std::make_unique<ThreadPool>(threadCount - 1)
+                                                             : nullptr;
+
+    auto start = std::chrono::steady_clock::now();
+    if (threadPool) {
+        threadPool->parallelFor(images.size(), [&](size_t image_i) {
+            decode(images[image_i], encode, threadPool.get());
+        });
+    } else {
+        for (const auto &bytes: images) {
+            decode(bytes, encode, nullptr);
+        }
+    }
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+int main(int argc, char **argv) {
+    const char *path = "assets/models/Sponza/glTF/Sponza.gltf";
+    bool encode = false;
+    for (int arg_i = 1; arg_i < argc; arg_i++) {
+        if (strcmp(argv[arg_i], "--encode") == 0) {
+            encode = true;
+        } else {
+            path = argv[arg_i];
+        }
+    }
+
+    cgltf_options options = {};
+    cgltf_data *data = nullptr;
+    if (cgltf_parse_file(&options, path, &data) != cgltf_result_success) {
+        std::cerr << "Failed to load GLTF file: " << path << std::endl;
+        return 1;
+    }
+    if (cgltf_load_buffers(&options, data, path) != cgltf_result_success) {
+        std::cerr << "Failed to load buffers from file: " << path << std::endl;
+        cgltf_free(data);
+        return 1;
+    }
+
+    std::vector<std::vector<unsigned char> > images = readImages(data, std::filesystem::path(path).parent_path());
+    cgltf_free(data);
+    if (images.empty()) {
+        std::cerr << path << " has no images" << std::endl;
+        return 1;
+    }
+
+    uint32_t hardwareThreads = std::max(std::thread::hardware_concurrency(), 1u);
+    std::vector<uint32_t> threadCounts;
+    for (uint32_t threadCount = 1; threadCount < hardwareThreads; threadCount *= 2) {
+        threadCounts.push_back(threadCount);
+    }
+    threadCounts.push_back(hardwareThreads);
+
+    double serial = 0.0;
+    for (uint32_t threadCount: threadCounts) {
+        double milliseconds = decodeMilliseconds(images, encode, threadCount);
+        if (threadCount == 1) {
+            serial = milliseconds;
+        }
+        std::cout << images.size() << " images" << (encode ? " decoded and encoded" : " decoded") << " on "
+                  << threadCount << " threads: " << milliseconds << " ms, " << serial / milliseconds << "x speedup"
+                  << std::endl;
+    }
+
+    std::cout << "checksum " << checksum.load() << std::endl;
+}
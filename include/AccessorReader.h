@@ -0,0 +1,11 @@
+#pragma once
+
+#include <cgltf.h>
+#include <glm/glm.hpp>
+
+#include <vector>
+
+// decodes a gltf accessor to floats. float, and the KHR_mesh_quantization int8/int16 types, normalized or not,
+// are read by readers specialized per component type and count. every element is widened to a vec4 with the
+// components the accessor doesn't have set to 0. returns false for matrix or unknown component types
+bool readAccessor(const cgltf_accessor *accessor, std::vector<glm::vec4> &out);
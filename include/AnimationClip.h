@@ -0,0 +1,87 @@
+#pragma once
+
+#include <cgltf.h>
+
+#include <cstdint>
+#include <memory>
+#include <span>
+#include <vector>
+
+#include "VulkanTypes.h"
+
+// playback of one instance. clips are shared between instances and never written while playing
+struct AnimationState {
+    uint32_t clip = 0;
+    float time = 0.f;
+    float speed = 1.f; // negative plays backwards
+    std::vector<uint32_t> cursors; // last keyframe of every sampler of the clip, see AnimationClip::findKeyframe
+};
+
+// what playback writes for one instance, indexed like the scene's nodes
+struct Pose {
+    // nodeFlags bits. play sets eLocalChanged, GltfScene::computeWorldTransforms uses the others and clears them all
+    enum NodeFlags : uint8_t {
+        eLocalChanged = 1,
+        eSubtreeChanged = 2, // the node or one of its descendants has eLocalChanged
+        eWorldChanged = 4,
+    };
+
+    std::vector<glm::vec3> translations;
+    std::vector<glm::quat> rotations;
+    std::vector<glm::vec3> scales;
+    std::vector<float> weights; // node i's morph weights are [weightOffsets[i], weightOffsets[i + 1])
+    std::vector<uint32_t> weightOffsets;
+    std::vector<glm::mat4> localTransforms;
+    std::vector<glm::mat4> worldTransforms;
+
+    std::vector<uint8_t> nodeFlags;
+    std::vector<uint32_t> changedNodes; // every node with eLocalChanged, nothing to update when empty
+};
+
+// parsing, load time validation and playback of Animation clips. playback assumes clips that passed validate
+namespace AnimationClip {
+    // a frame rarely moves further than this many keyframes, anything beyond is a binary search
+    constexpr uint32_t MAX_CURSOR_STEPS = 4;
+
+    // furthest compress lets playback drift from the source clip: scene units, radians and scale factor
+    constexpr float TRANSLATION_TOLERANCE = 1e-4f;
+    constexpr float ROTATION_TOLERANCE = 5e-4f;
+    constexpr float SCALE_TOLERANCE = 1e-4f;
+
+    // cubic splines are baked to linear keys at their own key rate, kept within these bounds in seconds
+    constexpr float MIN_BAKE_FRAME_TIME = 1.f / 120.f;
+    constexpr float MAX_BAKE_FRAME_TIME = 1.f / 30.f;
+
+    Animation parse(const cgltf_data *data, const cgltf_animation *gltfAnimation);
+
+    // drops channels that can't be played and returns how many: unknown nodes or samplers, inputs that aren't
+    // sorted and outputs that don't match the interpolation
+    size_t validate(Animation &animation, size_t nodeCount);
+
+    // rewrites the translation, rotation and scale samplers of a validated clip into the quantized encodings:
+    // cubic splines are baked to linear keys, keys interpolation reconstructs within the tolerances are dropped and
+    // key times become frame indices when they fall on a uniform rate. weights samplers are left as they are
+    void compress(Animation &animation);
+
+    // bytes the clip's keys take
+    size_t memorySize(const Animation &animation);
+
+    size_t keyCount(const AnimationSampler &sampler);
+
+    // index of the last keyframe at or before time, 0 before the first one. cursor holds the previous result, so
+    // forward playback steps a key or two and only a loop or a seek falls back to a binary search
+    uint32_t findKeyframe(std::span<const float> inputs, float time, uint32_t &cursor);
+
+    // value at time, clamped to the first and last keyframe. rotations are quaternions in xyzw
+    glm::vec4 sample(const AnimationSampler &sampler, AnimationChannel::Path path, float time, uint32_t &cursor);
+
+    // morph target weights at time, as many as both the sampler and weights have
+    void sampleWeights(const AnimationSampler &sampler, float time, uint32_t &cursor, std::span<float> weights);
+
+    // the nodes' own transforms and weights. local and world transforms are left at identity, with every node
+    // flagged as changed
+    Pose restPose(std::span<const std::shared_ptr<Node> > nodes);
+
+    // advances state by deltaTime times its speed, looping over the clip, and writes every channel into pose
+    void play(const Animation &animation, AnimationState &state, float deltaTime, Pose &pose);
+}
@@ -0,0 +1,72 @@
+#pragma once
+
+#define VK_NO_PROTOTYPES
+
+#include <volk.h>
+
+#include <span>
+#include <utility>
+#include <vector>
+
+#include "RangeAllocator.h"
+#include "VulkanTypes.h"
+
+struct VulkanContext;
+
+// device buffer handed out in ranges of elements of a fixed size, so offsets can be used directly as vertex, index
+// or meshlet offsets. freed ranges are reused first fit. every allocation is uploaded on its own through the upload
+// manager.
+// when full, a buffer larger by whole chunks replaces it and the contents are copied over on the gpu. offsets stay
+// valid, the handle and device address change
+class ArenaBuffer {
+public:
+    // preallocates one chunk
+    void init(VulkanContext *vulkanContext, size_t elementSize, uint32_t chunkElements, VkBufferUsageFlags usage);
+
+    void terminate();
+
+    // returns the offset of count new elements, in elements
+    uint32_t allocate(uint32_t count);
+
+    // the range must not be read by frames in flight anymore
+    void free(uint32_t offset, uint32_t count);
+
+    // records the copy into the calling thread's upload batch
+    void upload(uint32_t offset, const void *data, uint32_t count);
+
+    // a quarter of the used range are holes, or more than a chunk past it is allocated
+    [[nodiscard]] bool fragmented() const;
+
+    // records copies of the given (offset, count) ranges into a new buffer sized for them, packed to the front in
+    // order, and returns their new offsets. every other range is dropped
+    std::vector<uint32_t> compact(VkCommandBuffer cmd, std::span<const std::pair<uint32_t, uint32_t>> ranges);
+
+    // buffers replaced by growing. earlier frames and the copy into the new buffer still read them, the caller
+    // destroys them once those are done
+    std::vector<VulkanBuffer> takeRetiredBuffers();
+
+    [[nodiscard]] const VulkanBuffer &buffer() const { return m_buffer; }
+
+    [[nodiscard]] VkBufferUsageFlags usage() const { return m_usage; }
+
+    [[nodiscard]] uint32_t size() const { return m_ranges.size(); }
+
+    [[nodiscard]] bool empty() const { return m_ranges.size() == 0; }
+
+private:
+    VulkanContext *m_vulkanContext = nullptr;
+    size_t m_elementSize = 0;
+    uint32_t m_chunkElements = 0;
+    VkBufferUsageFlags m_usage = 0;
+
+    VulkanBuffer m_buffer = {};
+    uint32_t m_capacity = 0;
+    RangeAllocator m_ranges;
+
+    std::vector<VulkanBuffer> m_retiredBuffers;
+
+    [[nodiscard]] uint32_t chunkCapacity(uint32_t count) const;
+
+    // copies the first copyCount elements over
+    void grow(uint32_t minCapacity, uint32_t copyCount);
+};
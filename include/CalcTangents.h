@@ -1,26 +1,64 @@
 #pragma once
 
 #include <mikktspace.h>
+#include <span>
+#include <type_traits>
 #include <vector>
 #include "VulkanTypes.h"
 
-struct CalcTangentData {
-    const std::vector<uint32_t>& indices;
-    std::vector<Vertex>& vertices;
-    const MeshPrimitive& primitive;
+class ThreadPool;
+
+enum class TangentMode {
+    eMikkTSpace, // matches what normal maps are usually baked against
+    eFast,       // per triangle uv gradients accumulated per vertex, then orthogonalized against the normal
+};
+
+// view of one attribute in interleaved or planar storage, elements are read in place
+template<typename T>
+struct AttributeStream {
+    using Byte = std::conditional_t<std::is_const_v<T>, const std::byte, std::byte>;
+
+    Byte *base = nullptr;
+    size_t stride = sizeof(T);
+
+    T &operator[](size_t index) const {
+        return *reinterpret_cast<T *>(base + index * stride);
+    }
+};
+
+struct TangentStreams {
+    AttributeStream<const glm::vec3> positions;
+    AttributeStream<const glm::vec3> normals;
+    AttributeStream<const float> u;
+    AttributeStream<const float> v;
+
+    AttributeStream<glm::vec4> tangents;
+    AttributeStream<glm::vec4> bitangents;
+
+    static TangentStreams fromVertices(std::vector<Vertex> &vertices);
 };
 
+// generates tangents and bitangents for indexed triangle primitives. primitives are spread over threadPool when
+// one is given, so they must not share vertices
 class CalcTangents {
 public:
-    CalcTangents();
+    explicit CalcTangents(ThreadPool *threadPool = nullptr, TangentMode mode = TangentMode::eMikkTSpace);
 
-    void calculate(CalcTangentData* data);
+    // indices are absolute, vertices of a primitive are [vertexStart, vertexStart + vertexCount)
+    void calculate(std::span<const uint32_t> indices, const TangentStreams &streams,
+                   std::span<const MeshPrimitive> primitives) const;
+
+    void calculate(std::span<const uint32_t> indices, std::vector<Vertex> &vertices,
+                   std::span<const MeshPrimitive> primitives) const;
 
 private:
-    SMikkTSpaceInterface m_interface = {};
-    SMikkTSpaceContext m_context = {};
+    ThreadPool *m_threadPool;
+    TangentMode m_mode;
+
+    static void calculateMikkTSpace(std::span<const uint32_t> indices, const TangentStreams &streams);
 
-    static int getVertexIndex(const SMikkTSpaceContext *pContext, int iFace, int iVert);
+    static void calculateFast(std::span<const uint32_t> indices, const TangentStreams &streams,
+                              const MeshPrimitive &primitive);
 
     static int getNumFaces(const SMikkTSpaceContext *pContext);
 
@@ -34,4 +72,4 @@ private:
 
     static void setTSpaceBasic(const SMikkTSpaceContext *pContext, const float fvTangent[], const float fSign,
                                const int iFace, const int iVert);
-};
\ No newline at end of file
+};
@@ -5,16 +5,68 @@
 #include <filesystem>
 #include <optional>
 
+#include "CalcTangents.h"
+#include "AnimationClip.h"
 #include "Utils.h"
+#include "VertexFormat.h"
 #include "VulkanTypes.h"
 
 class VulkanContext;
 
+class ThreadPool;
+
+class ImageCache;
+
+struct SharedImage;
+
+struct GltfLoadOptions {
+    // map the gltf/glb and external .bin files instead of reading them into heap memory,
+    // accessors are then read straight from the page cache
+    bool mapFiles = true;
+
+    // reuse the cooked <asset>.vkecache next to the asset when its hash matches, write it otherwise
+    bool useSceneCache = true;
+
+    // encode png/jpeg images to BC7/BC5/BC4 on load. encoded textures are kept in texture_cache/ next to the asset,
+    // keyed by the hash of the source image, so later loads upload the blocks without decoding
+    bool compressTextures = true;
+
+    // eFast skips mikktspace for primitives without tangents, for assets whose normal maps weren't baked with it
+    TangentMode tangentMode = TangentMode::eMikkTSpace;
+
+    // reorder each primitive's triangles for the post-transform cache and its vertices into fetch order.
+    // ACMR/ATVR before and after are printed per primitive
+    bool optimizeMeshes = true;
+
+    // additionally sort triangle clusters front to back from the outside, trading a little cache efficiency
+    bool optimizeOverdraw = false;
+
+    // give non-indexed triangle primitives an index buffer by merging duplicate vertices. bitwise identical
+    // vertices are merged, or ones within weldEpsilon per component when it is above 0
+    bool weldVertices = true;
+    float weldEpsilon = 0.f;
+
+    // split indexed triangle primitives into meshlets with culling bounds, for the mesh shader and compute cull paths
+    bool buildMeshlets = true;
+
+    // simplify indexed triangle primitives into up to MAX_MESH_LODS - 1 coarser index ranges, each about half the
+    // previous one, appended to the index buffer. levels stop once they would deviate more than lodMaxError,
+    // relative to the primitive's bounding radius
+    bool generateLods = true;
+    float lodMaxError = 0.05f;
+
+    // drop animation keys playback can reconstruct within AnimationClip's tolerances, quantize the rest and store
+    // their times as frame indices. the memory before and after is printed
+    bool compressAnimations = true;
+};
+
 struct GltfScene {
 public:
     MOVABLE_ONLY(GltfScene);
 
-    GltfScene(VulkanContext *vulkanContext);
+    // image decoding is spread over threadPool when one is given, otherwise it runs on the calling thread.
+    // images found in imageCache are shared instead of decoded and uploaded again
+    GltfScene(VulkanContext *vulkanContext, ThreadPool *threadPool = nullptr, ImageCache *imageCache = nullptr);
 
     ~GltfScene();
 
@@ -22,7 +74,10 @@ public:
 
     bool loaded = false;
 
-    std::vector<std::optional<VulkanImage> > images;
+    // timeline value of the upload batches holding the scene's images, shared ones included
+    uint64_t uploadValue = 0;
+
+    std::vector<std::shared_ptr<SharedImage> > images;
     std::vector<VkSampler> samplers;
     std::vector<std::shared_ptr<Texture> > textures;
     std::vector<Material> materials;
@@ -32,25 +87,81 @@ public:
     std::vector<std::shared_ptr<Node> > nodes;
     std::vector<std::shared_ptr<Node> > topLevelNodes;
 
+    // the hierarchy is flattened at load so parents come before their children: nodes, poses, animation channels and
+    // skin joints all use this order. world transforms are one pass over it and node i's subtree is
+    // [i, nodeSubtreeEnds[i])
+    std::vector<uint32_t> nodeParents; // UINT32_MAX for top level nodes
+    std::vector<uint32_t> nodeSubtreeEnds;
+    std::vector<glm::mat4> nodeMatrices; // Node::matrix, applied after translation, rotation and scale
+    std::vector<uint32_t> meshNodes; // nodes with a mesh, each gets a transform when drawn
+
+    // the nodes before any animation, world transforms included. every instance of a static scene draws it, so
+    // its mesh node transforms and joints are kept for createDrawDatas to copy
+    Pose restPose;
+    std::vector<glm::mat4> restMeshTransforms;
+    std::vector<glm::mat4> restJoints;
+
     std::vector<uint32_t> indices;
     std::vector<Vertex> vertices;
 
+    // MeshPrimitive::meshletOffset/meshletCount index meshlets, meshlet vertices index vertices
+    std::vector<Meshlet> meshlets;
+    std::vector<uint32_t> meshletVertices;
+    std::vector<uint32_t> meshletTriangles;
+
+    // MeshPrimitive::morphDeltaStart and morphRangeStart index these
+    std::vector<MorphDelta> morphDeltas;
+    std::vector<uint32_t> morphRanges;
+
     std::vector<Animation> animations;
     std::vector<std::unique_ptr<Skin>> skins;
 
     std::vector<uint32_t> skinJointCounts;
     std::vector<uint32_t> jointOffsets;
 
-    void load(std::filesystem::path filePath);
+    void load(std::filesystem::path filePath, const GltfLoadOptions &loadOptions = {});
+
+    // plays state's clip into pose and updates its world transforms. the scene is only read, so instances are
+    // evaluated concurrently
+    void animate(AnimationState &state, float deltaTime, Pose &pose) const;
+
+    // recomputes the local and world transforms of pose's changed nodes and their descendants, subtrees nothing
+    // changed in are skipped whole
+    void computeWorldTransforms(Pose &pose) const;
 
-    void updateAnimation(float deltaTime);
+    // world transforms of meshNodes and the joint matrices of every skin at jointOffsets, as many as restJoints
+    void writeTransforms(const Pose &pose, glm::mat4 *meshTransforms, glm::mat4 *joints) const;
 
 private:
     VulkanContext* m_vulkanContext;
+    ThreadPool* m_threadPool;
+    ImageCache* m_imageCache;
+
+    // images that failed to decode and hold the error texture
+    std::vector<bool> m_failedImages;
+
+    void mapExternalBuffers(cgltf_data *data, std::vector<MappedFile> &mappedBuffers) const;
+
+    // hash of the json, every buffer and the options the cooked scene data is derived from
+    static uint64_t hashSource(const cgltf_data *data, const GltfLoadOptions &loadOptions);
+
+    void parseImages(const cgltf_data *data, bool compressTextures);
 
-    void parseImages(const cgltf_data *data);
+    void parseMesh(const cgltf_data *data, const GltfLoadOptions &loadOptions);
 
-    void parseMesh(const cgltf_data *data);
+    void optimizeMeshes(bool optimizeOverdraw);
+
+    std::span<MorphDelta> primitiveMorphDeltas(const MeshPrimitive &primitive);
+
+    // orders the deltaCount deltas of a primitive by vertex and rebuilds its morph ranges
+    void sortMorphDeltas(const MeshPrimitive &primitive, size_t deltaCount);
+
+    // bounding sphere and position quantization of every primitive
+    void computeBounds();
+
+    void buildLods(const cgltf_data *data, float maxError);
+
+    void buildMeshlets(const cgltf_data *data);
 
     void parseNodes(const cgltf_data *data);
 
@@ -60,6 +171,15 @@ private:
 
     void parseAnimations(const cgltf_data *data);
 
+    // drops channels playback can't handle, once per load so playback doesn't check every frame
+    void validateAnimations();
+
+    void compressAnimations();
+
+    // reorders nodes parents first, remapping animation channels and skins, and fills the flattened hierarchy
+    // and restPose
+    void linkNodes();
+
     void parseSkins(const cgltf_data *data);
 
     void clear();
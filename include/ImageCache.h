@@ -0,0 +1,53 @@
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+
+#include "VulkanTypes.h"
+
+struct VulkanContext;
+
+// a sampled image shared by every scene that loaded the same source bytes, destroyed with the last reference
+struct SharedImage {
+    SharedImage(VulkanContext *vulkanContext, const VulkanImage &image, uint64_t uploadValue, size_t sizeBytes);
+
+    ~SharedImage();
+
+    SharedImage(const SharedImage &) = delete;
+
+    SharedImage &operator=(const SharedImage &) = delete;
+
+    VulkanImage image;
+    uint64_t uploadValue; // timeline value of the upload batch holding the image, 0 if the owning scene tracks it
+    size_t sizeBytes;
+
+private:
+    VulkanContext *m_vulkanContext;
+};
+
+// images of every scene keyed by a hash of their source bytes and the encoding they are uploaded with, so an image
+// used by several scenes, or twice in one, is decoded and uploaded once. only weak references are kept, an image is
+// dropped from the cache with the last scene using it. thread safe
+class ImageCache {
+public:
+    struct Stats {
+        uint64_t lookups;
+        uint64_t hits;
+        uint64_t bytesSaved; // device memory and uploads the hits didn't need
+    };
+
+    // the image for key if a scene still holds it
+    std::shared_ptr<SharedImage> find(uint64_t key);
+
+    // keeps image for key and returns it, or the image another thread inserted for key in the meantime
+    std::shared_ptr<SharedImage> insert(uint64_t key, const std::shared_ptr<SharedImage> &image);
+
+    [[nodiscard]] Stats stats() const;
+
+private:
+    mutable std::mutex m_mutex;
+    std::unordered_map<uint64_t, std::weak_ptr<SharedImage>> m_images;
+    Stats m_stats = {};
+};
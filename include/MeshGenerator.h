@@ -5,6 +5,7 @@
 struct MeshBuffers {
     std::vector<Vertex> vertices;
     std::vector<uint32_t> indices;
+    glm::vec4 positionQuantization; // see VertexFormat::positionQuantization
 };
 
 MeshBuffers createCubeMesh(float edgeX, float edgeY, float edgeZ);
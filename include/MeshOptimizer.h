@@ -0,0 +1,56 @@
+#pragma once
+
+#include <glm/glm.hpp>
+
+#include <cstdint>
+#include <span>
+#include <vector>
+
+#include "VulkanTypes.h"
+
+// index and vertex reordering for indexed triangle lists. indices are local to the vertex span they refer to
+namespace MeshOpt {
+    // cache size the reordering targets and the stats are simulated with
+    constexpr uint32_t VERTEX_CACHE_SIZE = 16;
+
+    struct VertexCacheStats {
+        float acmr; // vertex shader invocations per triangle
+        float atvr; // vertex shader invocations per referenced vertex, 1 is optimal
+    };
+
+    // collapses vertices that are bitwise identical, or that snap to the same epsilon grid cell in every component
+    // when epsilon > 0. unique vertices are compacted to the front of vertices in first use order and indices gets
+    // one entry per input vertex. returns the number of unique vertices
+    size_t weldVertices(std::span<Vertex> vertices, std::vector<uint32_t> &indices, float epsilon = 0.f);
+
+    // simulates a fifo post-transform cache
+    VertexCacheStats analyzeVertexCache(std::span<const uint32_t> indices, size_t vertexCount,
+                                        uint32_t cacheSize = VERTEX_CACHE_SIZE);
+
+    // tipsify: fans triangles around the most recently cached vertex that still has triangles left
+    void optimizeVertexCache(std::span<uint32_t> indices, size_t vertexCount, uint32_t cacheSize = VERTEX_CACHE_SIZE);
+
+    // reorders clusters of the cache optimized order so outward facing ones come first. clusters are only cut where
+    // their acmr stays within threshold of the whole mesh, so cache efficiency is mostly kept
+    void optimizeOverdraw(std::span<uint32_t> indices, std::span<const Vertex> vertices, float threshold = 1.05f,
+                          uint32_t cacheSize = VERTEX_CACHE_SIZE);
+
+    // moves vertices into the order the indices first reference them, so vertex fetch reads sequentially.
+    // unreferenced vertices are kept at the end. returns the new index of every old vertex
+    std::vector<uint32_t> optimizeVertexFetch(std::span<uint32_t> indices, std::span<Vertex> vertices);
+
+    // quadric error edge collapse towards targetIndexCount. vertices never move, a collapse merges a position into a
+    // neighbouring one, so attributes stay exact. open borders and uv/normal seams (wedges sharing a position) only
+    // collapse along themselves, other vertices with wedges are locked. stops early once the next collapse would
+    // deviate more than targetError, in mesh units. error receives the largest deviation of the collapses made
+    std::vector<uint32_t> simplify(std::span<const uint32_t> indices, std::span<const Vertex> vertices,
+                                   size_t targetIndexCount, float targetError, float *error = nullptr);
+
+    // splits the triangles into meshlets in index order, so each meshlet also covers a contiguous index range.
+    // meshlets, their vertices and packed triangles are appended, with offsets relative to the output vectors and
+    // meshlet vertices and index offsets local to the inputs. coneCulling = false keeps every cone cutoff at 1,
+    // for double sided geometry
+    void buildMeshlets(std::span<const uint32_t> indices, std::span<const Vertex> vertices,
+                       std::vector<Meshlet> &meshlets, std::vector<uint32_t> &meshletVertices,
+                       std::vector<uint32_t> &meshletTriangles, bool coneCulling = true);
+}
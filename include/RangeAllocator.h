@@ -0,0 +1,27 @@
+#pragma once
+
+#include <cstdint>
+#include <map>
+
+// hands out ranges of [0, size) first fit from the freed ranges, or from the end when none fits. freed ranges next
+// to each other are merged and a freed range at the end shrinks size
+class RangeAllocator {
+public:
+    uint32_t allocate(uint32_t count);
+
+    void free(uint32_t offset, uint32_t count);
+
+    // everything below size is in use again, after its contents were moved to the front
+    void reset(uint32_t size);
+
+    // end of the last range in use
+    [[nodiscard]] uint32_t size() const { return m_size; }
+
+    // elements in freed ranges below size
+    [[nodiscard]] uint32_t freeCount() const { return m_freeCount; }
+
+private:
+    std::map<uint32_t, uint32_t> m_freeRanges; // offset to count
+    uint32_t m_size = 0;
+    uint32_t m_freeCount = 0;
+};
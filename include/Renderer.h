@@ -6,6 +6,14 @@
 #include "Timer.h"
 #include "MeshGenerator.h"
 #include "Skybox.h"
+#include "ThreadPool.h"
+#include "ArenaBuffer.h"
+#include "ImageCache.h"
+#include "RangeAllocator.h"
+#include "VertexFormat.h"
+
+#include <map>
+#include <unordered_map>
 
 constexpr uint32_t LOAD_FAILED = UINT32_MAX;
 
@@ -22,7 +30,72 @@ struct PushConstantsBindless {
     uint32_t jointOffset;
 
     uint32_t modelTransformOffset;
-    float pad[3];
+    VkDeviceAddress skinBuffer;
+    glm::vec4 positionQuantization;
+    int32_t skinVertexOffset;
+    int32_t morphVertexOffset;
+    float pad[2];
+};
+
+// meshlet.task/meshlet.mesh, starts like PushConstantsBindless so texture_bindless.frag reads the same offsets
+struct PushConstantsMeshlet {
+    VkDeviceAddress vertexBuffer;
+    uint32_t transformOffset;
+    uint32_t materialOffset;
+    uint32_t jointOffset;
+
+    uint32_t modelTransformOffset;
+    VkDeviceAddress meshletBuffer;
+    VkDeviceAddress meshletVertexBuffer;
+    VkDeviceAddress meshletTriangleBuffer;
+    uint32_t meshletOffset;
+    uint32_t meshletCount;
+    uint32_t cullMeshlets;
+    uint32_t pad;
+    glm::vec4 positionQuantization;
+    VkDeviceAddress skinBuffer;
+    int32_t skinVertexOffset;
+    int32_t morphVertexOffset;
+};
+
+// meshlet_cull.comp
+struct PushConstantsMeshletCull {
+    VkDeviceAddress meshletBuffer;
+    VkDeviceAddress drawCommandBuffer;
+    VkDeviceAddress drawCountBuffer;
+    uint32_t transformOffset;
+    uint32_t modelTransformOffset;
+    uint32_t meshletOffset;
+    uint32_t meshletCount;
+    uint32_t instanceCount;
+    uint32_t drawCommandOffset;
+    uint32_t drawCountIndex;
+    uint32_t cullMeshlets;
+};
+
+// morph_blend.comp, one dispatch per morphed node primitive
+struct PushConstantsMorphBlend {
+    glm::vec4 positionQuantization;
+    VkDeviceAddress vertexBuffer;
+    VkDeviceAddress deltaBuffer;
+    VkDeviceAddress rangeBuffer;
+    VkDeviceAddress weightBuffer;
+    VkDeviceAddress outputBuffer;
+    uint32_t vertexOffset;
+    uint32_t vertexCount;
+    uint32_t deltaOffset;
+    uint32_t rangeOffset;
+    uint32_t weightOffset;
+    uint32_t outputOffset;
+};
+
+// arena_rebase.comp, adds delta to count uints stride apart
+struct PushConstantsRebase {
+    VkDeviceAddress buffer;
+    uint32_t first;
+    uint32_t count;
+    uint32_t stride;
+    uint32_t delta;
 };
 
 struct PushConstantsSkybox {
@@ -42,23 +115,76 @@ struct DrawData {
     uint32_t modelTransformOffset;
     uint32_t instanceCount;
     bool hasIndices;
+    glm::vec4 positionQuantization;
+
+    // skinned draws use the skinned pipeline variants, their skin vertex is at vertex index + skinVertexOffset
+    bool skinned;
+    int32_t skinVertexOffset;
+
+    // morphed draws read the vertices blended for their node this frame, at vertex index + morphVertexOffset of
+    // the frame's morphed vertex buffer
+    bool morphed;
+    int32_t morphVertexOffset;
+
+    // drawn as meshlets when meshletCount != 0, with mesh shaders or through the compute cull and indirect draws.
+    // culling is off for skinned and morphed primitives, their bounds are for the bind pose
+    uint32_t meshletOffset;
+    uint32_t meshletCount;
+    uint32_t drawCommandOffset;
+    uint32_t drawCountIndex;
+    bool cullMeshlets;
+
+    // instances are split over the lods by their projected error, coarser lods get draws of their own
+    glm::vec4 bounds;
+    uint32_t lodCount;
+    MeshLod lods[MAX_MESH_LODS];
+};
+
+enum class ModelState {
+    eLoading, // reserved by loadGltfAsync, nothing is drawn for it yet
+    eResident,
+    eFailed,
+    eUnloaded,
 };
 
 // holds model buffer offset information and number of DrawData objects
 struct ModelData {
+    ModelState state;
+
     uint32_t indexOffset;
     uint32_t vertexOffset;
-    uint32_t textureOffset;
     uint32_t materialOffset;
-    uint32_t jointOffset;
-    uint32_t drawDataOffset;
-    uint32_t drawDataCount;
+    uint32_t meshletOffset;
+    uint32_t skinVertexOffset;
+
+    // sizes of the ranges above, released by unloadModel
+    uint32_t indexCount;
+    uint32_t vertexCount;
+    uint32_t materialCount;
+    uint32_t meshletCount;
+    uint32_t skinVertexCount;
+    uint32_t meshletVertexOffset;
+    uint32_t meshletVertexCount;
+    uint32_t meshletTriangleOffset;
+    uint32_t meshletTriangleCount;
+    uint32_t morphDeltaOffset;
+    uint32_t morphDeltaCount;
+    uint32_t morphRangeOffset;
+    uint32_t morphRangeCount;
+
+    // bindless slot of each of the scene's textures, materials index it with their texture index
+    std::vector<uint32_t> textureSlots;
 };
 
-// holds information for render objects, currently only the model matrix
+// holds information for render objects: the model matrix, and the clip played when the model is animated.
+// every render object of an animated model plays on its own
 struct RenderObjectInfo {
     glm::mat4 modelMatrix;
     uint32_t modelId;
+
+    uint32_t animationClip = 0;
+    float animationTime = 0.f; // start time into the clip
+    float animationSpeed = 1.f;
 };
 
 struct GlobalUniformData {
@@ -72,16 +198,32 @@ struct GlobalUniformData {
 
 class Renderer {
 public:
-    Renderer();
+    // threadCount sizes the pool that runs async loads, image decoding and pose evaluation. 1 decodes an async
+    // load's images on its one worker alone, for comparing load times against the full pool
+    explicit Renderer(uint32_t threadCount = std::thread::hardware_concurrency());
 
     ~Renderer();
 
     void run();
 
-    uint32_t loadGltf(std::filesystem::path filePath);
+    uint32_t loadGltf(std::filesystem::path filePath, const GltfLoadOptions &loadOptions = {});
+
+    // returns the model id at once and imports on the thread pool. render objects can be added for the id right
+    // away, they are drawn from the first frame after the import and its uploads are done
+    uint32_t loadGltfAsync(std::filesystem::path filePath, const GltfLoadOptions &loadOptions = {});
+
+    [[nodiscard]] ModelState modelState(uint32_t modelId) const;
 
     uint32_t loadGeneratedMesh(MeshBuffers *meshBuffer);
 
+    // removes the model and its render objects. its geometry ranges, textures, samplers and texture slots are
+    // released for reuse once the frames in flight are done with them. the id is not reused
+    void unloadModel(uint32_t modelId);
+
+    // moves the geometry of resident models to the front of new arena buffers on the gpu once enough of them is
+    // freed, on by default
+    void setGeometryCompaction(bool enabled);
+
     uint32_t addRenderObject(RenderObjectInfo info);
 
     void addLight(Light light);
@@ -89,6 +231,8 @@ public:
 private:
     VulkanContext m_vulkanContext;
 
+    ThreadPool m_threadPool;
+
     uint32_t currentFrame = 0;
 
     uint32_t getLoadedModelId();
@@ -99,9 +243,29 @@ private:
 
     std::vector<std::pair<uint32_t, RenderObjectInfo>> m_renderObjects;
 
+    // playback state and pose of every render object of an animated model, by render object id
+    struct AnimationInstance {
+        AnimationState state;
+        Pose pose;
+    };
+    std::unordered_map<uint32_t, AnimationInstance> m_animationInstances;
+
     std::vector<std::pair<std::unique_ptr<GltfScene>, uint32_t>> m_sceneDatas;
     std::vector<std::pair<MeshBuffers *, uint32_t>> m_generatedMeshDatas;
 
+    struct PendingLoad {
+        uint32_t modelId;
+        std::future<std::unique_ptr<GltfScene>> future;
+        std::unique_ptr<GltfScene> scene; // imported, waiting for its uploads
+    };
+    std::vector<PendingLoad> m_pendingLoads;
+
+    // appends an imported scene to the geometry arenas, the caller flushes the uploads
+    void addScene(std::unique_ptr<GltfScene> scene, uint32_t modelId);
+
+    // makes finished async loads resident, called on the render thread before the frame is recorded
+    void integrateLoadedModels();
+
     std::vector<ModelData> m_modelDatas;
     std::vector<DrawData> m_drawDatas;
 
@@ -109,8 +273,18 @@ private:
     VulkanBuffer m_lightBuffer;
 
     VkPipeline trianglePipeline;
+    VkPipeline skinnedTrianglePipeline;
     VkPipelineLayout trianglePipelineLayout;
 
+    // task/mesh shader path, only created when the device supports mesh shaders
+    VkPipeline meshletPipeline = VK_NULL_HANDLE;
+    VkPipeline skinnedMeshletPipeline = VK_NULL_HANDLE;
+    VkPipelineLayout meshletPipelineLayout = VK_NULL_HANDLE;
+
+    // fallback path, fills indirect draws for trianglePipeline
+    VkPipeline meshletCullPipeline = VK_NULL_HANDLE;
+    VkPipelineLayout meshletCullPipelineLayout = VK_NULL_HANDLE;
+
     DescriptorAllocator skyboxDescriptors = {};
     VkDescriptorSetLayout skyboxDescriptorLayout = {};
     std::array<VkDescriptorSet, MAX_CONCURRENT_FRAMES> skyboxDescriptorSets;
@@ -123,30 +297,90 @@ private:
 
     Camera m_camera;
 
-    std::vector<uint32_t> m_indices;
-    std::vector<Vertex> m_vertices;
+    // coarsest lod whose simplification error projects to at most this many pixels is drawn
+    float m_lodErrorThreshold = 1.f;
+
     std::vector<std::shared_ptr<Texture>> m_textures;
-    std::vector<Material> m_materials;
+    std::vector<uint32_t> m_textureRefCounts; // models using each slot
+    RangeAllocator m_textureSlots; // free slots of m_textures and the bindless texture array
+    std::map<std::pair<VkImageView, VkSampler>, uint32_t> m_textureSlotLookup;
+
+    // images shared by every scene loaded with the same source bytes
+    ImageCache m_imageCache;
+
+    // geometry lives on the device only, every model appends its own ranges
+    ArenaBuffer m_vertexArena;
+    ArenaBuffer m_indexArena;
+    ArenaBuffer m_materialArena;
+    ArenaBuffer m_skinArena;
+    ArenaBuffer m_meshletArena;
+    ArenaBuffer m_meshletVertexArena;
+    ArenaBuffer m_meshletTriangleArena;
+    ArenaBuffer m_morphDeltaArena;
+    ArenaBuffer m_morphRangeArena;
+    uint64_t m_geometryUploadValue = 0;
+
+    std::array<ArenaBuffer *, 9> geometryArenas();
 
-    VulkanBuffer m_boundedVertexBuffer;
-    VulkanBuffer m_boundedIndexBuffer;
-    VulkanBuffer m_boundedMaterialBuffer;
+    void initGeometryArenas();
 
-    void destroyStaticBuffers();
+    // submits the uploads recorded into the arenas and retires the buffers they outgrew
+    void flushGeometryUploads();
 
-    void createStaticBuffers();
+    // arena buffers replaced while frames in flight or the copy out of them may still read them
+    struct RetiredBuffer {
+        VulkanBuffer buffer;
+        uint64_t frameNumber;
+        uint64_t uploadValue;
+    };
+    std::vector<RetiredBuffer> m_retiredBuffers;
+    uint64_t m_frameNumber = 0;
+
+    void retireBuffer(const VulkanBuffer &buffer);
+
+    // retires the buffers the arenas outgrew or were compacted out of
+    void retireArenaBuffers();
+
+    // unloaded models, released once no frame in flight can read them
+    struct RetiredModel {
+        ModelData modelData;
+        std::unique_ptr<GltfScene> scene; // owns the images and samplers, null for generated meshes
+        uint64_t frameNumber;
+    };
+    std::vector<RetiredModel> m_retiredModels;
+
+    void releaseModel(const ModelData &modelData);
+
+    // destroys retired buffers and releases retired models no frame can use anymore, or all of them once the
+    // device is idle
+    void collectRetiredResources(bool deviceIdle);
+
+    bool m_geometryCompaction = true;
+    VkPipeline arenaRebasePipeline = VK_NULL_HANDLE;
+    VkPipelineLayout arenaRebasePipelineLayout = VK_NULL_HANDLE;
+
+    void initArenaRebasePipeline();
+
+    // once an arena is fragmented, records copies of every resident model's geometry into new arena buffers and
+    // rebases the offsets stored in the indices and meshlets, before the frame's draws
+    void compactGeometry(VkCommandBuffer cmd);
+
+    void rebase(VkCommandBuffer cmd, const ArenaBuffer &arena, uint32_t first, uint32_t count, uint32_t stride,
+                int32_t delta);
 
     GlobalUniformData m_globalUniformData;
     VulkanBuffer m_uniformBuffer;
 
+    // host visible staging per frame, copied into the bounded buffers. sizes change whenever models are loaded or
+    // unloaded, so one frame never recreates or writes a buffer the other frame's copy still reads
     std::vector<glm::mat4> m_transforms;
-    VulkanBuffer m_transformBuffer;
+    std::array<VulkanBuffer, MAX_CONCURRENT_FRAMES> m_transformBuffers;
 
     std::vector<glm::mat4> m_joints;
-    VulkanBuffer m_jointBuffer;
+    std::array<VulkanBuffer, MAX_CONCURRENT_FRAMES> m_jointBuffers;
 
     std::vector<glm::mat4> m_modelTransforms;
-    VulkanBuffer m_modelTransformBuffer;
+    std::array<VulkanBuffer, MAX_CONCURRENT_FRAMES> m_modelTransformBuffers;
 
     std::array<VulkanBuffer, MAX_CONCURRENT_FRAMES> m_boundedUniformBuffers;
     std::array<VulkanBuffer, MAX_CONCURRENT_FRAMES> m_boundedTransformBuffers;
@@ -154,6 +388,31 @@ private:
     std::array<VulkanBuffer, MAX_CONCURRENT_FRAMES> m_boundedLightBuffers;
     std::array<VulkanBuffer, MAX_CONCURRENT_FRAMES> m_boundedModelTransformBuffer;
 
+    // node primitives with a nonzero morph weight, blended into the frame's morphed vertex buffer before drawing
+    struct MorphInstance {
+        glm::vec4 positionQuantization;
+        uint32_t vertexOffset;
+        uint32_t vertexCount;
+        uint32_t deltaOffset;
+        uint32_t rangeOffset;
+        uint32_t weightOffset;
+        uint32_t outputOffset;
+    };
+    std::vector<MorphInstance> m_morphInstances;
+    std::vector<float> m_morphWeights;
+    uint32_t m_morphedVertexCount = 0;
+
+    // grown to the largest frame so far
+    std::array<VulkanBuffer, MAX_CONCURRENT_FRAMES> m_morphedVertexBuffers;
+    std::array<VulkanBuffer, MAX_CONCURRENT_FRAMES> m_morphWeightBuffers;
+
+    VkPipeline morphBlendPipeline = VK_NULL_HANDLE;
+    VkPipelineLayout morphBlendPipelineLayout = VK_NULL_HANDLE;
+
+    // VkDrawIndexedIndirectCommand per visible meshlet instance and one count per meshlet draw
+    std::array<VulkanBuffer, MAX_CONCURRENT_FRAMES> m_meshletDrawCommandBuffers;
+    std::array<VulkanBuffer, MAX_CONCURRENT_FRAMES> m_meshletDrawCountBuffers;
+
     std::unique_ptr<Skybox> m_skybox;
 
     Timer m_timer;
@@ -170,6 +429,16 @@ private:
 
     void createDrawDatas(VkCommandBuffer cmd);
 
+    void initMeshletPipelines();
+
+    void initMorphBlendPipeline();
+
+    // records the compute pass blending m_morphInstances, outside of rendering
+    void blendMorphTargets(VkCommandBuffer cmd);
+
+    // records the compute pass writing the indirect draws of every meshlet draw, outside of rendering
+    void cullMeshlets(VkCommandBuffer cmd);
+
     void updateLightBuffer(VkCommandBuffer cmd);
 
     void updateLightPos(uint32_t lightIndex);
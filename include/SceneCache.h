@@ -0,0 +1,20 @@
+#pragma once
+
+#include <cstdint>
+#include <filesystem>
+
+struct GltfScene;
+
+// cooked copy of everything GltfScene derives from the gltf json and buffers: final vertex, index and meshlet arrays,
+// morph deltas, meshes, materials, the node hierarchy, animations and skins. images, textures and samplers are not cached
+namespace SceneCache {
+    // bump whenever the loader output or the file layout changes
+    constexpr uint32_t LOADER_VERSION = 8;
+
+    std::filesystem::path cachePath(const std::filesystem::path &assetPath);
+
+    // fills scene and returns true if the file exists and was written for contentHash by this loader version
+    bool read(const std::filesystem::path &cacheFile, uint64_t contentHash, GltfScene &scene);
+
+    bool write(const std::filesystem::path &cacheFile, uint64_t contentHash, const GltfScene &scene);
+}
@@ -0,0 +1,35 @@
+#pragma once
+
+#define VK_NO_PROTOTYPES
+
+#include <volk.h>
+
+#include <cstddef>
+#include <vector>
+
+#include "VulkanTypes.h"
+
+class ThreadPool;
+
+// bump whenever the encoded output changes, cached textures from older versions are then ignored
+constexpr uint32_t TEXTURE_ENCODER_VERSION = 1;
+
+// what the texture holds decides the block format it is encoded to
+enum class TextureEncoding {
+    eColor,         // BC7, rgba
+    eNormal,        // BC5, tangent space xy, z is reconstructed in the shader
+    eSingleChannel, // BC4, red channel only
+};
+
+// block compressed mip chain, level offsets point into data
+struct EncodedTexture {
+    VkFormat format = VK_FORMAT_UNDEFINED;
+    VkExtent3D extent = {};
+    std::vector<ImageLevel> levels;
+    std::vector<std::byte> data;
+};
+
+// builds the full mip chain from rgba8 pixels on the cpu and encodes every level.
+// blocks are spread over threadPool when one is given
+EncodedTexture encodeTexture(const unsigned char *rgba, uint32_t width, uint32_t height, TextureEncoding encoding,
+                             ThreadPool *threadPool);
@@ -0,0 +1,35 @@
+#pragma once
+
+#define VK_NO_PROTOTYPES
+
+#include <volk.h>
+
+#include <cstddef>
+#include <optional>
+#include <span>
+#include <vector>
+
+#include "VulkanTypes.h"
+
+// 2d texture with prebuilt mips read from a KTX2 or DDS container.
+// data points into the container bytes, which the caller keeps alive until the upload is recorded
+struct TextureFile {
+    VkFormat format = VK_FORMAT_UNDEFINED;
+    VkExtent3D extent = {};
+    std::vector<ImageLevel> levels;
+    const std::byte *data = nullptr;
+    size_t size = 0;
+};
+
+bool isTextureContainer(const std::byte *data, size_t size);
+
+// only uncompressed-payload BC1/BC3/BC4/BC5/BC6H/BC7 2d textures are accepted, anything else returns nullopt
+std::optional<TextureFile> parseTextureFile(const std::byte *data, size_t size);
+
+// bytes per 4x4 block, 0 for formats that aren't block compressed
+uint32_t blockCompressedBlockSize(VkFormat format);
+
+// writes block compressed levels into a KTX2 container that parseTextureFile reads back.
+// level offsets are relative to data, level 0 is the largest
+std::vector<std::byte> serializeKtx2(VkFormat format, VkExtent3D extent, std::span<const ImageLevel> levels,
+                                    const std::byte *data);
@@ -0,0 +1,54 @@
+#pragma once
+
+#include <condition_variable>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <queue>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+class ThreadPool {
+public:
+    explicit ThreadPool(uint32_t threadCount = std::thread::hardware_concurrency());
+
+    ~ThreadPool();
+
+    ThreadPool(const ThreadPool &) = delete;
+
+    ThreadPool &operator=(const ThreadPool &) = delete;
+
+    [[nodiscard]] uint32_t threadCount() const;
+
+    template<typename Func>
+    auto submit(Func &&func) -> std::future<std::invoke_result_t<Func>> {
+        using ResultType = std::invoke_result_t<Func>;
+
+        // std::function needs a copyable target, packaged_task is move only
+        auto task = std::make_shared<std::packaged_task<ResultType()> >(std::forward<Func>(func));
+        std::future<ResultType> future = task->get_future();
+
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_tasks.emplace([task]() { (*task)(); });
+        }
+        m_condition.notify_one();
+
+        return future;
+    }
+
+    // calls func(i) for every i in [0, count) and returns when all calls are done.
+    // the calling thread works on the range too, so this is safe to call from inside a pool task
+    void parallelFor(size_t count, const std::function<void(size_t)> &func);
+
+private:
+    std::vector<std::thread> m_workers;
+    std::queue<std::function<void()> > m_tasks;
+    std::mutex m_mutex;
+    std::condition_variable m_condition;
+    bool m_stopping = false;
+
+    void workerLoop();
+};
@@ -0,0 +1,120 @@
+#pragma once
+
+#define VK_NO_PROTOTYPES
+
+#include <volk.h>
+#include <vk_mem_alloc.h>
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <span>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#include "VulkanTypes.h"
+
+struct VulkanContext;
+
+constexpr size_t DEFAULT_STAGING_RING_SIZE = 64 * 1024 * 1024;
+
+// batches buffer and image uploads without blocking on the gpu.
+// data is copied into a persistently mapped staging ring and the transfer commands are recorded into a command
+// buffer owned by the calling thread. flush() submits the thread's batch and returns the timeline value that is
+// signaled once its copies are done. the only wait on the upload path is when the staging ring is full
+class UploadManager {
+public:
+    void init(VulkanContext *vulkanContext, size_t stagingSize = DEFAULT_STAGING_RING_SIZE);
+
+    void terminate();
+
+    void uploadBuffer(VkBuffer dst, size_t dstOffset, const void *data, size_t size);
+
+    // device side copy of the first size bytes, ordered after the copies already recorded into the batch and
+    // before the ones recorded after it
+    void copyBuffer(VkBuffer src, VkBuffer dst, size_t size);
+
+    // copies tightly packed pixels into mip 0 and leaves the whole image in SHADER_READ_ONLY_OPTIMAL
+    void uploadImage(const VulkanImage &image, const void *data, size_t size, bool generateMipmaps);
+
+    // copies prebuilt mip levels, level offsets are relative to data
+    void uploadImage(const VulkanImage &image, const void *data, size_t size, std::span<const ImageLevel> levels);
+
+    // submits the calling thread's batch. if nothing was recorded, returns the value of its last submission
+    uint64_t flush();
+
+    [[nodiscard]] uint64_t completedValue() const;
+
+    [[nodiscard]] bool isComplete(uint64_t value) const;
+
+    void wait(uint64_t value) const;
+
+    // returns staging memory of finished batches and frees the command pools of exited threads, call once per frame
+    void collect();
+
+private:
+    struct StagingAllocation {
+        VkBuffer buffer = VK_NULL_HANDLE;
+        size_t offset = 0;
+        void *mapped = nullptr;
+    };
+
+    // a range of the staging ring, retireValue is 0 while the batch using it is still being recorded
+    struct RingRegion {
+        size_t begin;
+        size_t end;
+        uint64_t retireValue;
+    };
+
+    struct ThreadContext {
+        VkCommandPool commandPool = VK_NULL_HANDLE;
+        VkCommandBuffer commandBuffer = VK_NULL_HANDLE; // batch being recorded
+        uint64_t lastSubmittedValue = 0;
+
+        std::vector<uint64_t> regionIds;
+        std::vector<VulkanBuffer> dedicatedBuffers;
+
+        std::deque<std::pair<uint64_t, VkCommandBuffer>> submittedCommandBuffers;
+        std::vector<VkCommandBuffer> freeCommandBuffers;
+
+        // set when the owning thread exits, shared with that thread's thread_local cleanup
+        std::shared_ptr<std::atomic<bool>> threadExited;
+    };
+
+    VulkanContext *m_vulkanContext = nullptr;
+
+    VkSemaphore m_timelineSemaphore = VK_NULL_HANDLE;
+    uint64_t m_lastSubmittedValue = 0; // guarded by VulkanContext::queueMutex
+
+    VulkanBuffer m_stagingRing = {};
+    size_t m_stagingSize = 0;
+
+    std::mutex m_ringMutex;
+    // signaled by flush() once it has assigned retire values to its regions
+    std::condition_variable m_ringCondition;
+    std::deque<RingRegion> m_ringRegions;
+    uint64_t m_frontRegionId = 0;
+    // staging buffers for uploads that don't fit in the ring
+    std::vector<std::pair<uint64_t, VulkanBuffer>> m_retiringBuffers;
+
+    std::mutex m_threadContextMutex;
+    std::unordered_map<std::thread::id, std::unique_ptr<ThreadContext>> m_threadContexts;
+
+    ThreadContext &getThreadContext();
+
+    VkCommandBuffer beginBatch(ThreadContext &context);
+
+    StagingAllocation allocateStaging(ThreadContext &context, size_t size);
+
+    StagingAllocation allocateDedicatedStaging(ThreadContext &context, size_t size);
+
+    void releaseExitedThreads(uint64_t completed);
+
+    // both expect m_ringMutex to be held
+    bool tryAllocateFromRing(size_t size, size_t &offset) const;
+
+    void retireRegions(uint64_t completed);
+};
@@ -2,6 +2,8 @@
 
 #include <filesystem>
 #include <vector>
+#include <cstddef>
+#include <cstdint>
 
 #define MOVABLE_ONLY(ClassName)            \
     ClassName(const ClassName&) = delete;  \
@@ -10,3 +12,43 @@
     ClassName& operator=(ClassName&&) noexcept = default;
 
 std::vector<char> readFile(std::filesystem::path fileName, bool isBinary = false);
+
+// read only view of a whole file, memory mapped so reads are served straight from the page cache
+class MappedFile {
+public:
+    MappedFile() = default;
+
+    explicit MappedFile(const std::filesystem::path &path);
+
+    ~MappedFile();
+
+    MappedFile(const MappedFile &) = delete;
+
+    MappedFile &operator=(const MappedFile &) = delete;
+
+    MappedFile(MappedFile &&other) noexcept;
+
+    MappedFile &operator=(MappedFile &&other) noexcept;
+
+    [[nodiscard]] bool isOpen() const { return m_data != nullptr; }
+
+    [[nodiscard]] const std::byte *data() const { return static_cast<const std::byte *>(m_data); }
+
+    [[nodiscard]] size_t size() const { return m_size; }
+
+private:
+    void *m_data = nullptr;
+    size_t m_size = 0;
+#ifdef _WIN32
+    void *m_fileHandle = nullptr;
+    void *m_mappingHandle = nullptr;
+#endif
+
+    void close();
+};
+
+// peak resident set size of the process in bytes, 0 if the platform doesn't report it
+size_t peakResidentSetSize();
+
+// 64 bit xxHash of a byte range, chain calls through seed to hash several ranges
+uint64_t hashBytes(const void *data, size_t size, uint64_t seed = 0);
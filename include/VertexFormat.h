@@ -0,0 +1,221 @@
+#ifndef VKE_VERTEX_FORMAT_H
+#define VKE_VERTEX_FORMAT_H
+
+// layout of the gpu vertex buffer, shared with the shaders through GL_GOOGLE_include_directive. only the
+// preprocessor and plain structs of uints are common to both languages, so keep to those outside the
+// __cplusplus blocks.
+//
+// with VKE_PACKED_VERTICES (cmake option, on by default) vertices are uploaded as PackedVertex, 20 bytes against
+// the 96 of Vertex. positions are quantized inside a cube per primitive, passed to the shaders as
+// vec4(origin, edge). the bitangent is cross(normal, tangent) * sign in both layouts.
+//
+// joints and weights of skinned primitives live in a separate stream of SkinVertex in either case, static
+// primitives have none.
+//
+// morph targets are kept as MorphDelta, only for the vertices a target moves. a primitive's deltas are sorted by
+// vertex and blended into a copy of its vertices by geometry/morph_blend.comp
+
+#ifdef __cplusplus
+#include <cstdint>
+#define VKE_UINT uint32_t
+#else
+#define VKE_UINT uint
+#endif
+
+struct PackedVertex {
+    VKE_UINT positionXY; // unorm16 x, y
+    VKE_UINT positionZ; // unorm16 z, bitangent sign in PACKED_VERTEX_BITANGENT_SIGN_BIT
+    VKE_UINT normal; // octahedral snorm16 x, y
+    VKE_UINT tangent; // octahedral snorm16 x, y
+    VKE_UINT uv; // half x, y
+};
+
+struct SkinVertex {
+    VKE_UINT jointIndices01; // uint16 x2
+    VKE_UINT jointIndices23;
+    VKE_UINT jointWeights; // unorm8 x4, summing to 255
+};
+
+struct MorphDelta {
+    VKE_UINT vertex; // into the primitive's vertices
+    VKE_UINT target;
+    VKE_UINT positionX; // float bits
+    VKE_UINT positionY;
+    VKE_UINT positionZ;
+    VKE_UINT normalXY; // half x, y
+    VKE_UINT normalZTangentX; // half normal z, tangent x
+    VKE_UINT tangentYZ; // half y, z
+};
+
+#define PACKED_VERTEX_BITANGENT_SIGN_BIT 0x10000u
+
+#undef VKE_UINT
+
+#ifdef __cplusplus
+
+#include <span>
+
+#include "VulkanTypes.h"
+
+static_assert(sizeof(PackedVertex) == 20);
+static_assert(sizeof(SkinVertex) == 12);
+static_assert(sizeof(MorphDelta) == 32);
+
+#ifdef VKE_PACKED_VERTICES
+using GpuVertex = PackedVertex;
+#else
+using GpuVertex = Vertex;
+#endif
+
+namespace VertexFormat {
+    // origin in xyz and edge in w of a cube around the vertices. with morph deltas the cube also holds every blend
+    // of them with weights in [0, 1]
+    glm::vec4 positionQuantization(std::span<const Vertex> vertices, std::span<const MorphDelta> morphDeltas = {});
+
+    // writes vertices in the gpu layout, a plain copy when packing is off
+    void pack(std::span<const Vertex> vertices, glm::vec4 positionQuantization, GpuVertex *out);
+
+    void packSkin(std::span<const Vertex> vertices, SkinVertex *out);
+
+    MorphDelta packMorphDelta(uint32_t vertex, uint32_t target, glm::vec3 position, glm::vec3 normal,
+                              glm::vec3 tangent);
+
+    glm::vec3 morphPosition(const MorphDelta &delta);
+}
+
+#else
+
+struct VertexAttributes {
+    vec3 position;
+    vec3 normal;
+    vec4 tangent; // w is the bitangent sign
+    vec2 uv;
+};
+
+struct SkinAttributes {
+    uvec4 jointIndices;
+    vec4 jointWeights;
+};
+
+SkinAttributes unpackSkin(SkinVertex v) {
+    SkinAttributes attributes;
+    attributes.jointIndices = uvec4(v.jointIndices01 & 0xFFFFu, v.jointIndices01 >> 16,
+                                    v.jointIndices23 & 0xFFFFu, v.jointIndices23 >> 16);
+    attributes.jointWeights = unpackUnorm4x8(v.jointWeights);
+    return attributes;
+}
+
+#ifdef VKE_PACKED_VERTICES
+
+#define GpuVertex PackedVertex
+
+vec3 octahedralDecode(vec2 encoded) {
+    vec3 n = vec3(encoded, 1.0 - abs(encoded.x) - abs(encoded.y));
+    float fold = max(-n.z, 0.0);
+    n.x += n.x >= 0.0 ? -fold : fold;
+    n.y += n.y >= 0.0 ? -fold : fold;
+    return normalize(n);
+}
+
+VertexAttributes unpackVertex(PackedVertex v, vec4 positionQuantization) {
+    VertexAttributes attributes;
+    vec3 position = vec3(unpackUnorm2x16(v.positionXY), unpackUnorm2x16(v.positionZ).x);
+    attributes.position = positionQuantization.xyz + position * positionQuantization.w;
+    attributes.normal = octahedralDecode(unpackSnorm2x16(v.normal));
+    float bitangentSign = (v.positionZ & PACKED_VERTEX_BITANGENT_SIGN_BIT) != 0u ? -1.0 : 1.0;
+    attributes.tangent = vec4(octahedralDecode(unpackSnorm2x16(v.tangent)), bitangentSign);
+    attributes.uv = unpackHalf2x16(v.uv);
+    return attributes;
+}
+
+vec2 octahedralEncode(vec3 n) {
+    n /= abs(n.x) + abs(n.y) + abs(n.z);
+    if (n.z < 0.0) {
+        vec2 folded = 1.0 - abs(n.yx);
+        return vec2(n.x >= 0.0 ? folded.x : -folded.x, n.y >= 0.0 ? folded.y : -folded.y);
+    }
+    return n.xy;
+}
+
+// inverse of unpackVertex, the same as VertexFormat::pack on the cpu
+PackedVertex packVertex(VertexAttributes attributes, vec4 positionQuantization) {
+    vec3 position = clamp((attributes.position - positionQuantization.xyz) / positionQuantization.w, 0.0, 1.0);
+
+    PackedVertex v;
+    v.positionXY = packUnorm2x16(position.xy);
+    v.positionZ = packUnorm2x16(vec2(position.z, 0.0));
+    if (attributes.tangent.w < 0.0) {
+        v.positionZ |= PACKED_VERTEX_BITANGENT_SIGN_BIT;
+    }
+    v.normal = packSnorm2x16(octahedralEncode(attributes.normal));
+    v.tangent = packSnorm2x16(octahedralEncode(attributes.tangent.xyz));
+    v.uv = packHalf2x16(attributes.uv);
+    return v;
+}
+
+#else
+
+struct Vertex {
+    vec3 position;
+    float uv_x;
+    vec3 normal;
+    float uv_y;
+    vec4 tangent;
+    vec4 bitangent;
+    vec4 jointIndices;
+    vec4 jointWeights;
+};
+
+#define GpuVertex Vertex
+
+VertexAttributes unpackVertex(Vertex v, vec4 positionQuantization) {
+    VertexAttributes attributes;
+    attributes.position = v.position;
+    attributes.normal = v.normal;
+    attributes.tangent = v.tangent;
+    attributes.uv = vec2(v.uv_x, v.uv_y);
+    return attributes;
+}
+
+// joints and weights are in the skin stream, the ones here are never read
+Vertex packVertex(VertexAttributes attributes, vec4 positionQuantization) {
+    Vertex v;
+    v.position = attributes.position;
+    v.uv_x = attributes.uv.x;
+    v.normal = attributes.normal;
+    v.uv_y = attributes.uv.y;
+    v.tangent = attributes.tangent;
+    v.bitangent = vec4(cross(attributes.normal, attributes.tangent.xyz), attributes.tangent.w);
+    v.jointIndices = vec4(0.0);
+    v.jointWeights = vec4(1.0, 0.0, 0.0, 0.0);
+    return v;
+}
+
+#endif
+
+layout(buffer_reference, std430) readonly buffer VertexBuffer {
+    GpuVertex vertices[];
+};
+
+layout(buffer_reference, std430) readonly buffer SkinBuffer {
+    SkinVertex skinVertices[];
+};
+
+struct MorphAttributes {
+    vec3 position;
+    vec3 normal;
+    vec3 tangent;
+};
+
+MorphAttributes unpackMorphDelta(MorphDelta delta) {
+    MorphAttributes attributes;
+    attributes.position = uintBitsToFloat(uvec3(delta.positionX, delta.positionY, delta.positionZ));
+    vec2 normalZTangentX = unpackHalf2x16(delta.normalZTangentX);
+    attributes.normal = vec3(unpackHalf2x16(delta.normalXY), normalZTangentX.x);
+    attributes.tangent = vec3(normalZTangentX.y, unpackHalf2x16(delta.tangentYZ));
+    return attributes;
+}
+
+#endif
+
+#endif
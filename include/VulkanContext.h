@@ -12,9 +12,14 @@
 #include <array>
 #include <filesystem>
 #include <functional>
+#include <map>
+#include <mutex>
+#include <unordered_map>
 
 #include "VulkanTypes.h"
 #include "VulkanDescriptor.h"
+#include "UploadManager.h"
+#include "TextureFile.h"
 
 constexpr int MAX_CONCURRENT_FRAMES = 2;
 
@@ -33,6 +38,12 @@ struct VulkanContext {
 
     VulkanFeatures features = {};
 
+    // VK_EXT_mesh_shader task and mesh stages, set by init() when features.meshShader is requested and supported
+    bool meshShadersEnabled = false;
+
+    // set by init() when features.textureCompressionBC is requested and supported
+    bool textureCompressionBCEnabled = false;
+
     GLFWwindow *window = nullptr;
     VkExtent2D windowExtent = {800, 600};
 
@@ -56,6 +67,11 @@ struct VulkanContext {
 
     std::array<FrameData, MAX_CONCURRENT_FRAMES> frames;
 
+    // every vkQueueSubmit2/vkQueuePresentKHR on the graphics queue has to hold this
+    mutable std::mutex queueMutex;
+
+    UploadManager uploadManager;
+
     void init();
 
     void terminate();
@@ -72,8 +88,15 @@ struct VulkanContext {
     [[nodiscard]] VulkanImage createImage(VkExtent3D extent,
                                           VkFormat format, VkImageUsageFlags usage, bool mipmapped) const;
 
+    // the upload is recorded into the calling thread's upload batch, flush uploadManager before using the image
     [[nodiscard]] VulkanImage createImage(const void *data, VkExtent3D extent,
-                                          VkFormat format, VkImageUsageFlags usage, bool mipmapped) const;
+                                          VkFormat format, VkImageUsageFlags usage, bool mipmapped);
+
+    // uploads the prebuilt mips as is, the upload lands in the calling thread's upload batch
+    [[nodiscard]] VulkanImage createImage(const TextureFile &texture, VkImageUsageFlags usage);
+
+    // false for BC formats unless textureCompressionBCEnabled
+    [[nodiscard]] bool supportsSampledFormat(VkFormat format) const;
 
     void destroyImage(const VulkanImage &img) const;
 
@@ -81,11 +104,49 @@ struct VulkanContext {
 
     VkDeviceAddress getBufferAddress(const VulkanBuffer& buffer) const;
 
+    // identical create infos share one sampler, every acquireSampler needs a matching releaseSampler.
+    // pNext is not part of the key and has to be null
+    [[nodiscard]] VkSampler acquireSampler(const VkSamplerCreateInfo &samplerInfo);
+
+    void releaseSampler(VkSampler sampler);
+
 private:
     VkFence m_immediateFence = VK_NULL_HANDLE;
     VkCommandBuffer m_immediateCommandBuffer = VK_NULL_HANDLE;
     VkCommandPool m_immediateCommandPool = VK_NULL_HANDLE;
 
+    // every field of VkSamplerCreateInfo past pNext
+    struct SamplerKey {
+        VkSamplerCreateFlags flags;
+        VkFilter magFilter;
+        VkFilter minFilter;
+        VkSamplerMipmapMode mipmapMode;
+        VkSamplerAddressMode addressModeU;
+        VkSamplerAddressMode addressModeV;
+        VkSamplerAddressMode addressModeW;
+        float mipLodBias;
+        VkBool32 anisotropyEnable;
+        float maxAnisotropy;
+        VkBool32 compareEnable;
+        VkCompareOp compareOp;
+        float minLod;
+        float maxLod;
+        VkBorderColor borderColor;
+        VkBool32 unnormalizedCoordinates;
+
+        auto operator<=>(const SamplerKey &) const = default;
+    };
+
+    struct CachedSampler {
+        VkSampler sampler = VK_NULL_HANDLE;
+        uint32_t refCount = 0;
+    };
+
+    // scenes acquire samplers from loader threads
+    std::mutex m_samplerMutex;
+    std::map<SamplerKey, CachedSampler> m_samplers;
+    std::unordered_map<VkSampler, SamplerKey> m_samplerKeys;
+
     void initVulkanInstance();
 
     void initWindow();
@@ -107,4 +168,7 @@ private:
     void initSyncStructures();
 
     void initVmaAllocator();
+
+    [[nodiscard]] VulkanImage allocateImage(VkExtent3D extent, VkFormat format, VkImageUsageFlags usage,
+                                            uint32_t mipLevels) const;
 };
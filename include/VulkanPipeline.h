@@ -14,6 +14,13 @@ public:
 
     PipelineBuilder &setShaders(VkShaderModule vertexShader, VkShaderModule fragmentShader);
 
+    // task shader is optional, vertex input and input assembly are ignored with mesh shaders
+    PipelineBuilder &setMeshShaders(VkShaderModule taskShader, VkShaderModule meshShader,
+                                    VkShaderModule fragmentShader);
+
+    // for the stages set so far, specializationInfo has to outlive build
+    PipelineBuilder &setSpecialization(VkShaderStageFlags stages, const VkSpecializationInfo *specializationInfo);
+
     PipelineBuilder &setInputTopology(VkPrimitiveTopology topology);
 
     PipelineBuilder &setPolygonMode(VkPolygonMode mode);
@@ -24,6 +24,13 @@ struct VulkanFeatures {
     bool descriptorBindingSampledImageUpdateAfterBind = true;
     bool descriptorBindingPartiallyBound = true;
     bool descriptorBindingVariableDescriptorCount = true;
+    bool timelineSemaphore = true;
+    bool drawIndirectCount = true;
+    bool drawIndirectFirstInstance = true;
+    // optional, meshlets are culled in a compute pass and drawn indirectly when the device has no mesh shaders
+    bool meshShader = true;
+    // optional, BC textures fall back to uncompressed ones when the device can't sample them
+    bool textureCompressionBC = true;
 };
 
 struct VulkanBuffer {
@@ -40,6 +47,13 @@ struct VulkanImage {
     VkFormat imageFormat;
 };
 
+// one mip level inside a buffer of tightly packed image data
+struct ImageLevel {
+    size_t offset;
+    size_t size;
+    VkExtent3D extent;
+};
+
 struct Vertex {
     glm::vec3 position;
     float uv_x;
@@ -74,19 +88,60 @@ struct Material {
     float pad1;
 };
 
+// meshlet limits, sized to fit the mesh shader output of one workgroup
+constexpr uint32_t MESHLET_MAX_VERTICES = 64;
+constexpr uint32_t MESHLET_MAX_TRIANGLES = 124;
+
+// cluster of up to MESHLET_MAX_TRIANGLES triangles of a primitive, same layout as the Meshlet struct in the shaders
+struct Meshlet {
+    glm::vec3 center; // bounding sphere in mesh space
+    float radius;
+    glm::vec3 coneAxis; // average triangle facing
+    float coneCutoff; // sine of the cone spread, 1 never culls
+    uint32_t vertexOffset; // into the meshlet vertex array, which holds indices into the vertex array
+    uint32_t triangleOffset; // into the meshlet triangle array, one packed uint of 3 local 8 bit indices per triangle
+    uint32_t indexOffset; // the same triangles as a contiguous range of the index array
+    uint32_t vertexCount;
+    uint32_t triangleCount;
+    uint32_t pad[3];
+};
+
+constexpr uint32_t MAX_MESH_LODS = 4;
+
+// a simplified version of a primitive, drawn with the primitive's vertices
+struct MeshLod {
+    uint32_t indexStart;
+    uint32_t indexCount;
+    float error; // largest deviation from the full detail surface, in mesh units
+};
+
 struct MeshPrimitive {
     uint32_t indexStart;
     uint32_t vertexStart;
     uint32_t indexCount;
     uint32_t vertexCount;
     uint32_t materialOffset;
+    uint32_t meshletOffset;
+    uint32_t meshletCount;
+    glm::vec4 bounds; // bounding sphere in mesh space, xyz center and w radius
+    glm::vec4 positionQuantization; // see VertexFormat::positionQuantization
+    uint32_t skinVertexStart; // into the scene's skin stream, skinned primitives only
+    uint32_t lodCount; // lods[0] is the full detail index range
+    MeshLod lods[MAX_MESH_LODS];
     bool hasIndices;
     bool hasSkin;
+
+    // morph deltas sorted by vertex, vertex v's are [morphRanges[morphRangeStart + v],
+    // morphRanges[morphRangeStart + v + 1]) after morphDeltaStart. zero targets for static primitives
+    uint32_t morphTargetCount;
+    uint32_t morphDeltaStart;
+    uint32_t morphRangeStart;
 };
 
 struct Mesh {
     std::string name;
     std::vector<MeshPrimitive> meshPrimitives;
+    std::vector<float> weights; // default morph target weights
 };
 
 struct Node {
@@ -104,14 +159,7 @@ struct Node {
     uint32_t skin;
     bool hasSkin;
 
-    glm::mat4 worldTransform = glm::mat4(1.f);
-    glm::mat4 getLocalTransform() {
-        glm::mat4 translationMatrix = glm::translate(glm::mat4(1.f), translation);
-        glm::mat4 rotationMatrix = glm::toMat4(rotation);
-        glm::mat4 scaleMatrix = glm::scale(glm::mat4(1.f), scale);
-
-        return translationMatrix * rotationMatrix * scaleMatrix * matrix;
-    };
+    std::vector<float> weights; // morph target weights of the mesh, animated by eWeights channels
 };
 
 struct AnimationSampler {
@@ -121,9 +169,28 @@ struct AnimationSampler {
         eCubicSpline,
     };
 
+    // how the key values are stored, AnimationClip::compress quantizes translation, rotation and scale samplers
+    enum Encoding {
+        eRaw, // outputs, or weightOutputs
+        eSmallestThree, // rotations, the three smallest components in 15 bits each, see AnimationClip::compress
+        eRangeQuantized, // translations and scales, 16 bits per component of [rangeMin, rangeMin + rangeExtent]
+    };
+
     Interpolation interpolation;
-    std::vector<float> inputs;
+    Encoding encoding = eRaw;
+    std::vector<float> inputs; // key times, empty when frames holds them
     std::vector<glm::vec4> outputs;
+    std::vector<float> weightOutputs; // eWeights samplers instead of outputs, one value per morph target
+
+    // key times on a uniform rate, key i is at startTime + frames[i] * frameTime
+    std::vector<uint16_t> frames;
+    float startTime = 0.f;
+    float frameTime = 0.f;
+
+    // three per key for the quantized encodings
+    std::vector<uint16_t> packedOutputs;
+    glm::vec3 rangeMin = glm::vec3(0.f);
+    glm::vec3 rangeExtent = glm::vec3(0.f);
 };
 
 struct AnimationChannel {
@@ -145,7 +212,6 @@ struct Animation {
     std::vector<AnimationChannel> channels;
     float start = std::numeric_limits<float>::max();
     float end = std::numeric_limits<float>::min();
-    float currentTime = 0.f;
 };
 
 struct Skin {
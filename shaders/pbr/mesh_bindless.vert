@@ -1,5 +1,11 @@
 #version 450
 #extension GL_EXT_buffer_reference : require
+#extension GL_GOOGLE_include_directive : require
+
+#include "VertexFormat.h"
+
+// static primitives skip the skin stream and the joint blend
+layout (constant_id = 0) const bool SKINNED = false;
 
 layout (location = 0) out vec3 outFragPos;
 layout (location = 1) out vec2 outUV;
@@ -26,21 +32,6 @@ layout(std430, set = 0, binding = 4) readonly buffer ModelTransformBuffer {
     mat4 modelTransforms[];
 };
 
-struct Vertex {
-    vec3 position;
-    float uv_x;
-    vec3 normal;
-    float uv_y;
-    vec4 tangent;
-    vec4 bitangent;
-    vec4 jointIndices;
-    vec4 jointWeights;
-};
-
-layout(buffer_reference, std430) readonly buffer VertexBuffer {
-    Vertex vertices[];
-};
-
 //push constants block
 layout(push_constant) uniform constants
 {
@@ -50,36 +41,46 @@ layout(push_constant) uniform constants
     uint jointOffset;
 
     uint modelTransformOffset;
-    float pad[3];
+    SkinBuffer skinBuffer;
+    vec4 positionQuantization;
+    int skinVertexOffset; // added to the vertex index
+    int morphVertexOffset; // added to the vertex index, vertexBuffer holds the blended vertices of morphed draws
+    float pad[2];
 } pc;
 
 void main()
 {
     //load vertex data from device adress
-    Vertex v = pc.vertexBuffer.vertices[gl_VertexIndex];
+    VertexAttributes v = unpackVertex(pc.vertexBuffer.vertices[gl_VertexIndex + pc.morphVertexOffset],
+                                      pc.positionQuantization);
     mat4 transform = transforms[pc.transformOffset];
 
     mat4 modelTransform = modelTransforms[pc.modelTransformOffset + gl_InstanceIndex];
 
-    mat4 skinMatrix =
-    v.jointWeights.x * joints[pc.jointOffset + int(v.jointIndices.x)] +
-    v.jointWeights.y * joints[pc.jointOffset + int(v.jointIndices.y)] +
-    v.jointWeights.z * joints[pc.jointOffset + int(v.jointIndices.z)] +
-    v.jointWeights.w * joints[pc.jointOffset + int(v.jointIndices.w)];
+    mat4 model = modelTransform * transform;
+
+    if (SKINNED) {
+        SkinAttributes skin = unpackSkin(pc.skinBuffer.skinVertices[gl_VertexIndex + pc.skinVertexOffset]);
+
+        mat4 skinMatrix =
+        skin.jointWeights.x * joints[pc.jointOffset + skin.jointIndices.x] +
+        skin.jointWeights.y * joints[pc.jointOffset + skin.jointIndices.y] +
+        skin.jointWeights.z * joints[pc.jointOffset + skin.jointIndices.z] +
+        skin.jointWeights.w * joints[pc.jointOffset + skin.jointIndices.w];
 
-    mat4 model = modelTransform * transform * skinMatrix;
+        model *= skinMatrix;
+    }
 
     outFragPos = vec3(model * vec4(v.position, 1.0));
 
     vec3 T = normalize(mat3(model) * v.tangent.xyz);
-    vec3 B = normalize(mat3(model) * v.bitangent.xyz * v.tangent.w);
     vec3 N = normalize(mat3(transpose(inverse(model))) * v.normal);
+    vec3 B = cross(N, T) * v.tangent.w;
 
     outTBN = mat3(T, B, N);
 
     //output data
     gl_Position = globalUniform.projView * vec4(outFragPos, 1.0);
 
-    outUV.x = v.uv_x;
-    outUV.y = v.uv_y;
+    outUV = v.uv;
 }
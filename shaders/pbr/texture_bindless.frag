@@ -140,7 +140,9 @@ void main()
     vec4 baseColor = toLinear(material.baseColorFactor * texture(displayTexture[nonuniformEXT(material.baseTextureOffset)], inUV));
     vec4 metallicRoughness = texture(displayTexture[nonuniformEXT(material.metallicRoughnessTextureOffset)], inUV);
     vec3 emissive = toLinear(vec4(material.emissiveFactor, 1.0) * texture(displayTexture[nonuniformEXT(material.emissiveTextureOffset)], inUV)).rgb;
-    vec3 n = texture(displayTexture[nonuniformEXT(material.normalTextureOffset)], inUV).rgb;
+    // only xy is stored (BC5), z is rebuilt from the unit length
+    vec2 nxy = texture(displayTexture[nonuniformEXT(material.normalTextureOffset)], inUV).rg * 2.0 - 1.0;
+    vec3 n = vec3(nxy, sqrt(max(1.0 - dot(nxy, nxy), 0.0)));
 
     // green channel for roughness, clamped to 0.089 to avoid division by 0
     float perceivedRoughness = clamp(material.roughnessFactor * metallicRoughness.g, 0.089, 1.0);
@@ -160,7 +162,7 @@ void main()
     vec3 v = normalize(globalUniform.cameraPos - inFragPos);
 
     // normal vector in world space
-    n = normalize(inTBN * (n * 2.0 - 1.0));
+    n = normalize(inTBN * n);
 
     vec3 outColor = vec3(0.0);
 
@@ -0,0 +1,188 @@
+#include "AccessorReader.h"
+
+#include <algorithm>
+#include <cstring>
+#include <limits>
+#include <type_traits>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define VKE_ACCESSOR_SSE2
+#include <emmintrin.h>
+#endif
+
+// normalized integers per the gltf spec: c / max for unsigned, max(c / max, -1) for signed
+template<typename T, bool Normalized>
+static float toFloat(T value) {
+    if constexpr (!Normalized || std::is_same_v<T, float>) {
+        return static_cast<float>(value);
+    } else if constexpr (std::is_signed_v<T>) {
+        return std::max(static_cast<float>(value) / std::numeric_limits<T>::max(), -1.f);
+    } else {
+        return static_cast<float>(value) / std::numeric_limits<T>::max();
+    }
+}
+
+template<typename T, bool Normalized, int N>
+static void readElements(const std::byte *src, size_t stride, size_t begin, size_t end, glm::vec4 *out) {
+    for (size_t element_i = begin; element_i < end; element_i++) {
+        T components[N];
+        memcpy(components, src + element_i * stride, sizeof(components));
+
+        glm::vec4 value(0.f);
+        for (int c = 0; c < N; c++) {
+            value[c] = toFloat<T, Normalized>(components[c]);
+        }
+        out[element_i] = value;
+    }
+}
+
+#ifdef VKE_ACCESSOR_SSE2
+// widens one element per iteration: a single load of 4 components, integer unpack to 32 bits, convert and scale.
+// the load always covers 4 components, so elements whose load would run past the buffer are left to the scalar
+// reader. returns the number of elements read
+template<typename T, bool Normalized, int N>
+static size_t readElementsSse2(const std::byte *src, size_t stride, size_t count, size_t available,
+                               glm::vec4 *out) {
+    constexpr size_t loadSize = sizeof(T) * 4;
+    if (count == 0 || available < loadSize) {
+        return 0;
+    }
+    size_t safeCount = stride == 0 ? count : std::min(count, (available - loadSize) / stride + 1);
+
+    const __m128i zero = _mm_setzero_si128();
+    const __m128 mask = _mm_castsi128_ps(_mm_set_epi32(N > 3 ? -1 : 0, N > 2 ? -1 : 0, N > 1 ? -1 : 0, -1));
+    float scale = 1.f;
+    if constexpr (Normalized && !std::is_same_v<T, float>) {
+        scale = 1.f / std::numeric_limits<T>::max();
+    }
+    const __m128 scaleVector = _mm_set1_ps(scale);
+    const __m128 minusOne = _mm_set1_ps(-1.f);
+
+    for (size_t element_i = 0; element_i < safeCount; element_i++) {
+        const std::byte *element = src + element_i * stride;
+        __m128 value;
+
+        if constexpr (std::is_same_v<T, float>) {
+            value = _mm_loadu_ps(reinterpret_cast<const float *>(element));
+        } else {
+            __m128i widened;
+            if constexpr (sizeof(T) == 2) {
+                __m128i raw = _mm_loadl_epi64(reinterpret_cast<const __m128i *>(element));
+                widened = std::is_signed_v<T> ? _mm_srai_epi32(_mm_unpacklo_epi16(raw, raw), 16)
+                                              : _mm_unpacklo_epi16(raw, zero);
+            } else {
+                int32_t bits;
+                memcpy(&bits, element, sizeof(bits));
+                __m128i raw = _mm_cvtsi32_si128(bits);
+                if constexpr (std::is_signed_v<T>) {
+                    __m128i words = _mm_unpacklo_epi8(raw, raw);
+                    widened = _mm_srai_epi32(_mm_unpacklo_epi16(words, words), 24);
+                } else {
+                    widened = _mm_unpacklo_epi16(_mm_unpacklo_epi8(raw, zero), zero);
+                }
+            }
+
+            value = _mm_cvtepi32_ps(widened);
+            if constexpr (Normalized) {
+                value = _mm_mul_ps(value, scaleVector);
+                if constexpr (std::is_signed_v<T>) {
+                    value = _mm_max_ps(value, minusOne);
+                }
+            }
+        }
+
+        _mm_storeu_ps(&out[element_i].x, _mm_and_ps(value, mask));
+    }
+
+    return safeCount;
+}
+#endif
+
+template<typename T, bool Normalized, int N>
+static void readWithCount(const std::byte *src, size_t stride, size_t count, size_t available, glm::vec4 *out) {
+    size_t done = 0;
+#ifdef VKE_ACCESSOR_SSE2
+    // uint32 doesn't fit the signed conversion
+    if constexpr (!std::is_same_v<T, uint32_t>) {
+        done = readElementsSse2<T, Normalized, N>(src, stride, count, available, out);
+    }
+#endif
+    readElements<T, Normalized, N>(src, stride, done, count, out);
+}
+
+template<typename T, bool Normalized>
+static bool readTyped(const std::byte *src, size_t stride, size_t count, size_t available, size_t components,
+                      glm::vec4 *out) {
+    switch (components) {
+        case 1:
+            readWithCount<T, Normalized, 1>(src, stride, count, available, out);
+            return true;
+        case 2:
+            readWithCount<T, Normalized, 2>(src, stride, count, available, out);
+            return true;
+        case 3:
+            readWithCount<T, Normalized, 3>(src, stride, count, available, out);
+            return true;
+        case 4:
+            readWithCount<T, Normalized, 4>(src, stride, count, available, out);
+            return true;
+        default:
+            return false;
+    }
+}
+
+template<typename T>
+static bool readTyped(const std::byte *src, size_t stride, size_t count, size_t available, size_t components,
+                      bool normalized, glm::vec4 *out) {
+    return normalized ? readTyped<T, true>(src, stride, count, available, components, out)
+                      : readTyped<T, false>(src, stride, count, available, components, out);
+}
+
+bool readAccessor(const cgltf_accessor *accessor, std::vector<glm::vec4> &out) {
+    size_t components = cgltf_num_components(accessor->type);
+    if (components > 4) {
+        return false;
+    }
+
+    out.resize(accessor->count);
+
+    const cgltf_buffer_view *bufferView = accessor->buffer_view;
+    if (accessor->is_sparse || !bufferView || !bufferView->buffer->data) {
+        // cgltf resolves sparse substitutions and accessors without a buffer view
+        for (size_t element_i = 0; element_i < accessor->count; element_i++) {
+            float value[4] = {};
+            cgltf_accessor_read_float(accessor, element_i, value, 4);
+            out[element_i] = glm::vec4(value[0], value[1], value[2], value[3]);
+        }
+        return true;
+    }
+
+    size_t offset = accessor->offset + bufferView->offset;
+    if (offset > bufferView->buffer->size) {
+        return false;
+    }
+    const std::byte *src = static_cast<const std::byte *>(bufferView->buffer->data) + offset;
+    size_t available = bufferView->buffer->size - offset;
+    size_t stride = accessor->stride;
+
+    switch (accessor->component_type) {
+        case cgltf_component_type_r_32f:
+            return readTyped<float>(src, stride, accessor->count, available, components, false, out.data());
+        case cgltf_component_type_r_8:
+            return readTyped<int8_t>(src, stride, accessor->count, available, components, accessor->normalized,
+                                     out.data());
+        case cgltf_component_type_r_8u:
+            return readTyped<uint8_t>(src, stride, accessor->count, available, components, accessor->normalized,
+                                      out.data());
+        case cgltf_component_type_r_16:
+            return readTyped<int16_t>(src, stride, accessor->count, available, components, accessor->normalized,
+                                      out.data());
+        case cgltf_component_type_r_16u:
+            return readTyped<uint16_t>(src, stride, accessor->count, available, components, accessor->normalized,
+                                       out.data());
+        case cgltf_component_type_r_32u:
+            return readTyped<uint32_t>(src, stride, accessor->count, available, components, false, out.data());
+        default:
+            return false;
+    }
+}
@@ -0,0 +1,691 @@
+#include "AnimationClip.h"
+
+#include "AccessorReader.h"
+
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+#include <limits>
+#include <optional>
+
+namespace AnimationClip {
+    Animation parse(const cgltf_data *data, const cgltf_animation *gltfAnimation) {
+        Animation animation = {};
+
+        if (gltfAnimation->name) {
+            animation.name = gltfAnimation->name;
+        }
+
+        for (size_t sampler_i = 0; sampler_i < gltfAnimation->samplers_count; sampler_i++) {
+            const cgltf_animation_sampler *gltfSampler = &gltfAnimation->samplers[sampler_i];
+            AnimationSampler sampler = {};
+
+            switch (gltfSampler->interpolation) {
+                case cgltf_interpolation_type_linear:
+                    sampler.interpolation = AnimationSampler::Interpolation::eLinear;
+                    break;
+                case cgltf_interpolation_type_step:
+                    sampler.interpolation = AnimationSampler::Interpolation::eStep;
+                    break;
+                case cgltf_interpolation_type_cubic_spline:
+                    sampler.interpolation = AnimationSampler::Interpolation::eCubicSpline;
+                    break;
+                default:
+                    sampler.interpolation = AnimationSampler::Interpolation::eLinear;
+                    break;
+            }
+
+            const cgltf_accessor *inputAccessor = gltfSampler->input;
+            const cgltf_buffer_view *inputBufferView = inputAccessor->buffer_view;
+            const auto *inputBuffer = static_cast<const std::byte *>(inputBufferView->buffer->data);
+            const auto *input = reinterpret_cast<const float *>(&inputBuffer[inputAccessor->offset +
+                                                                             inputBufferView->offset]);
+
+            for (size_t input_i = 0; input_i < inputAccessor->count; input_i++) {
+                sampler.inputs.emplace_back(input[input_i]);
+            }
+
+            const cgltf_accessor *outputAccessor = gltfSampler->output;
+            const cgltf_buffer_view *outputBufferView = outputAccessor->buffer_view;
+            const auto *outputBuffer = static_cast<const std::byte *>(outputBufferView->buffer->data);
+
+            switch (outputAccessor->type) {
+                case cgltf_type_vec3: {
+                    const auto *output = reinterpret_cast<const glm::vec3 *>(&outputBuffer[outputAccessor->offset +
+                                                                                           outputBufferView->offset]);
+                    for (size_t output_i = 0; output_i < outputAccessor->count; output_i++) {
+                        sampler.outputs.emplace_back(output[output_i], 0.f);
+                    }
+                    break;
+                }
+                case cgltf_type_vec4: {
+                    const auto *output = reinterpret_cast<const glm::vec4 *>(&outputBuffer[outputAccessor->offset +
+                                                                                           outputBufferView->offset]);
+                    for (size_t output_i = 0; output_i < outputAccessor->count; output_i++) {
+                        sampler.outputs.emplace_back(output[output_i]);
+                    }
+                    break;
+                }
+                case cgltf_type_scalar: {
+                    // morph target weights, may be quantized
+                    std::vector<glm::vec4> output;
+                    if (readAccessor(outputAccessor, output)) {
+                        for (const glm::vec4 &weight: output) {
+                            sampler.weightOutputs.push_back(weight.x);
+                        }
+                    }
+                    break;
+                }
+                default: {
+                    std::cout << "Invalid animation sampler output type" << std::endl;
+                    break;
+                }
+            }
+
+            for (const auto &timestamp: sampler.inputs) {
+                if (timestamp < animation.start) {
+                    animation.start = timestamp;
+                }
+                if (timestamp > animation.end) {
+                    animation.end = timestamp;
+                }
+            }
+
+            animation.samplers.emplace_back(sampler);
+        }
+
+        for (size_t channel_i = 0; channel_i < gltfAnimation->channels_count; channel_i++) {
+            const cgltf_animation_channel *gltfChannel = &gltfAnimation->channels[channel_i];
+            AnimationChannel channel = {};
+
+            switch (gltfChannel->target_path) {
+                case cgltf_animation_path_type_rotation:
+                    channel.path = AnimationChannel::Path::eRotation;
+                    break;
+                case cgltf_animation_path_type_scale:
+                    channel.path = AnimationChannel::Path::eScale;
+                    break;
+                case cgltf_animation_path_type_translation:
+                    channel.path = AnimationChannel::Path::eTranslation;
+                    break;
+                case cgltf_animation_path_type_weights:
+                    channel.path = AnimationChannel::Path::eWeights;
+                    break;
+                default:
+                    std::cout << "Invalid animation channel path" << std::endl;
+                    continue;
+            }
+
+            // out of range indices are dropped by validate
+            channel.nodeIndex = gltfChannel->target_node ? static_cast<uint32_t>(gltfChannel->target_node - data->nodes)
+                                                         : UINT32_MAX;
+            channel.samplerIndex = gltfChannel->sampler - gltfAnimation->samplers;
+
+            animation.channels.emplace_back(channel);
+        }
+
+        return animation;
+    }
+
+    size_t keyCount(const AnimationSampler &sampler) {
+        return sampler.frames.empty() ? sampler.inputs.size() : sampler.frames.size();
+    }
+
+    static bool isPlayable(const AnimationSampler &sampler, AnimationChannel::Path path) {
+        size_t outputsPerKey;
+        switch (sampler.interpolation) {
+            case AnimationSampler::eLinear:
+            case AnimationSampler::eStep:
+                outputsPerKey = 1;
+                break;
+            case AnimationSampler::eCubicSpline:
+                outputsPerKey = 3; // in tangent, value, out tangent
+                break;
+            default:
+                return false;
+        }
+
+        size_t keys = keyCount(sampler);
+        if (keys == 0) {
+            return false;
+        }
+
+        bool timesValid;
+        if (sampler.frames.empty()) {
+            timesValid = std::all_of(sampler.inputs.begin(), sampler.inputs.end(),
+                                     [](float time) { return std::isfinite(time); }) &&
+                         std::is_sorted(sampler.inputs.begin(), sampler.inputs.end());
+        } else {
+            timesValid = std::isfinite(sampler.startTime) && std::isfinite(sampler.frameTime) &&
+                         sampler.frameTime > 0.f && std::is_sorted(sampler.frames.begin(), sampler.frames.end());
+        }
+
+        // weights keys hold one output per morph target, quantized keys are linear or step with three per key
+        bool outputsMatch;
+        switch (sampler.encoding) {
+            case AnimationSampler::eRaw:
+                outputsMatch = path == AnimationChannel::eWeights
+                                   ? !sampler.weightOutputs.empty() &&
+                                     sampler.weightOutputs.size() % (keys * outputsPerKey) == 0
+                                   : sampler.outputs.size() == keys * outputsPerKey;
+                break;
+            case AnimationSampler::eSmallestThree:
+                outputsMatch = path == AnimationChannel::eRotation && outputsPerKey == 1 &&
+                               sampler.packedOutputs.size() == keys * 3;
+                break;
+            case AnimationSampler::eRangeQuantized:
+                outputsMatch = (path == AnimationChannel::eTranslation || path == AnimationChannel::eScale) &&
+                               outputsPerKey == 1 && sampler.packedOutputs.size() == keys * 3 &&
+                               std::isfinite(sampler.rangeMin.x + sampler.rangeMin.y + sampler.rangeMin.z) &&
+                               std::isfinite(sampler.rangeExtent.x + sampler.rangeExtent.y + sampler.rangeExtent.z);
+                break;
+            default:
+                return false;
+        }
+
+        return outputsMatch && timesValid;
+    }
+
+    size_t validate(Animation &animation, size_t nodeCount) {
+        return std::erase_if(animation.channels, [&](const AnimationChannel &channel) {
+            return channel.samplerIndex >= animation.samplers.size() || channel.nodeIndex >= nodeCount ||
+                   !isPlayable(animation.samplers[channel.samplerIndex], channel.path);
+        });
+    }
+
+    // first key in [first, last) after time
+    template<typename KeyTime>
+    static size_t upperBound(const KeyTime &keyTime, size_t first, size_t last, float time) {
+        while (first < last) {
+            size_t middle = first + (last - first) / 2;
+            if (keyTime(middle) <= time) {
+                first = middle + 1;
+            } else {
+                last = middle;
+            }
+        }
+        return first;
+    }
+
+    // findKeyframe over any key time storage, keyTime(i) is the time of key i
+    template<typename KeyTime>
+    static uint32_t findKey(const KeyTime &keyTime, size_t keyCount, float time, uint32_t &cursor) {
+        size_t key = cursor < keyCount ? cursor : 0;
+
+        if (keyTime(key) > time) {
+            // looped or seeked backwards
+            key = upperBound(keyTime, 0, key, time);
+            key = key > 0 ? key - 1 : 0;
+        } else {
+            for (uint32_t step = 0; step < MAX_CURSOR_STEPS && key + 1 < keyCount && keyTime(key + 1) <= time;
+                 step++) {
+                key++;
+            }
+            if (key + 1 < keyCount && keyTime(key + 1) <= time) {
+                key = upperBound(keyTime, key + 1, keyCount, time) - 1;
+            }
+        }
+
+        cursor = static_cast<uint32_t>(key);
+        return cursor;
+    }
+
+    uint32_t findKeyframe(std::span<const float> inputs, float time, uint32_t &cursor) {
+        return findKey([inputs](size_t key) { return inputs[key]; }, inputs.size(), time, cursor);
+    }
+
+    // the keys around time and how far between them it is
+    struct KeySpan {
+        uint32_t key;
+        uint32_t nextKey;
+        float td;
+        float t;
+    };
+
+    static KeySpan findKeySpan(const AnimationSampler &sampler, float time, uint32_t &cursor) {
+        KeySpan span = {};
+        if (sampler.frames.empty()) {
+            span.key = findKeyframe(sampler.inputs, time, cursor);
+            span.nextKey = std::min(span.key + 1, static_cast<uint32_t>(sampler.inputs.size() - 1));
+            span.td = sampler.inputs[span.nextKey] - sampler.inputs[span.key];
+            span.t = span.td > 0.f ? std::clamp((time - sampler.inputs[span.key]) / span.td, 0.f, 1.f) : 0.f;
+            return span;
+        }
+
+        // searched in frames, so the keys stay 16 bit integers
+        float frame = (time - sampler.startTime) / sampler.frameTime;
+        const std::vector<uint16_t> &frames = sampler.frames;
+        span.key = findKey([&frames](size_t key) { return static_cast<float>(frames[key]); }, frames.size(), frame,
+                           cursor);
+        span.nextKey = std::min(span.key + 1, static_cast<uint32_t>(frames.size() - 1));
+        float frameCount = static_cast<float>(frames[span.nextKey] - frames[span.key]);
+        span.td = frameCount * sampler.frameTime;
+        span.t = frameCount > 0.f ? std::clamp((frame - frames[span.key]) / frameCount, 0.f, 1.f) : 0.f;
+        return span;
+    }
+
+    static glm::quat toQuat(glm::vec4 xyzw) {
+        return {xyzw.w, xyzw.x, xyzw.y, xyzw.z};
+    }
+
+    // smallest three: the largest component of a unit quaternion is implied by the others, so only the other three
+    // are stored, each in [-1/sqrt(2), 1/sqrt(2)]. the largest one's index goes in the top bits of the first two
+    constexpr float SMALLEST_THREE_RANGE = 0.70710678f;
+    constexpr float SMALLEST_THREE_STEPS = 32767.f;
+    constexpr float RANGE_STEPS = 65535.f;
+
+    static void packSmallestThree(glm::vec4 q, uint16_t *packed) {
+        int largest = 0;
+        for (int component_i = 1; component_i < 4; component_i++) {
+            if (std::abs(q[component_i]) > std::abs(q[largest])) {
+                largest = component_i;
+            }
+        }
+        // q and -q are the same rotation, keep the implied component positive
+        if (q[largest] < 0.f) {
+            q = -q;
+        }
+
+        int packed_i = 0;
+        for (int component_i = 0; component_i < 4; component_i++) {
+            if (component_i == largest) {
+                continue;
+            }
+            float unit = std::clamp(q[component_i] / SMALLEST_THREE_RANGE * 0.5f + 0.5f, 0.f, 1.f);
+            packed[packed_i++] = static_cast<uint16_t>(std::lround(unit * SMALLEST_THREE_STEPS));
+        }
+        packed[0] |= static_cast<uint16_t>((largest & 1) << 15);
+        packed[1] |= static_cast<uint16_t>((largest >> 1) << 15);
+    }
+
+    static glm::vec4 unpackSmallestThree(const uint16_t *packed) {
+        int largest = (packed[0] >> 15) | (packed[1] >> 15) << 1;
+
+        glm::vec4 q;
+        float sum = 0.f;
+        int packed_i = 0;
+        for (int component_i = 0; component_i < 4; component_i++) {
+            if (component_i == largest) {
+                continue;
+            }
+            float unit = static_cast<float>(packed[packed_i++] & 0x7fff) / SMALLEST_THREE_STEPS;
+            q[component_i] = (unit * 2.f - 1.f) * SMALLEST_THREE_RANGE;
+            sum += q[component_i] * q[component_i];
+        }
+        q[largest] = std::sqrt(std::max(1.f - sum, 0.f));
+        return q;
+    }
+
+    static void packRange(glm::vec3 value, glm::vec3 rangeMin, glm::vec3 rangeExtent, uint16_t *packed) {
+        for (int component_i = 0; component_i < 3; component_i++) {
+            float unit = rangeExtent[component_i] > 0.f
+                             ? std::clamp((value[component_i] - rangeMin[component_i]) / rangeExtent[component_i],
+                                          0.f, 1.f)
+                             : 0.f;
+            packed[component_i] = static_cast<uint16_t>(std::lround(unit * RANGE_STEPS));
+        }
+    }
+
+    // value of a linear or step key
+    static glm::vec4 keyValue(const AnimationSampler &sampler, uint32_t key) {
+        switch (sampler.encoding) {
+            case AnimationSampler::eSmallestThree:
+                return unpackSmallestThree(&sampler.packedOutputs[key * 3]);
+            case AnimationSampler::eRangeQuantized: {
+                const uint16_t *packed = &sampler.packedOutputs[key * 3];
+                glm::vec3 unit = glm::vec3(packed[0], packed[1], packed[2]) / RANGE_STEPS;
+                return {sampler.rangeMin + unit * sampler.rangeExtent, 0.f};
+            }
+            case AnimationSampler::eRaw:
+            default:
+                return sampler.outputs[key];
+        }
+    }
+
+    static glm::vec4 interpolate(AnimationChannel::Path path, glm::vec4 from, glm::vec4 to, float t) {
+        if (path == AnimationChannel::eRotation) {
+            glm::quat q = glm::normalize(glm::slerp(toQuat(from), toQuat(to), t));
+            return {q.x, q.y, q.z, q.w};
+        }
+        return glm::mix(from, to, t);
+    }
+
+    glm::vec4 sample(const AnimationSampler &sampler, AnimationChannel::Path path, float time, uint32_t &cursor) {
+        auto [key, nextKey, td, t] = findKeySpan(sampler, time, cursor);
+
+        switch (sampler.interpolation) {
+            case AnimationSampler::eStep: {
+                return keyValue(sampler, key);
+            }
+            case AnimationSampler::eCubicSpline: {
+                float t2 = t * t;
+                float t3 = t2 * t;
+
+                glm::vec4 vk = sampler.outputs[key * 3 + 1];
+                glm::vec4 bk = sampler.outputs[key * 3 + 2];
+                glm::vec4 ak_p1 = sampler.outputs[nextKey * 3];
+                glm::vec4 vk_p1 = sampler.outputs[nextKey * 3 + 1];
+
+                // calculation per gltf spec
+                glm::vec4 result = (2 * t3 - 3 * t2 + 1) * vk +
+                                   td * (t3 - 2 * t2 + t) * bk +
+                                   (-2 * t3 + 3 * t2) * vk_p1 +
+                                   td * (t3 - t2) * ak_p1;
+
+                return path == AnimationChannel::eRotation ? glm::normalize(result) : result;
+            }
+            case AnimationSampler::eLinear:
+            default: {
+                return interpolate(path, keyValue(sampler, key), keyValue(sampler, nextKey), t);
+            }
+        }
+    }
+
+    void sampleWeights(const AnimationSampler &sampler, float time, uint32_t &cursor, std::span<float> weights) {
+        auto [key, nextKey, td, t] = findKeySpan(sampler, time, cursor);
+
+        size_t outputsPerKey = sampler.interpolation == AnimationSampler::eCubicSpline ? 3 : 1;
+        size_t targetCount = sampler.weightOutputs.size() / (keyCount(sampler) * outputsPerKey);
+        size_t count = std::min(targetCount, weights.size());
+        const float *current = &sampler.weightOutputs[key * outputsPerKey * targetCount];
+        const float *next = &sampler.weightOutputs[nextKey * outputsPerKey * targetCount];
+
+        switch (sampler.interpolation) {
+            case AnimationSampler::eStep: {
+                std::copy_n(current, count, weights.begin());
+                break;
+            }
+            case AnimationSampler::eCubicSpline: {
+                float t2 = t * t;
+                float t3 = t2 * t;
+
+                // keys are laid out as all in tangents, all values, all out tangents
+                for (size_t target_i = 0; target_i < count; target_i++) {
+                    float vk = current[targetCount + target_i];
+                    float bk = current[2 * targetCount + target_i];
+                    float ak_p1 = next[target_i];
+                    float vk_p1 = next[targetCount + target_i];
+                    weights[target_i] = (2 * t3 - 3 * t2 + 1) * vk +
+                                        td * (t3 - 2 * t2 + t) * bk +
+                                        (-2 * t3 + 3 * t2) * vk_p1 +
+                                        td * (t3 - t2) * ak_p1;
+                }
+                break;
+            }
+            case AnimationSampler::eLinear:
+            default: {
+                for (size_t target_i = 0; target_i < count; target_i++) {
+                    weights[target_i] = glm::mix(current[target_i], next[target_i], t);
+                }
+                break;
+            }
+        }
+    }
+
+    // distance between two values of a channel, in the unit of its tolerance. for unit quaternions the chord
+    // length is about half the angle between them, and unlike acos of the dot product it stays precise near zero
+    static float keyError(AnimationChannel::Path path, glm::vec4 a, glm::vec4 b) {
+        if (path == AnimationChannel::eRotation) {
+            return 2.f * glm::length(glm::dot(a, b) < 0.f ? a + b : a - b);
+        }
+        return glm::length(glm::vec3(a) - glm::vec3(b));
+    }
+
+    static float tolerance(AnimationChannel::Path path) {
+        switch (path) {
+            case AnimationChannel::eRotation:
+                return ROTATION_TOLERANCE;
+            case AnimationChannel::eScale:
+                return SCALE_TOLERANCE;
+            case AnimationChannel::eTranslation:
+            default:
+                return TRANSLATION_TOLERANCE;
+        }
+    }
+
+    // samples a cubic spline sampler into linear keys, evenly spaced over its keys so the last one lands on the end
+    static void bakeCubicSpline(const AnimationSampler &sampler, AnimationChannel::Path path,
+                                std::vector<float> &times, std::vector<glm::vec4> &values) {
+        float start = sampler.inputs.front();
+        float duration = sampler.inputs.back() - start;
+
+        float minDelta = MAX_BAKE_FRAME_TIME;
+        for (size_t key = 1; key < sampler.inputs.size(); key++) {
+            float delta = sampler.inputs[key] - sampler.inputs[key - 1];
+            if (delta > 0.f) {
+                minDelta = std::min(minDelta, delta);
+            }
+        }
+        float frameTime = std::max(minDelta, MIN_BAKE_FRAME_TIME);
+        size_t frameCount = duration > 0.f ? static_cast<size_t>(std::ceil(duration / frameTime)) : 0;
+
+        uint32_t cursor = 0;
+        for (size_t frame = 0; frame <= frameCount; frame++) {
+            float time = frame == frameCount ? sampler.inputs.back()
+                                             : start + duration * static_cast<float>(frame) /
+                                                       static_cast<float>(frameCount);
+            times.push_back(time);
+            values.push_back(sample(sampler, path, time, cursor));
+        }
+    }
+
+    // frame length the key times are multiples of, or 0 when they aren't on a uniform rate
+    static float uniformFrameTime(std::span<const float> times, std::span<const size_t> keptKeys) {
+        float frameTime = std::numeric_limits<float>::max();
+        for (size_t key = 1; key < times.size(); key++) {
+            float delta = times[key] - times[key - 1];
+            if (delta > 0.f) {
+                frameTime = std::min(frameTime, delta);
+            }
+        }
+        if (frameTime == std::numeric_limits<float>::max()) {
+            return 0.f;
+        }
+
+        for (size_t key: keptKeys) {
+            float frame = (times[key] - times.front()) / frameTime;
+            if (std::abs(frame - std::round(frame)) > 1e-3f || std::round(frame) > 65535.f) {
+                return 0.f;
+            }
+        }
+        return frameTime;
+    }
+
+    static void compressSampler(AnimationSampler &sampler, AnimationChannel::Path path) {
+        std::vector<float> times;
+        std::vector<glm::vec4> values;
+        if (sampler.interpolation == AnimationSampler::eCubicSpline) {
+            bakeCubicSpline(sampler, path, times, values);
+            sampler.interpolation = AnimationSampler::eLinear;
+        } else {
+            times = sampler.inputs;
+            values = sampler.outputs;
+        }
+        if (path == AnimationChannel::eRotation) {
+            for (glm::vec4 &value: values) {
+                value = glm::normalize(value);
+            }
+        }
+
+        // quantize every key first, so dropping keys is checked against what playback will actually decode
+        AnimationSampler quantized = {};
+        quantized.interpolation = sampler.interpolation;
+        if (path == AnimationChannel::eRotation) {
+            quantized.encoding = AnimationSampler::eSmallestThree;
+            quantized.packedOutputs.resize(values.size() * 3);
+            for (size_t key = 0; key < values.size(); key++) {
+                packSmallestThree(values[key], &quantized.packedOutputs[key * 3]);
+            }
+        } else {
+            glm::vec3 rangeMax(std::numeric_limits<float>::lowest());
+            quantized.rangeMin = glm::vec3(std::numeric_limits<float>::max());
+            for (const glm::vec4 &value: values) {
+                quantized.rangeMin = glm::min(quantized.rangeMin, glm::vec3(value));
+                rangeMax = glm::max(rangeMax, glm::vec3(value));
+            }
+            quantized.encoding = AnimationSampler::eRangeQuantized;
+            quantized.rangeExtent = rangeMax - quantized.rangeMin;
+            quantized.packedOutputs.resize(values.size() * 3);
+            for (size_t key = 0; key < values.size(); key++) {
+                packRange(values[key], quantized.rangeMin, quantized.rangeExtent, &quantized.packedOutputs[key * 3]);
+            }
+        }
+
+        // greedily extend each span from the last kept key while interpolating across it stays within tolerance
+        float maxError = tolerance(path);
+        std::vector<size_t> keptKeys = {0};
+        size_t anchor = 0;
+        for (size_t key = 2; key < values.size(); key++) {
+            glm::vec4 from = keyValue(quantized, anchor);
+            glm::vec4 to = keyValue(quantized, key);
+            float td = times[key] - times[anchor];
+
+            bool fits = true;
+            for (size_t inner = anchor + 1; inner < key && fits; inner++) {
+                glm::vec4 predicted = from;
+                if (sampler.interpolation == AnimationSampler::eLinear) {
+                    float t = td > 0.f ? (times[inner] - times[anchor]) / td : 0.f;
+                    predicted = interpolate(path, from, to, t);
+                }
+                fits = keyError(path, predicted, values[inner]) <= maxError;
+            }
+            if (!fits) {
+                anchor = key - 1;
+                keptKeys.push_back(anchor);
+            }
+        }
+        if (values.size() > 1) {
+            keptKeys.push_back(values.size() - 1);
+        }
+
+        sampler.encoding = quantized.encoding;
+        sampler.rangeMin = quantized.rangeMin;
+        sampler.rangeExtent = quantized.rangeExtent;
+        sampler.packedOutputs.clear();
+        for (size_t key: keptKeys) {
+            const uint16_t *packed = quantized.packedOutputs.data() + key * 3;
+            sampler.packedOutputs.insert(sampler.packedOutputs.end(), packed, packed + 3);
+        }
+        sampler.outputs.clear();
+        sampler.outputs.shrink_to_fit();
+
+        sampler.inputs.clear();
+        sampler.frames.clear();
+        float frameTime = uniformFrameTime(times, keptKeys);
+        if (frameTime > 0.f) {
+            sampler.startTime = times.front();
+            sampler.frameTime = frameTime;
+            for (size_t key: keptKeys) {
+                sampler.frames.push_back(static_cast<uint16_t>(std::lround((times[key] - times.front()) / frameTime)));
+            }
+        } else {
+            for (size_t key: keptKeys) {
+                sampler.inputs.push_back(times[key]);
+            }
+        }
+        sampler.inputs.shrink_to_fit();
+    }
+
+    void compress(Animation &animation) {
+        for (size_t sampler_i = 0; sampler_i < animation.samplers.size(); sampler_i++) {
+            AnimationSampler &sampler = animation.samplers[sampler_i];
+            if (sampler.encoding != AnimationSampler::eRaw || keyCount(sampler) == 0) {
+                continue;
+            }
+
+            // a sampler shared by channels of different paths would need both encodings, leave it raw
+            std::optional<AnimationChannel::Path> path;
+            bool mixed = false;
+            for (const auto &channel: animation.channels) {
+                if (channel.samplerIndex == sampler_i) {
+                    mixed = mixed || (path && *path != channel.path);
+                    path = channel.path;
+                }
+            }
+            if (path && !mixed && *path != AnimationChannel::eWeights) {
+                compressSampler(sampler, *path);
+            }
+        }
+    }
+
+    size_t memorySize(const Animation &animation) {
+        size_t size = 0;
+        for (const auto &sampler: animation.samplers) {
+            size += sampler.inputs.size() * sizeof(float) + sampler.outputs.size() * sizeof(glm::vec4) +
+                    sampler.weightOutputs.size() * sizeof(float) + sampler.frames.size() * sizeof(uint16_t) +
+                    sampler.packedOutputs.size() * sizeof(uint16_t);
+        }
+        return size + animation.channels.size() * sizeof(AnimationChannel);
+    }
+
+    Pose restPose(std::span<const std::shared_ptr<Node> > nodes) {
+        Pose pose;
+        pose.weightOffsets.push_back(0);
+        for (const auto &node: nodes) {
+            pose.translations.push_back(node->translation);
+            pose.rotations.push_back(node->rotation);
+            pose.scales.push_back(node->scale);
+            pose.weights.insert(pose.weights.end(), node->weights.begin(), node->weights.end());
+            pose.weightOffsets.push_back(static_cast<uint32_t>(pose.weights.size()));
+        }
+        pose.localTransforms.assign(nodes.size(), glm::mat4(1.f));
+        pose.worldTransforms.assign(nodes.size(), glm::mat4(1.f));
+        pose.nodeFlags.assign(nodes.size(), Pose::eLocalChanged);
+        for (size_t node_i = 0; node_i < nodes.size(); node_i++) {
+            pose.changedNodes.push_back(static_cast<uint32_t>(node_i));
+        }
+        return pose;
+    }
+
+    // values a paused clip or a held key writes again don't flag the node
+    template<typename T>
+    static void setLocal(Pose &pose, uint32_t node, T &target, const T &value) {
+        if (target == value) {
+            return;
+        }
+        target = value;
+        if (!(pose.nodeFlags[node] & Pose::eLocalChanged)) {
+            pose.nodeFlags[node] |= Pose::eLocalChanged;
+            pose.changedNodes.push_back(node);
+        }
+    }
+
+    void play(const Animation &animation, AnimationState &state, float deltaTime, Pose &pose) {
+        state.time += deltaTime * state.speed;
+        if (animation.end > 0.f && (state.time > animation.end || state.time < 0.f)) {
+            state.time = std::fmod(state.time, animation.end);
+            if (state.time < 0.f) {
+                state.time += animation.end;
+            }
+        }
+        state.cursors.resize(animation.samplers.size());
+
+        for (const auto &channel: animation.channels) {
+            const AnimationSampler &sampler = animation.samplers[channel.samplerIndex];
+            uint32_t &cursor = state.cursors[channel.samplerIndex];
+            uint32_t node = channel.nodeIndex;
+
+            if (channel.path == AnimationChannel::eWeights) {
+                std::span<float> weights(pose.weights.data() + pose.weightOffsets[node],
+                                         pose.weightOffsets[node + 1] - pose.weightOffsets[node]);
+                sampleWeights(sampler, state.time, cursor, weights);
+                continue;
+            }
+            glm::vec4 value = sample(sampler, channel.path, state.time, cursor);
+
+            switch (channel.path) {
+                case AnimationChannel::eTranslation:
+                    setLocal(pose, node, pose.translations[node], glm::vec3(value));
+                    break;
+                case AnimationChannel::eRotation:
+                    setLocal(pose, node, pose.rotations[node], toQuat(value));
+                    break;
+                case AnimationChannel::eScale:
+                    setLocal(pose, node, pose.scales[node], glm::vec3(value));
+                    break;
+                case AnimationChannel::eWeights:
+                    break; // sampled above
+            }
+        }
+    }
+}
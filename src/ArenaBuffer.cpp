@@ -0,0 +1,103 @@
+#include "ArenaBuffer.h"
+
+#include <algorithm>
+
+#include "VulkanContext.h"
+
+void ArenaBuffer::init(VulkanContext *vulkanContext, size_t elementSize, uint32_t chunkElements,
+                       VkBufferUsageFlags usage) {
+    m_vulkanContext = vulkanContext;
+    m_elementSize = elementSize;
+    m_chunkElements = chunkElements;
+    m_usage = usage | VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_TRANSFER_SRC_BIT;
+
+    grow(chunkElements, 0);
+}
+
+void ArenaBuffer::terminate() {
+    for (const auto &buffer: m_retiredBuffers) {
+        m_vulkanContext->destroyBuffer(buffer);
+    }
+    m_retiredBuffers.clear();
+
+    if (m_buffer.buffer != VK_NULL_HANDLE) {
+        m_vulkanContext->destroyBuffer(m_buffer);
+        m_buffer = {};
+    }
+    m_capacity = 0;
+    m_ranges.reset(0);
+}
+
+uint32_t ArenaBuffer::allocate(uint32_t count) {
+    uint32_t used = m_ranges.size();
+    uint32_t offset = m_ranges.allocate(count);
+    if (offset + count > m_capacity) {
+        grow(offset + count, used);
+    }
+    return offset;
+}
+
+void ArenaBuffer::free(uint32_t offset, uint32_t count) {
+    m_ranges.free(offset, count);
+}
+
+void ArenaBuffer::upload(uint32_t offset, const void *data, uint32_t count) {
+    m_vulkanContext->uploadManager.uploadBuffer(m_buffer.buffer, offset * m_elementSize, data,
+                                                count * m_elementSize);
+}
+
+bool ArenaBuffer::fragmented() const {
+    return m_ranges.freeCount() * 4 > m_ranges.size() || m_capacity > chunkCapacity(m_ranges.size()) + m_chunkElements;
+}
+
+std::vector<uint32_t> ArenaBuffer::compact(VkCommandBuffer cmd,
+                                           std::span<const std::pair<uint32_t, uint32_t>> ranges) {
+    std::vector<uint32_t> offsets;
+    std::vector<VkBufferCopy> copies;
+    uint32_t size = 0;
+    for (const auto &[offset, count]: ranges) {
+        offsets.push_back(size);
+        if (count != 0) {
+            copies.push_back({offset * m_elementSize, size * m_elementSize, count * m_elementSize});
+        }
+        size += count;
+    }
+
+    uint32_t capacity = chunkCapacity(size);
+    VulkanBuffer buffer = m_vulkanContext->createBuffer(capacity * m_elementSize, m_usage,
+                                                        VMA_ALLOCATION_CREATE_DEDICATED_MEMORY_BIT);
+    if (!copies.empty()) {
+        vkCmdCopyBuffer(cmd, m_buffer.buffer, buffer.buffer, copies.size(), copies.data());
+    }
+
+    m_retiredBuffers.push_back(m_buffer);
+    m_buffer = buffer;
+    m_capacity = capacity;
+    m_ranges.reset(size);
+
+    return offsets;
+}
+
+std::vector<VulkanBuffer> ArenaBuffer::takeRetiredBuffers() {
+    return std::move(m_retiredBuffers);
+}
+
+uint32_t ArenaBuffer::chunkCapacity(uint32_t count) const {
+    uint32_t chunkCount = std::max((count + m_chunkElements - 1) / m_chunkElements, 1u);
+    return chunkCount * m_chunkElements;
+}
+
+void ArenaBuffer::grow(uint32_t minCapacity, uint32_t copyCount) {
+    uint32_t capacity = std::max(chunkCapacity(minCapacity), m_capacity + m_chunkElements);
+
+    VulkanBuffer buffer = m_vulkanContext->createBuffer(capacity * m_elementSize, m_usage,
+                                                        VMA_ALLOCATION_CREATE_DEDICATED_MEMORY_BIT);
+
+    if (m_buffer.buffer != VK_NULL_HANDLE) {
+        m_vulkanContext->uploadManager.copyBuffer(m_buffer.buffer, buffer.buffer, copyCount * m_elementSize);
+        m_retiredBuffers.push_back(m_buffer);
+    }
+
+    m_buffer = buffer;
+    m_capacity = capacity;
+}
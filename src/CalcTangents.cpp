@@ -1,29 +1,41 @@
 #include "CalcTangents.h"
 
-CalcTangents::CalcTangents() {
-    m_interface.m_getNumFaces = getNumFaces;
-    m_interface.m_getNumVerticesOfFace = getNumVerticesOfFace;
-    m_interface.m_getPosition = getPosition;
-    m_interface.m_getNormal = getNormal;
-    m_interface.m_getTexCoord = getTexCoord;
-    m_interface.m_setTSpaceBasic = setTSpaceBasic;
-
-    m_context.m_pInterface = &m_interface;
+#include "ThreadPool.h"
+
+// what the mikktspace callbacks see through m_pUserData, one per primitive so primitives can run concurrently
+struct MikkTSpaceJob {
+    std::span<const uint32_t> indices;
+    const TangentStreams *streams;
+};
+
+static uint32_t vertexIndex(const SMikkTSpaceContext *pContext, int iFace, int iVert) {
+    const auto *job = static_cast<const MikkTSpaceJob *>(pContext->m_pUserData);
+
+    return job->indices[iFace * 3 + iVert];
 }
 
-int CalcTangents::getVertexIndex(const SMikkTSpaceContext *pContext, int iFace, int iVert) {
-    const auto *data = static_cast<const CalcTangentData *>(pContext->m_pUserData);
+TangentStreams TangentStreams::fromVertices(std::vector<Vertex> &vertices) {
+    auto *base = reinterpret_cast<std::byte *>(vertices.data());
+    constexpr size_t stride = sizeof(Vertex);
 
-    auto faceSize = getNumVerticesOfFace(pContext, iFace);
-    auto indicesIndex = (iFace * faceSize) + iVert + data->primitive.indexStart;
+    TangentStreams streams = {};
+    streams.positions = {base + offsetof(Vertex, position), stride};
+    streams.normals = {base + offsetof(Vertex, normal), stride};
+    streams.u = {base + offsetof(Vertex, uv_x), stride};
+    streams.v = {base + offsetof(Vertex, uv_y), stride};
+    streams.tangents = {base + offsetof(Vertex, tangent), stride};
+    streams.bitangents = {base + offsetof(Vertex, bitangent), stride};
+
+    return streams;
+}
 
-    return static_cast<int>(data->indices[indicesIndex]);
+CalcTangents::CalcTangents(ThreadPool *threadPool, TangentMode mode) : m_threadPool(threadPool), m_mode(mode) {
 }
 
 int CalcTangents::getNumFaces(const SMikkTSpaceContext *pContext) {
-    const auto *data = static_cast<const CalcTangentData *>(pContext->m_pUserData);
+    const auto *job = static_cast<const MikkTSpaceJob *>(pContext->m_pUserData);
 
-    return static_cast<int>(data->primitive.indexCount / 3);
+    return static_cast<int>(job->indices.size() / 3);
 }
 
 int CalcTangents::getNumVerticesOfFace(const SMikkTSpaceContext *pContext, const int iFace) {
@@ -31,51 +43,138 @@ int CalcTangents::getNumVerticesOfFace(const SMikkTSpaceContext *pContext, const
 }
 
 void CalcTangents::getPosition(const SMikkTSpaceContext *pContext, float *fvPosOut, const int iFace, const int iVert) {
-    const auto *data = static_cast<const CalcTangentData *>(pContext->m_pUserData);
+    const auto *job = static_cast<const MikkTSpaceJob *>(pContext->m_pUserData);
+    const glm::vec3 &position = job->streams->positions[vertexIndex(pContext, iFace, iVert)];
 
-    auto index = getVertexIndex(pContext, iFace, iVert);
-    auto vertex = data->vertices[index];
-
-    fvPosOut[0] = vertex.position.x;
-    fvPosOut[1] = vertex.position.y;
-    fvPosOut[2] = vertex.position.z;
+    fvPosOut[0] = position.x;
+    fvPosOut[1] = position.y;
+    fvPosOut[2] = position.z;
 }
 
 void CalcTangents::getNormal(const SMikkTSpaceContext *pContext, float *fvNormOut, const int iFace, const int iVert) {
-    const auto *data = static_cast<const CalcTangentData *>(pContext->m_pUserData);
-
-    auto index = getVertexIndex(pContext, iFace, iVert);
-    auto vertex = data->vertices[index];
+    const auto *job = static_cast<const MikkTSpaceJob *>(pContext->m_pUserData);
+    const glm::vec3 &normal = job->streams->normals[vertexIndex(pContext, iFace, iVert)];
 
-    fvNormOut[0] = vertex.normal.x;
-    fvNormOut[1] = vertex.normal.y;
-    fvNormOut[2] = vertex.normal.z;
+    fvNormOut[0] = normal.x;
+    fvNormOut[1] = normal.y;
+    fvNormOut[2] = normal.z;
 }
 
 void CalcTangents::getTexCoord(const SMikkTSpaceContext *pContext, float *fvTexcOut, const int iFace, const int iVert) {
-    const auto *data = static_cast<const CalcTangentData *>(pContext->m_pUserData);
+    const auto *job = static_cast<const MikkTSpaceJob *>(pContext->m_pUserData);
+    uint32_t index = vertexIndex(pContext, iFace, iVert);
 
-    auto index = getVertexIndex(pContext, iFace, iVert);
-    auto vertex = data->vertices[index];
-
-    fvTexcOut[0] = vertex.uv_x;
-    fvTexcOut[1] = vertex.uv_y;
+    fvTexcOut[0] = job->streams->u[index];
+    fvTexcOut[1] = job->streams->v[index];
 }
 
 void CalcTangents::setTSpaceBasic(const SMikkTSpaceContext *pContext, const float *fvTangent, const float fSign,
                                   const int iFace, const int iVert) {
-    const auto *data = static_cast<const CalcTangentData *>(pContext->m_pUserData);
-    auto index = getVertexIndex(pContext, iFace, iVert);
-    auto *vertex = &data->vertices[index];
-
-    vertex->tangent.x = fvTangent[0];
-    vertex->tangent.y = fvTangent[1];
-    vertex->tangent.z = fvTangent[2];
-    vertex->tangent.w = fSign;
+    const auto *job = static_cast<const MikkTSpaceJob *>(pContext->m_pUserData);
+
+    job->streams->tangents[vertexIndex(pContext, iFace, iVert)] =
+            glm::vec4(fvTangent[0], fvTangent[1], fvTangent[2], fSign);
 }
 
-void CalcTangents::calculate(CalcTangentData *data) {
-    m_context.m_pUserData = data;
+void CalcTangents::calculateMikkTSpace(std::span<const uint32_t> indices, const TangentStreams &streams) {
+    SMikkTSpaceInterface mikkInterface = {};
+    mikkInterface.m_getNumFaces = getNumFaces;
+    mikkInterface.m_getNumVerticesOfFace = getNumVerticesOfFace;
+    mikkInterface.m_getPosition = getPosition;
+    mikkInterface.m_getNormal = getNormal;
+    mikkInterface.m_getTexCoord = getTexCoord;
+    mikkInterface.m_setTSpaceBasic = setTSpaceBasic;
+
+    MikkTSpaceJob job = {indices, &streams};
+
+    SMikkTSpaceContext context = {};
+    context.m_pInterface = &mikkInterface;
+    context.m_pUserData = &job;
+
+    genTangSpaceDefault(&context);
+}
+
+void CalcTangents::calculateFast(std::span<const uint32_t> indices, const TangentStreams &streams,
+                                 const MeshPrimitive &primitive) {
+    std::vector<glm::vec3> tangentSums(primitive.vertexCount, glm::vec3(0.f));
+    std::vector<glm::vec3> bitangentSums(primitive.vertexCount, glm::vec3(0.f));
+
+    for (size_t face_i = 0; face_i + 2 < indices.size(); face_i += 3) {
+        uint32_t i0 = indices[face_i];
+        uint32_t i1 = indices[face_i + 1];
+        uint32_t i2 = indices[face_i + 2];
+
+        glm::vec3 edge1 = streams.positions[i1] - streams.positions[i0];
+        glm::vec3 edge2 = streams.positions[i2] - streams.positions[i0];
+        float du1 = streams.u[i1] - streams.u[i0];
+        float dv1 = streams.v[i1] - streams.v[i0];
+        float du2 = streams.u[i2] - streams.u[i0];
+        float dv2 = streams.v[i2] - streams.v[i0];
+
+        float determinant = du1 * dv2 - du2 * dv1;
+        if (std::abs(determinant) < 1e-12f) {
+            continue; // degenerate uv mapping
+        }
+
+        glm::vec3 tangent = (edge1 * dv2 - edge2 * dv1) / determinant;
+        glm::vec3 bitangent = (edge2 * du1 - edge1 * du2) / determinant;
+
+        for (uint32_t index: {i0, i1, i2}) {
+            uint32_t local = index - primitive.vertexStart;
+            if (local < primitive.vertexCount) {
+                tangentSums[local] += tangent;
+                bitangentSums[local] += bitangent;
+            }
+        }
+    }
+
+    for (uint32_t local = 0; local < primitive.vertexCount; local++) {
+        uint32_t vertex_i = primitive.vertexStart + local;
+        const glm::vec3 &normal = streams.normals[vertex_i];
+
+        // gram-schmidt, falling back to any vector perpendicular to the normal
+        glm::vec3 tangent = tangentSums[local] - normal * glm::dot(normal, tangentSums[local]);
+        if (glm::dot(tangent, tangent) < 1e-12f) {
+            tangent = glm::cross(normal, std::abs(normal.x) < 0.9f ? glm::vec3(1.f, 0.f, 0.f)
+                                                                   : glm::vec3(0.f, 1.f, 0.f));
+        }
+        tangent = glm::normalize(tangent);
+
+        float sign = glm::dot(glm::cross(normal, tangent), bitangentSums[local]) < 0.f ? -1.f : 1.f;
+        streams.tangents[vertex_i] = glm::vec4(tangent, sign);
+    }
+}
+
+void CalcTangents::calculate(std::span<const uint32_t> indices, const TangentStreams &streams,
+                             std::span<const MeshPrimitive> primitives) const {
+    auto calculatePrimitive = [&](size_t primitive_i) {
+        const MeshPrimitive &primitive = primitives[primitive_i];
+        std::span<const uint32_t> primitiveIndices = indices.subspan(primitive.indexStart, primitive.indexCount);
+
+        if (m_mode == TangentMode::eFast) {
+            calculateFast(primitiveIndices, streams, primitive);
+        } else {
+            calculateMikkTSpace(primitiveIndices, streams);
+        }
+
+        for (uint32_t vertex_i = primitive.vertexStart; vertex_i < primitive.vertexStart + primitive.vertexCount;
+             vertex_i++) {
+            const glm::vec4 &tangent = streams.tangents[vertex_i];
+            streams.bitangents[vertex_i] = glm::vec4(glm::cross(streams.normals[vertex_i], glm::vec3(tangent)),
+                                                     tangent.w);
+        }
+    };
+
+    if (m_threadPool && primitives.size() > 1) {
+        m_threadPool->parallelFor(primitives.size(), calculatePrimitive);
+    } else {
+        for (size_t primitive_i = 0; primitive_i < primitives.size(); primitive_i++) {
+            calculatePrimitive(primitive_i);
+        }
+    }
+}
 
-    genTangSpaceDefault(&this->m_context);
+void CalcTangents::calculate(std::span<const uint32_t> indices, std::vector<Vertex> &vertices,
+                             std::span<const MeshPrimitive> primitives) const {
+    calculate(indices, TangentStreams::fromVertices(vertices), primitives);
 }
@@ -10,11 +10,28 @@
 #include <glm/gtc/type_ptr.hpp>
 #include <glm/gtx/quaternion.hpp>
 #include <stb_image.h>
+#include <algorithm>
 #include <iostream>
 #include <Utils.h>
+#include <limits>
 #include <numeric>
-
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <stack>
+#include <thread>
+#include <unordered_map>
+
+#include "AccessorReader.h"
+#include "AnimationClip.h"
 #include "CalcTangents.h"
+#include "ImageCache.h"
+#include "MeshOptimizer.h"
+#include "SceneCache.h"
+#include "TextureEncoder.h"
+#include "TextureFile.h"
+#include "VertexFormat.h"
+#include "ThreadPool.h"
 #include "VulkanUtils.h"
 
 void GltfScene::parseTextures(const cgltf_data *data) {
@@ -27,10 +44,7 @@ void GltfScene::parseTextures(const cgltf_data *data) {
         samplerInfo.mipmapMode = VK_SAMPLER_MIPMAP_MODE_LINEAR;
         samplerInfo.maxLod = 16.f;
 
-        VkSampler sampler;
-        vkCreateSampler(m_vulkanContext->device, &samplerInfo, nullptr, &sampler);
-
-        samplers.emplace_back(sampler);
+        samplers.emplace_back(m_vulkanContext->acquireSampler(samplerInfo));
     }
 
     for (auto sampler_i = 0; sampler_i < data->samplers_count; sampler_i++) {
@@ -42,12 +56,9 @@ void GltfScene::parseTextures(const cgltf_data *data) {
         samplerInfo.addressModeU = extractGltfWrapMode(gltfSampler->wrap_s);
         samplerInfo.addressModeV = extractGltfWrapMode(gltfSampler->wrap_t);
         samplerInfo.mipmapMode = extractGltfMipmapMode(gltfSampler->min_filter);
-        samplerInfo.maxLod = 16;
-
-        VkSampler sampler;
-        vkCreateSampler(m_vulkanContext->device, &samplerInfo, nullptr, &sampler);
+        samplerInfo.maxLod = 16.f;
 
-        samplers.emplace_back(sampler);
+        samplers.emplace_back(m_vulkanContext->acquireSampler(samplerInfo));
     }
 
     for (size_t texture_i = 0; texture_i < data->textures_count; texture_i++) {
@@ -57,9 +68,20 @@ void GltfScene::parseTextures(const cgltf_data *data) {
             texture.name = gltfTexture->name;
         }
 
-        size_t imageIndex = gltfTexture->image - data->images;
-        if (!images.empty() && images[imageIndex].has_value()) {
-            texture.imageview = images[imageIndex].value().imageView;
+        // KHR_texture_basisu points at a ktx2 image, the plain image is only there as a fallback
+        const cgltf_image *gltfImage = gltfTexture->image;
+        if (gltfTexture->has_basisu && gltfTexture->basisu_image) {
+            size_t basisuImageIndex = gltfTexture->basisu_image - data->images;
+            if (!gltfImage || (basisuImageIndex < m_failedImages.size() && !m_failedImages[basisuImageIndex])) {
+                gltfImage = gltfTexture->basisu_image;
+            }
+        }
+
+        if (gltfImage) {
+            size_t imageIndex = gltfImage - data->images;
+            if (imageIndex < images.size() && images[imageIndex]) {
+                texture.imageview = images[imageIndex]->image.imageView;
+            }
         }
 
         if (gltfTexture->sampler && data->samplers) {
@@ -190,154 +212,523 @@ VkSamplerMipmapMode extractGltfMipmapMode(int gltfMinFilter) {
     }
 }
 
-GltfScene::GltfScene(VulkanContext *vulkanContext) : m_vulkanContext(vulkanContext) {
+GltfScene::GltfScene(VulkanContext *vulkanContext, ThreadPool *threadPool, ImageCache *imageCache)
+        : m_vulkanContext(vulkanContext), m_threadPool(threadPool), m_imageCache(imageCache) {
 }
 
 
 void GltfScene::clear() {
-    for (auto &image: images) {
-        if (image.has_value()) {
-            m_vulkanContext->destroyImage(image.value());
-        }
-    }
+    m_vulkanContext->uploadManager.wait(uploadValue);
 
-    for (auto &sampler: samplers) {
-        vkDestroySampler(m_vulkanContext->device, sampler, nullptr);
+    // destroyed with the last scene holding them
+    images.clear();
+
+    for (VkSampler sampler: samplers) {
+        m_vulkanContext->releaseSampler(sampler);
     }
+    samplers.clear();
 }
 
-void GltfScene::load(std::filesystem::path filePath) {
+void GltfScene::load(std::filesystem::path filePath, const GltfLoadOptions &loadOptions) {
     path = std::filesystem::current_path() / filePath;
 
+    auto loadStart = std::chrono::steady_clock::now();
+
     cgltf_options options = {};
     cgltf_data *data = nullptr;
 
-    cgltf_result result = cgltf_parse_file(&options, path.string().c_str(), &data);
+    // cgltf keeps pointers into the mapped files, they have to outlive cgltf_free
+    MappedFile mappedScene;
+    std::vector<MappedFile> mappedBuffers;
+
+    cgltf_result result;
+    if (loadOptions.mapFiles) {
+        mappedScene = MappedFile(path);
+        if (!mappedScene.isOpen()) {
+            std::cerr << "Failed to map GLTF file: " << path << std::endl;
+            return;
+        }
+        result = cgltf_parse(&options, mappedScene.data(), mappedScene.size(), &data);
+    } else {
+        result = cgltf_parse_file(&options, path.string().c_str(), &data);
+    }
     if (result != cgltf_result_success) {
         std::cerr << "Failed to load GLTF file: " << path <<
                   " Error: " << result << std::endl;
         return;
     }
+
+    if (loadOptions.mapFiles) {
+        mapExternalBuffers(data, mappedBuffers);
+    }
+
+    // fills in whatever wasn't mapped: the glb binary chunk, data uris and buffers that failed to map
     result = cgltf_load_buffers(&options, data, path.string().c_str());
     if (result != cgltf_result_success) {
         std::cerr << "Failed to load buffers from file: " << path <<
                   " Error: " << result << std::endl;
+        cgltf_free(data);
         return;
     }
 
-    parseImages(data);
+    bool fromSceneCache = false;
+    uint64_t contentHash = 0;
+    if (loadOptions.useSceneCache) {
+        contentHash = hashSource(data, loadOptions);
+        fromSceneCache = SceneCache::read(SceneCache::cachePath(path), contentHash, *this);
+    }
+
+    parseImages(data, loadOptions.compressTextures);
     parseTextures(data);
-    parseMaterials(data);
-    parseMesh(data);
-    parseNodes(data);
-    parseAnimations(data);
-    parseSkins(data);
+
+    if (!fromSceneCache) {
+        parseMaterials(data);
+        parseMesh(data, loadOptions);
+        if (loadOptions.optimizeMeshes) {
+            optimizeMeshes(loadOptions.optimizeOverdraw);
+        }
+        computeBounds();
+        if (loadOptions.generateLods) {
+            buildLods(data, loadOptions.lodMaxError);
+        }
+        if (loadOptions.buildMeshlets) {
+            buildMeshlets(data);
+        }
+        parseNodes(data);
+        parseAnimations(data);
+        validateAnimations();
+        if (loadOptions.compressAnimations) {
+            compressAnimations();
+        }
+        parseSkins(data);
+
+        if (loadOptions.useSceneCache && !SceneCache::write(SceneCache::cachePath(path), contentHash, *this)) {
+            std::cerr << "Failed to write scene cache for " << path << std::endl;
+        }
+    } else {
+        // the cache is only checked for truncation, playback still needs in range indices and sorted keys
+        validateAnimations();
+    }
+
+    linkNodes();
 
     cgltf_free(data);
+
+    uploadValue = m_vulkanContext->uploadManager.flush();
+    for (const auto &image: images) {
+        uploadValue = std::max(uploadValue, image->uploadValue);
+    }
     loaded = true;
+
+    std::cout << "Loaded " << path << " in "
+              << std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - loadStart).count()
+              << " ms (" << (loadOptions.mapFiles ? "mapped" : "read")
+              << (fromSceneCache ? ", scene cache" : "") << "), peak RSS "
+              << peakResidentSetSize() / (1024 * 1024) << " MB" << std::endl;
 }
 
-void GltfScene::parseImages(const cgltf_data *data) {
-    std::filesystem::path directory = path.parent_path();
+uint64_t GltfScene::hashSource(const cgltf_data *data, const GltfLoadOptions &loadOptions) {
+    uint64_t hash = hashBytes(&SceneCache::LOADER_VERSION, sizeof(SceneCache::LOADER_VERSION));
+    hash = hashBytes(&loadOptions.tangentMode, sizeof(loadOptions.tangentMode), hash);
+    bool meshOptions[5] = {loadOptions.optimizeMeshes, loadOptions.optimizeOverdraw, loadOptions.weldVertices,
+                           loadOptions.buildMeshlets, loadOptions.generateLods};
+    hash = hashBytes(meshOptions, sizeof(meshOptions), hash);
+    hash = hashBytes(&loadOptions.weldEpsilon, sizeof(loadOptions.weldEpsilon), hash);
+    hash = hashBytes(&loadOptions.lodMaxError, sizeof(loadOptions.lodMaxError), hash);
+    hash = hashBytes(&loadOptions.compressAnimations, sizeof(loadOptions.compressAnimations), hash);
+    hash = hashBytes(data->json, data->json_size, hash);
+
+    for (size_t buffer_i = 0; buffer_i < data->buffers_count; buffer_i++) {
+        const cgltf_buffer &buffer = data->buffers[buffer_i];
+        if (buffer.data) {
+            hash = hashBytes(buffer.data, buffer.size, hash);
+        }
+    }
 
-    for (size_t image_i = 0; image_i < data->images_count; image_i++) {
-        const cgltf_image *gltfImage = &data->images[image_i];
-        const char *uri = gltfImage->uri;
+    return hash;
+}
 
-        VulkanImage newImage = {};
-        int width, height, numChannels;
-
-        if (uri) {
-            if (strncmp(uri, "data:", 5) == 0) {
-                // embedded image
-                const char *comma = strchr(uri, ',');
-                if (comma && comma - uri >= 7 && strncmp(comma - 7, ";base64", 7) == 0) {
-                    const char *base64 = comma + 1;
-                    const size_t base64Size = strlen(base64);
-                    size_t decodedBinarySize = base64Size - base64Size / 4;
-
-                    if (base64Size >= 2) {
-                        decodedBinarySize -= base64[base64Size - 1] == '=';
-                        decodedBinarySize -= base64[base64Size - 2] == '=';
-                    }
+void GltfScene::mapExternalBuffers(cgltf_data *data, std::vector<MappedFile> &mappedBuffers) const {
+    for (size_t buffer_i = 0; buffer_i < data->buffers_count; buffer_i++) {
+        cgltf_buffer &buffer = data->buffers[buffer_i];
+        if (buffer.data || !buffer.uri || strncmp(buffer.uri, "data:", 5) == 0) {
+            continue;
+        }
 
-                    void *imageData = nullptr;
-                    cgltf_options options = {};
-                    if (cgltf_load_buffer_base64(&options, decodedBinarySize, base64, &imageData) !=
-                        cgltf_result_success) {
-                        std::cerr << "Failed to parse base64 image uri" << std::endl;
-                        return;
-                    }
+        std::string uri = buffer.uri;
+        uri.resize(cgltf_decode_uri(uri.data()));
 
-                    unsigned char *stbData = stbi_load_from_memory(
-                            static_cast<const unsigned char *>(imageData), decodedBinarySize, &width, &height,
-                            &numChannels, 4);
+        MappedFile mapped(path.parent_path() / uri);
+        if (!mapped.isOpen() || mapped.size() < buffer.size) {
+            continue;
+        }
 
-                    VkExtent3D imageExtent;
-                    imageExtent.width = width;
-                    imageExtent.height = height;
-                    imageExtent.depth = 1;
+        // cgltf never writes to buffer data, and must not free memory it didn't allocate
+        buffer.data = const_cast<std::byte *>(mapped.data());
+        buffer.data_free_method = cgltf_data_free_method_none;
+        mappedBuffers.push_back(std::move(mapped));
+    }
+}
 
-                    newImage = m_vulkanContext->createImage(stbData, imageExtent, VK_FORMAT_R8G8B8A8_UNORM,
-                                                                   VK_IMAGE_USAGE_SAMPLED_BIT,
-                                                                   true);
+// either stb_image pixels or a block compressed texture, both empty if decoding failed or the image was found in
+// the image cache
+struct DecodedImage {
+    uint64_t contentKey = 0; // hash of the source bytes and the encoding
+    std::shared_ptr<SharedImage> shared;
+
+    unsigned char *pixels = nullptr;
+    int width = 0;
+    int height = 0;
+
+    std::optional<TextureFile> compressed;
+    // keep the container bytes alive for compressed, which points into one of them
+    MappedFile mappedFile;
+    MappedFile cachedFile;
+    std::vector<std::byte> ownedData;
+};
+
+// how decoded pixels get block compressed, see GltfLoadOptions::compressTextures
+struct ImageCompression {
+    TextureEncoding encoding;
+    std::filesystem::path cacheDirectory;
+    ThreadPool *threadPool;
+};
+
+static void writeCachedTexture(const std::filesystem::path &cacheFile, const std::vector<std::byte> &bytes) {
+    // identical images can be encoded on two threads at once, so the temporary name is per thread
+    std::filesystem::path tempFile = cacheFile;
+    tempFile += ".tmp" + std::to_string(std::hash<std::thread::id>{}(std::this_thread::get_id()));
+    {
+        std::ofstream file(tempFile, std::ios::binary | std::ios::trunc);
+        file.write(reinterpret_cast<const char *>(bytes.data()), static_cast<std::streamsize>(bytes.size()));
+        if (!file.good()) {
+            std::cerr << "Failed to write texture cache file " << cacheFile << std::endl;
+            return;
+        }
+    }
 
-                    images.emplace_back(newImage);
+    std::error_code error;
+    std::filesystem::rename(tempFile, cacheFile, error);
+    if (error) {
+        std::filesystem::remove(tempFile, error);
+    }
+}
 
-                    stbi_image_free(stbData);
-                    free(imageData);
-                } else {
-                    std::cerr << "Invalid embedded image uri, using error texture" << std::endl;
+static void decodeBytes(const std::byte *bytes, size_t size, DecodedImage &decoded,
+                        const ImageCompression *compression, ImageCache *imageCache) {
+    uint32_t key[2] = {TEXTURE_ENCODER_VERSION,
+                       compression ? static_cast<uint32_t>(compression->encoding) : UINT32_MAX};
+    decoded.contentKey = hashBytes(bytes, size, hashBytes(key, sizeof(key)));
+
+    // decoded and uploaded by an earlier load
+    if (imageCache) {
+        decoded.shared = imageCache->find(decoded.contentKey);
+        if (decoded.shared) {
+            return;
+        }
+    }
+
+    if (isTextureContainer(bytes, size)) {
+        decoded.compressed = parseTextureFile(bytes, size);
+        return;
+    }
+
+    std::filesystem::path cacheFile;
+    if (compression) {
+        char fileName[32];
+        snprintf(fileName, sizeof(fileName), "%016llx.ktx2", static_cast<unsigned long long>(decoded.contentKey));
+        cacheFile = compression->cacheDirectory / fileName;
+
+        // cache hit, the encoded blocks are uploaded straight from the mapped file
+        decoded.cachedFile = MappedFile(cacheFile);
+        if (decoded.cachedFile.isOpen()) {
+            decoded.compressed = parseTextureFile(decoded.cachedFile.data(), decoded.cachedFile.size());
+            if (decoded.compressed) {
+                return;
+            }
+            decoded.cachedFile = {};
+        }
+    }
+
+    int numChannels;
+    decoded.pixels = stbi_load_from_memory(reinterpret_cast<const unsigned char *>(bytes), static_cast<int>(size),
+                                           &decoded.width, &decoded.height, &numChannels, 4);
+    if (!decoded.pixels || !compression) {
+        return;
+    }
+
+    EncodedTexture encoded = encodeTexture(decoded.pixels, decoded.width, decoded.height, compression->encoding,
+                                           compression->threadPool);
+    decoded.ownedData = serializeKtx2(encoded.format, encoded.extent, encoded.levels, encoded.data.data());
+    decoded.compressed = parseTextureFile(decoded.ownedData.data(), decoded.ownedData.size());
+    if (!decoded.compressed) {
+        decoded.ownedData.clear();
+        return;
+    }
 
-                    newImage = m_vulkanContext->createImage(VkUtil::createCheckerboard().data(),
-                                                                   VkExtent3D(8, 8, 1),
-                                                                   VK_FORMAT_R8G8B8A8_UNORM,
-                                                                   VK_IMAGE_USAGE_SAMPLED_BIT, false);
+    stbi_image_free(decoded.pixels);
+    decoded.pixels = nullptr;
 
-                    images.emplace_back(newImage);
+    writeCachedTexture(cacheFile, decoded.ownedData);
+}
+
+static DecodedImage decodeImage(const cgltf_image *gltfImage, const std::filesystem::path &directory,
+                                const ImageCompression *compression, ImageCache *imageCache) {
+    DecodedImage decoded = {};
+    const char *uri = gltfImage->uri;
+
+    if (uri) {
+        if (strncmp(uri, "data:", 5) == 0) {
+            // embedded image
+            const char *comma = strchr(uri, ',');
+            if (comma && comma - uri >= 7 && strncmp(comma - 7, ";base64", 7) == 0) {
+                const char *base64 = comma + 1;
+                const size_t base64Size = strlen(base64);
+                size_t decodedBinarySize = base64Size - base64Size / 4;
+
+                if (base64Size >= 2) {
+                    decodedBinarySize -= base64[base64Size - 1] == '=';
+                    decodedBinarySize -= base64[base64Size - 2] == '=';
                 }
-            } else {
-                // todo: load image from file and from buffer
-                std::filesystem::path imageFile = directory / uri;
-                unsigned char *stbData = stbi_load(imageFile.string().c_str(), &width, &height, &numChannels, 4);
-                if (stbData) {
-                    VkExtent3D imageExtent;
-                    imageExtent.width = width;
-                    imageExtent.height = height;
-                    imageExtent.depth = 1;
-
-                    newImage = m_vulkanContext->createImage(stbData, imageExtent, VK_FORMAT_R8G8B8A8_UNORM,
-                                                                   VK_IMAGE_USAGE_SAMPLED_BIT,
-                                                                   true);
-
-                    images.emplace_back(newImage);
-
-                    stbi_image_free(stbData);
-                } else {
-                    std::cerr << "Failed to read image file " << imageFile << ", using error texture" << std::endl;
 
-                    newImage = m_vulkanContext->createImage(VkUtil::createCheckerboard().data(),
-                                                            VkExtent3D(8, 8, 1),
-                                                            VK_FORMAT_R8G8B8A8_UNORM,
-                                                            VK_IMAGE_USAGE_SAMPLED_BIT, false);
+                void *imageData = nullptr;
+                cgltf_options options = {};
+                if (cgltf_load_buffer_base64(&options, decodedBinarySize, base64, &imageData) !=
+                    cgltf_result_success) {
+                    std::cerr << "Failed to parse base64 image uri, using error texture" << std::endl;
+                    return decoded;
+                }
 
-                    images.emplace_back(newImage);
+                const auto *bytes = static_cast<const std::byte *>(imageData);
+                if (isTextureContainer(bytes, decodedBinarySize)) {
+                    decoded.ownedData.assign(bytes, bytes + decodedBinarySize);
+                    decodeBytes(decoded.ownedData.data(), decoded.ownedData.size(), decoded, compression, imageCache);
+                } else {
+                    decodeBytes(bytes, decodedBinarySize, decoded, compression, imageCache);
                 }
+                free(imageData);
+            } else {
+                std::cerr << "Invalid embedded image uri, using error texture" << std::endl;
+            }
+        } else {
+            std::filesystem::path imageFile = directory / uri;
+            decoded.mappedFile = MappedFile(imageFile);
+            if (decoded.mappedFile.isOpen()) {
+                decodeBytes(decoded.mappedFile.data(), decoded.mappedFile.size(), decoded, compression, imageCache);
+            }
+            if (!decoded.shared && !decoded.pixels && !decoded.compressed) {
+                std::cerr << "Failed to read image file " << imageFile << ", using error texture" << std::endl;
+            }
+            if (!decoded.compressed || decoded.cachedFile.isOpen() || !decoded.ownedData.empty()) {
+                decoded.mappedFile = {};
+            }
+        }
+    } else if (gltfImage->buffer_view) {
+        // glb chunk or buffer view, decode in place from the buffer cgltf already loaded
+        const cgltf_buffer_view *bufferView = gltfImage->buffer_view;
+        const auto *bufferData = static_cast<const std::byte *>(bufferView->buffer->data);
+
+        if (bufferData && bufferView->offset + bufferView->size <= bufferView->buffer->size) {
+            decodeBytes(bufferData + bufferView->offset, bufferView->size, decoded, compression, imageCache);
+        }
+        if (!decoded.shared && !decoded.pixels && !decoded.compressed) {
+            std::cerr << "Failed to decode image from buffer view, using error texture" << std::endl;
+        }
+    } else {
+        std::cerr << "Image has neither uri nor buffer view, using error texture" << std::endl;
+    }
+
+    return decoded;
+}
+
+// normal maps only need xy and occlusion only red, anything shared with another slot keeps all channels
+static std::vector<TextureEncoding> imageEncodings(const cgltf_data *data) {
+    enum UsageBits : uint8_t {
+        eUsedAsNormal = 1,
+        eUsedAsOcclusion = 2,
+        eUsedAsColor = 4,
+    };
+
+    std::vector<uint8_t> usage(data->images_count, 0);
+    auto markUsage = [&](const cgltf_texture_view &textureView, uint8_t bit) {
+        if (textureView.texture && textureView.texture->image) {
+            usage[textureView.texture->image - data->images] |= bit;
+        }
+    };
+
+    for (size_t material_i = 0; material_i < data->materials_count; material_i++) {
+        const cgltf_material &material = data->materials[material_i];
+        markUsage(material.pbr_metallic_roughness.base_color_texture, eUsedAsColor);
+        markUsage(material.pbr_metallic_roughness.metallic_roughness_texture, eUsedAsColor);
+        markUsage(material.emissive_texture, eUsedAsColor);
+        markUsage(material.normal_texture, eUsedAsNormal);
+        markUsage(material.occlusion_texture, eUsedAsOcclusion);
+    }
+
+    std::vector<TextureEncoding> encodings(data->images_count, TextureEncoding::eColor);
+    for (size_t image_i = 0; image_i < data->images_count; image_i++) {
+        if (usage[image_i] == eUsedAsNormal) {
+            encodings[image_i] = TextureEncoding::eNormal;
+        } else if (usage[image_i] == eUsedAsOcclusion) {
+            encodings[image_i] = TextureEncoding::eSingleChannel;
+        }
+    }
+
+    return encodings;
+}
+
+static VkFormat encodedFormat(TextureEncoding encoding) {
+    switch (encoding) {
+        case TextureEncoding::eNormal:
+            return VK_FORMAT_BC5_UNORM_BLOCK;
+        case TextureEncoding::eSingleChannel:
+            return VK_FORMAT_BC4_UNORM_BLOCK;
+        default:
+            return VK_FORMAT_BC7_UNORM_BLOCK;
+    }
+}
+
+void GltfScene::parseImages(const cgltf_data *data, bool compressTextures) {
+    std::filesystem::path directory = path.parent_path();
+
+    auto decodeStart = std::chrono::steady_clock::now();
+
+    std::vector<std::optional<ImageCompression>> compressions(data->images_count);
+    if (compressTextures && data->images_count > 0) {
+        std::filesystem::path cacheDirectory = directory / "texture_cache";
+        std::error_code error;
+        std::filesystem::create_directories(cacheDirectory, error);
+
+        std::vector<TextureEncoding> encodings = imageEncodings(data);
+        for (size_t image_i = 0; image_i < data->images_count; image_i++) {
+            if (m_vulkanContext->supportsSampledFormat(encodedFormat(encodings[image_i]))) {
+                compressions[image_i] = ImageCompression{encodings[image_i], cacheDirectory, m_threadPool};
+            }
+        }
+    }
+
+    // decoding is independent per image, results are kept in gltf order so images[] indexing is unchanged.
+    // encoding nests another parallelFor over block rows, which the pool allows
+    std::vector<DecodedImage> decodedImages(data->images_count);
+    auto decode = [&](size_t image_i) {
+        const ImageCompression *compression = compressions[image_i] ? &compressions[image_i].value() : nullptr;
+        decodedImages[image_i] = decodeImage(&data->images[image_i], directory, compression, m_imageCache);
+    };
+
+    if (m_threadPool) {
+        m_threadPool->parallelFor(data->images_count, decode);
+    } else {
+        for (size_t image_i = 0; image_i < data->images_count; image_i++) {
+            decode(image_i);
+        }
+    }
+
+    auto decodeEnd = std::chrono::steady_clock::now();
+
+    // images other scenes can share, inserted into the cache once their batch is submitted
+    struct CacheableImage {
+        size_t image_i;
+        VulkanImage image;
+        size_t sizeBytes;
+        uint64_t contentKey;
+    };
+    std::vector<CacheableImage> cacheableImages;
+
+    size_t sharedCount = 0;
+    for (auto &decoded: decodedImages) {
+        if (decoded.shared) {
+            m_failedImages.push_back(false);
+            images.emplace_back(std::move(decoded.shared));
+            sharedCount++;
+            continue;
+        }
+
+        VulkanImage newImage = {};
+        size_t sizeBytes = 0;
+
+        if (decoded.compressed && !m_vulkanContext->supportsSampledFormat(decoded.compressed->format)) {
+            std::cerr << "Compressed texture format " << decoded.compressed->format
+                      << " is not supported by the device, using error texture" << std::endl;
+            decoded.compressed.reset();
+        }
+
+        m_failedImages.push_back(!decoded.compressed && !decoded.pixels);
+
+        if (decoded.compressed) {
+            // prebuilt mips are uploaded as is, no decode and no blits
+            newImage = m_vulkanContext->createImage(*decoded.compressed, VK_IMAGE_USAGE_SAMPLED_BIT);
+            for (const auto &level: decoded.compressed->levels) {
+                sizeBytes += level.size;
             }
+        } else if (decoded.pixels) {
+            VkExtent3D imageExtent;
+            imageExtent.width = decoded.width;
+            imageExtent.height = decoded.height;
+            imageExtent.depth = 1;
+
+            newImage = m_vulkanContext->createImage(decoded.pixels, imageExtent, VK_FORMAT_R8G8B8A8_UNORM,
+                                                    VK_IMAGE_USAGE_SAMPLED_BIT,
+                                                    true);
+            sizeBytes = static_cast<size_t>(decoded.width) * decoded.height * 4 * 4 / 3; // with the mip chain
+
+            stbi_image_free(decoded.pixels);
         } else {
-            //todo: read image from buffer
-            std::cout << "Image read from buffer not yet implemented, using error texture" << std::endl;
             newImage = m_vulkanContext->createImage(VkUtil::createCheckerboard().data(),
                                                     VkExtent3D(8, 8, 1),
                                                     VK_FORMAT_R8G8B8A8_UNORM,
                                                     VK_IMAGE_USAGE_SAMPLED_BIT, false);
+        }
+
+        if (m_imageCache && sizeBytes != 0) {
+            cacheableImages.push_back({images.size(), newImage, sizeBytes, decoded.contentKey});
+            images.emplace_back();
+        } else {
+            images.emplace_back(std::make_shared<SharedImage>(m_vulkanContext, newImage, 0, sizeBytes));
+        }
+    }
 
-            images.emplace_back(newImage);
+    if (!cacheableImages.empty()) {
+        // other scenes can pick the images up before this one is done, so they go out in a batch of their own,
+        // one for all of them
+        uint64_t imageUploadValue = m_vulkanContext->uploadManager.flush();
+        for (const auto &cacheable: cacheableImages) {
+            auto image = std::make_shared<SharedImage>(m_vulkanContext, cacheable.image, imageUploadValue,
+                                                       cacheable.sizeBytes);
+            images[cacheable.image_i] = m_imageCache->insert(cacheable.contentKey, image);
         }
     }
+
+    auto recordEnd = std::chrono::steady_clock::now();
+
+    if (data->images_count > 0) {
+        std::cout << "Decoded " << data->images_count << " images in "
+                  << std::chrono::duration<float, std::milli>(decodeEnd - decodeStart).count() << " ms ("
+                  << (m_threadPool ? m_threadPool->threadCount() : 0) << " pool threads), recorded uploads in "
+                  << std::chrono::duration<float, std::milli>(recordEnd - decodeEnd).count() << " ms, " << sharedCount
+                  << " shared with earlier loads" << std::endl;
+    }
 }
 
-void GltfScene::parseMesh(const cgltf_data *data) {
+void GltfScene::parseMesh(const cgltf_data *data, const GltfLoadOptions &loadOptions) {
+    // decoded attributes, reused across primitives
+    std::vector<glm::vec4> positions;
+    std::vector<glm::vec4> normals;
+    std::vector<glm::vec4> uvs;
+    std::vector<glm::vec4> tangents;
+    std::vector<glm::vec4> joints;
+    std::vector<glm::vec4> weights;
+
+    // primitives without tangents, generated once all vertices are in place
+    std::vector<MeshPrimitive> tangentPrimitives;
+
+    // decoded morph target attributes
+    std::vector<glm::vec4> targetPositions;
+    std::vector<glm::vec4> targetNormals;
+    std::vector<glm::vec4> targetTangents;
+
+    // skinned primitives are numbered consecutively for the renderer's skin stream
+    uint32_t skinVertexCount = 0;
+
     for (size_t mesh_i = 0; mesh_i < data->meshes_count; mesh_i++) {
         Mesh newMesh = {};
 
@@ -346,6 +737,7 @@ void GltfScene::parseMesh(const cgltf_data *data) {
         if (gltfMesh->name != nullptr) {
             newMesh.name = gltfMesh->name;
         }
+        newMesh.weights.assign(gltfMesh->weights, gltfMesh->weights + gltfMesh->weights_count);
 
         for (size_t primitive_i = 0; primitive_i < gltfMesh->primitives_count; primitive_i++) {
             const cgltf_primitive *gltfPrimitive = &gltfMesh->primitives[primitive_i];
@@ -361,67 +753,38 @@ void GltfScene::parseMesh(const cgltf_data *data) {
             bool hasIndices = gltfPrimitive->indices != nullptr;
 
             const cgltf_accessor *positionAccessor = nullptr;
-            const cgltf_buffer_view *positionBufferView = nullptr;
-            const std::byte *positionBuffer = nullptr;
-
             const cgltf_accessor *normalAccessor = nullptr;
-            const cgltf_buffer_view *normalBufferView = nullptr;
-            const std::byte *normalBuffer = nullptr;
-
             const cgltf_accessor *uvAccessor = nullptr;
-            const cgltf_buffer_view *uvBufferView = nullptr;
-            const std::byte *uvBuffer = nullptr;
-
             const cgltf_accessor *tangentAccessor = nullptr;
-            const cgltf_buffer_view *tangentBufferView = nullptr;
-            const std::byte *tangentBuffer = nullptr;
-
             const cgltf_accessor *jointAccessor = nullptr;
-            const cgltf_buffer_view *jointBufferView = nullptr;
-            const std::byte *jointBuffer = nullptr;
-
             const cgltf_accessor *weightAccessor = nullptr;
-            const cgltf_buffer_view *weightBufferView = nullptr;
-            const std::byte *weightBuffer = nullptr;
 
             for (size_t attr_i = 0; attr_i < gltfPrimitive->attributes_count; attr_i++) {
                 const cgltf_attribute *gltfAttribute = &gltfPrimitive->attributes[attr_i];
                 switch (gltfAttribute->type) {
                     case cgltf_attribute_type_position: {
                         positionAccessor = gltfAttribute->data;
-                        positionBufferView = positionAccessor->buffer_view;
                         vertexCount = positionAccessor->count;
-                        positionBuffer = static_cast<const std::byte *>(positionBufferView->buffer->data);
                         break;
                     }
                     case cgltf_attribute_type_normal: {
                         normalAccessor = gltfAttribute->data;
-                        normalBufferView = normalAccessor->buffer_view;
-                        normalBuffer = static_cast<const std::byte *>(normalBufferView->buffer->data);
                         break;
                     }
                     case cgltf_attribute_type_texcoord: {
                         uvAccessor = gltfAttribute->data;
-                        uvBufferView = uvAccessor->buffer_view;
-                        uvBuffer = static_cast<const std::byte *>(uvBufferView->buffer->data);
                         break;
                     }
                     case cgltf_attribute_type_joints: {
                         jointAccessor = gltfAttribute->data;
-                        jointBufferView = jointAccessor->buffer_view;
-                        jointBuffer = static_cast<const std::byte *>(jointBufferView->buffer->data);
                         break;
                     }
                     case cgltf_attribute_type_weights: {
                         weightAccessor = gltfAttribute->data;
-                        weightBufferView = weightAccessor->buffer_view;
-                        weightBuffer = static_cast<const std::byte *>(weightBufferView->buffer->data);
                         break;
                     }
                     case cgltf_attribute_type_tangent: {
                         tangentAccessor = gltfAttribute->data;
-                        tangentBufferView = tangentAccessor->buffer_view;
-                        tangentBuffer = static_cast<const std::byte *>(tangentBufferView->buffer->data);
                         break;
                     }
                     default:
@@ -429,52 +792,58 @@ void GltfScene::parseMesh(const cgltf_data *data) {
                 }
             }
 
-            assert(positionBuffer &&
-                           (!normalBuffer || normalAccessor->count == positionAccessor->count) &&
-                           (!uvBuffer || uvAccessor->count == positionAccessor->count) &&
-                           (!tangentBuffer || tangentAccessor->count == positionAccessor->count) &&
-                           (!jointBuffer || jointAccessor->count == positionAccessor->count) &&
-                           (!weightBuffer || weightAccessor->count == positionAccessor->count)
+            assert(positionAccessor &&
+                           (!normalAccessor || normalAccessor->count == positionAccessor->count) &&
+                           (!uvAccessor || uvAccessor->count == positionAccessor->count) &&
+                           (!tangentAccessor || tangentAccessor->count == positionAccessor->count) &&
+                           (!jointAccessor || jointAccessor->count == positionAccessor->count) &&
+                           (!weightAccessor || weightAccessor->count == positionAccessor->count)
             );
 
-            newPrimitive.hasSkin = jointBuffer && weightBuffer;
+            // decode every attribute in one pass over its accessor, then interleave
+            auto readAttribute = [&](const cgltf_accessor *accessor, std::vector<glm::vec4> &out,
+                                     const char *attributeName) {
+                if (accessor && !readAccessor(accessor, out)) {
+                    std::cerr << newMesh.name << ": unsupported " << attributeName << " accessor type" << std::endl;
+                    return false;
+                }
+                return accessor != nullptr;
+            };
+
+            if (!readAttribute(positionAccessor, positions, "position")) {
+                std::cerr << "Mesh primitive has no vertices" << std::endl;
+                vertexCount = 0;
+            }
+            bool hasNormals = readAttribute(normalAccessor, normals, "normal");
+            bool hasUVs = readAttribute(uvAccessor, uvs, "texcoord");
+            bool hasTangents = readAttribute(tangentAccessor, tangents, "tangent");
+            newPrimitive.hasSkin = readAttribute(jointAccessor, joints, "joints") &&
+                                   readAttribute(weightAccessor, weights, "weights");
 
+            vertices.resize(vertexStart + vertexCount);
             for (size_t vertex_i = 0; vertex_i < vertexCount; vertex_i++) {
-                Vertex vertex = {};
+                Vertex &vertex = vertices[vertexStart + vertex_i];
+                vertex = {};
 
-                // todo: support types other than floats for textures?
-                if (positionAccessor && positionBufferView) {
-                    size_t positionOffset = positionAccessor->offset + positionBufferView->offset +
-                                            vertex_i * positionAccessor->stride;
-                    vertex.position = glm::make_vec3(reinterpret_cast<const float *>(&positionBuffer[positionOffset]));
-                } else {
-                    std::cerr << "Mesh primitive has no vertices" << std::endl;
-                }
+                vertex.position = glm::vec3(positions[vertex_i]);
 
                 // todo: handle vertices with no specified normals
-                if (normalAccessor && normalBufferView) {
-                    size_t normalOffset = normalAccessor->offset + normalBufferView->offset +
-                                          vertex_i * normalAccessor->stride;
-                    vertex.normal = glm::make_vec3(reinterpret_cast<const float *>(&normalBuffer[normalOffset]));
+                if (hasNormals) {
+                    vertex.normal = glm::vec3(normals[vertex_i]);
                 }
 
-                if (uvAccessor && uvBufferView) {
-                    size_t uvOffset = uvAccessor->offset + uvBufferView->offset +
-                                      vertex_i * uvAccessor->stride;
-                    glm::vec2 uv = glm::make_vec2(reinterpret_cast<const float *>(&uvBuffer[uvOffset]));
-                    vertex.uv_x = uv.x;
-                    vertex.uv_y = uv.y;
+                if (hasUVs) {
+                    vertex.uv_x = uvs[vertex_i].x;
+                    vertex.uv_y = uvs[vertex_i].y;
                 }
 
-                if (tangentAccessor && tangentBufferView) {
-                    size_t tangentOffset = tangentAccessor->offset + tangentBufferView->offset +
-                                           vertex_i * tangentAccessor->stride;
-                    vertex.tangent = glm::make_vec4(reinterpret_cast<const float *>(&tangentBuffer[tangentOffset]));
+                if (hasTangents) {
+                    vertex.tangent = tangents[vertex_i];
                     vertex.bitangent =
                             glm::vec4(glm::cross(vertex.normal,
                                                  glm::vec3(vertex.tangent.x, vertex.tangent.y, vertex.tangent.z)),
                                       vertex.tangent.w);
-                } else if (!uvAccessor && normalAccessor) {
+                } else if (!hasUVs && hasNormals) {
                     vertex.tangent =
                             glm::vec4(glm::cross(vertex.normal, glm::vec3(1.f, 1.f, 1.f)), 1.f);
                     vertex.bitangent =
@@ -485,59 +854,13 @@ void GltfScene::parseMesh(const cgltf_data *data) {
                                     1.f);
                 }
 
-                //todo joints and weights
                 if (newPrimitive.hasSkin) {
-                    size_t jointOffset =
-                            jointAccessor->offset + jointBufferView->offset + vertex_i * jointAccessor->stride;
-                    switch (cgltf_component_size(jointAccessor->component_type)) {
-                        case 2: {
-                            const uint16_t *joints = reinterpret_cast<const uint16_t *>(&jointBuffer[jointOffset]);
-                            vertex.jointIndices = glm::make_vec4(joints);
-                            break;
-                        }
-                        case 1: {
-                            const uint8_t *joints = reinterpret_cast<const uint8_t *>(&jointBuffer[jointOffset]);
-                            vertex.jointIndices = glm::make_vec4(joints);
-                            break;
-                        }
-                        default: {
-                            std::cout << "unsupported joint index type" << std::endl;
-                            break;
-                        }
-                    }
-
-                    size_t weightOffset =
-                            weightAccessor->offset + weightBufferView->offset + vertex_i * weightAccessor->stride;
-                    switch (cgltf_component_size(weightAccessor->component_type)) {
-                        case 4: {
-                            const float *weights = reinterpret_cast<const float *>(&weightBuffer[weightOffset]);
-                            vertex.jointWeights = glm::make_vec4(weights);
-                            break;
-                        }
-                        case 2: {
-                            const uint16_t *weights = reinterpret_cast<const uint16_t *>(&weightBuffer[weightOffset]);
-                            vertex.jointWeights = glm::make_vec4(weights);
-                            vertex.jointWeights /= UINT16_MAX;
-                            break;
-                        }
-                        case 1: {
-                            const uint8_t *weights = reinterpret_cast<const uint8_t *>(&weightBuffer[weightOffset]);
-                            vertex.jointWeights = glm::make_vec4(weights);
-                            vertex.jointWeights /= UINT8_MAX;
-                            break;
-                        }
-                        default: {
-                            std::cout << "unsupported weight type" << std::endl;
-                            break;
-                        }
-                    }
-
+                    vertex.jointIndices = joints[vertex_i];
+                    vertex.jointWeights = weights[vertex_i];
                 } else {
                     vertex.jointIndices = glm::vec4(0); // use identity matrix joint
                     vertex.jointWeights = glm::vec4(1.f, 0.f, 0.f, 0.f); // weight 1.f identity matrix
                 }
-
-                vertices.push_back(vertex);
             }
 
             if (hasIndices) {
@@ -576,6 +899,24 @@ void GltfScene::parseMesh(const cgltf_data *data) {
                         std::cerr << newMesh.name << ": invalid primitive index component type" << std::endl;
                         return;
                 }
+            } else if (loadOptions.weldVertices && gltfPrimitive->type == cgltf_primitive_type_triangles &&
+                       gltfPrimitive->targets_count == 0) {
+                // every triangle corner is its own vertex, collapse the duplicates so the primitive is drawn indexed
+                std::vector<uint32_t> weldedIndices;
+                size_t uniqueCount = MeshOpt::weldVertices(
+                        std::span(vertices.data() + vertexStart, vertexCount), weldedIndices, loadOptions.weldEpsilon);
+
+                std::cout << newMesh.name << " primitive " << primitive_i << ": welded " << vertexCount
+                          << " vertices to " << uniqueCount << std::endl;
+
+                vertexCount = static_cast<uint32_t>(uniqueCount);
+                vertices.resize(vertexStart + vertexCount);
+
+                indexCount = static_cast<uint32_t>(weldedIndices.size());
+                for (uint32_t index: weldedIndices) {
+                    indices.push_back(index + vertexStart);
+                }
+                newPrimitive.hasIndices = true;
             }
 
             if (gltfPrimitive->material) {
@@ -586,26 +927,376 @@ void GltfScene::parseMesh(const cgltf_data *data) {
 
             newPrimitive.indexCount = indexCount;
             newPrimitive.vertexCount = vertexCount;
+            if (vertexCount != 0 && gltfPrimitive->targets_count != 0) {
+                newPrimitive.morphTargetCount = static_cast<uint32_t>(gltfPrimitive->targets_count);
+                newPrimitive.morphDeltaStart = static_cast<uint32_t>(morphDeltas.size());
+
+                for (uint32_t target_i = 0; target_i < newPrimitive.morphTargetCount; target_i++) {
+                    const cgltf_morph_target &target = gltfPrimitive->targets[target_i];
+
+                    targetPositions.assign(vertexCount, glm::vec4(0.f));
+                    targetNormals.assign(vertexCount, glm::vec4(0.f));
+                    targetTangents.assign(vertexCount, glm::vec4(0.f));
+                    for (size_t attr_i = 0; attr_i < target.attributes_count; attr_i++) {
+                        const cgltf_attribute &attribute = target.attributes[attr_i];
+                        std::vector<glm::vec4> *out = nullptr;
+                        switch (attribute.type) {
+                            case cgltf_attribute_type_position:
+                                out = &targetPositions;
+                                break;
+                            case cgltf_attribute_type_normal:
+                                out = &targetNormals;
+                                break;
+                            case cgltf_attribute_type_tangent:
+                                out = &targetTangents;
+                                break;
+                            default:
+                                break;
+                        }
+                        if (out && (attribute.data->count != vertexCount || !readAccessor(attribute.data, *out))) {
+                            std::cerr << newMesh.name << ": unsupported morph target " << target_i << " accessor"
+                                      << std::endl;
+                            out->assign(vertexCount, glm::vec4(0.f));
+                        }
+                    }
 
-            if (!tangentAccessor && uvAccessor && normalAccessor) {
-                CalcTangents mikktspace;
-                CalcTangentData tangentData = {indices, vertices, newPrimitive};
-                mikktspace.calculate(&tangentData);
-
-                for (size_t vertex_i = newPrimitive.vertexStart; vertex_i < vertices.size(); vertex_i++) {
-                    vertices[vertex_i].bitangent =
-                            glm::vec4(glm::cross(vertices[vertex_i].normal,
-                                                 glm::vec3(vertices[vertex_i].tangent.x,
-                                                           vertices[vertex_i].tangent.y,
-                                                           vertices[vertex_i].tangent.z)),
-                                      vertices[vertex_i].tangent.w);
+                    for (uint32_t vertex_i = 0; vertex_i < vertexCount; vertex_i++) {
+                        glm::vec3 position(targetPositions[vertex_i]);
+                        glm::vec3 normal(targetNormals[vertex_i]);
+                        glm::vec3 tangent(targetTangents[vertex_i]);
+                        if (position != glm::vec3(0.f) || normal != glm::vec3(0.f) || tangent != glm::vec3(0.f)) {
+                            morphDeltas.push_back(VertexFormat::packMorphDelta(vertex_i, target_i, position, normal,
+                                                                               tangent));
+                        }
+                    }
                 }
+
+                newPrimitive.morphRangeStart = static_cast<uint32_t>(morphRanges.size());
+                morphRanges.resize(morphRanges.size() + vertexCount + 1);
+                sortMorphDeltas(newPrimitive, morphDeltas.size() - newPrimitive.morphDeltaStart);
+            }
+            if (newPrimitive.hasSkin) {
+                newPrimitive.skinVertexStart = skinVertexCount;
+                skinVertexCount += vertexCount;
+            }
+
+            if (!tangentAccessor && uvAccessor && normalAccessor) {
+                tangentPrimitives.push_back(newPrimitive);
             }
 
             newMesh.meshPrimitives.emplace_back(newPrimitive);
         }
         meshes.emplace_back(std::make_shared<Mesh>(std::move(newMesh)));
     }
+
+    // primitives own disjoint vertex ranges, so they are generated concurrently
+    CalcTangents(m_threadPool, loadOptions.tangentMode).calculate(indices, vertices, tangentPrimitives);
+}
+
+void GltfScene::optimizeMeshes(bool optimizeOverdraw) {
+    struct PrimitiveJob {
+        const Mesh *mesh;
+        size_t primitive_i;
+        MeshOpt::VertexCacheStats before;
+        MeshOpt::VertexCacheStats after;
+        bool optimized;
+    };
+
+    std::vector<PrimitiveJob> jobs;
+    for (const auto &mesh: meshes) {
+        for (size_t primitive_i = 0; primitive_i < mesh->meshPrimitives.size(); primitive_i++) {
+            if (mesh->meshPrimitives[primitive_i].hasIndices) {
+                jobs.push_back({mesh.get(), primitive_i});
+            }
+        }
+    }
+
+    // primitives own disjoint index and vertex ranges
+    auto optimize = [&](size_t job_i) {
+        PrimitiveJob &job = jobs[job_i];
+        const MeshPrimitive &primitive = job.mesh->meshPrimitives[job.primitive_i];
+
+        std::span<uint32_t> primitiveIndices(indices.data() + primitive.indexStart, primitive.indexCount);
+        std::span<Vertex> primitiveVertices(vertices.data() + primitive.vertexStart, primitive.vertexCount);
+
+        for (uint32_t index: primitiveIndices) {
+            if (index < primitive.vertexStart || index - primitive.vertexStart >= primitive.vertexCount) {
+                return; // references vertices outside the primitive, leave it alone
+            }
+        }
+
+        for (uint32_t &index: primitiveIndices) {
+            index -= primitive.vertexStart;
+        }
+
+        job.before = MeshOpt::analyzeVertexCache(primitiveIndices, primitiveVertices.size());
+        MeshOpt::optimizeVertexCache(primitiveIndices, primitiveVertices.size());
+        if (optimizeOverdraw) {
+            MeshOpt::optimizeOverdraw(primitiveIndices, primitiveVertices);
+        }
+        std::vector<uint32_t> remap = MeshOpt::optimizeVertexFetch(primitiveIndices, primitiveVertices);
+        if (primitive.morphTargetCount != 0) {
+            std::span<MorphDelta> primitiveDeltas = primitiveMorphDeltas(primitive);
+            for (MorphDelta &delta: primitiveDeltas) {
+                delta.vertex = remap[delta.vertex];
+            }
+            sortMorphDeltas(primitive, primitiveDeltas.size());
+        }
+        job.after = MeshOpt::analyzeVertexCache(primitiveIndices, primitiveVertices.size());
+        job.optimized = true;
+
+        for (uint32_t &index: primitiveIndices) {
+            index += primitive.vertexStart;
+        }
+    };
+
+    if (m_threadPool) {
+        m_threadPool->parallelFor(jobs.size(), optimize);
+    } else {
+        for (size_t job_i = 0; job_i < jobs.size(); job_i++) {
+            optimize(job_i);
+        }
+    }
+
+    for (const auto &job: jobs) {
+        if (job.optimized) {
+            std::cout << job.mesh->name << " primitive " << job.primitive_i << ": ACMR " << job.before.acmr << " -> "
+                      << job.after.acmr << ", ATVR " << job.before.atvr << " -> " << job.after.atvr << std::endl;
+        } else {
+            std::cerr << job.mesh->name << " primitive " << job.primitive_i
+                      << ": indices outside the primitive's vertices, not optimized" << std::endl;
+        }
+    }
+}
+
+std::span<MorphDelta> GltfScene::primitiveMorphDeltas(const MeshPrimitive &primitive) {
+    if (primitive.morphTargetCount == 0) {
+        return {};
+    }
+    return {morphDeltas.data() + primitive.morphDeltaStart,
+            morphRanges[primitive.morphRangeStart + primitive.vertexCount]};
+}
+
+void GltfScene::sortMorphDeltas(const MeshPrimitive &primitive, size_t deltaCount) {
+    std::span<uint32_t> ranges(morphRanges.data() + primitive.morphRangeStart, primitive.vertexCount + 1);
+
+    // stable, so a vertex's deltas stay in target order
+    auto deltasBegin = morphDeltas.begin() + primitive.morphDeltaStart;
+    auto deltasEnd = deltasBegin + static_cast<ptrdiff_t>(deltaCount);
+    std::stable_sort(deltasBegin, deltasEnd, [](const MorphDelta &a, const MorphDelta &b) {
+        return a.vertex < b.vertex;
+    });
+
+    std::fill(ranges.begin(), ranges.end(), 0);
+    for (auto delta = deltasBegin; delta != deltasEnd; delta++) {
+        ranges[delta->vertex + 1]++;
+    }
+    for (size_t vertex_i = 1; vertex_i < ranges.size(); vertex_i++) {
+        ranges[vertex_i] += ranges[vertex_i - 1];
+    }
+}
+
+void GltfScene::computeBounds() {
+    for (const auto &mesh: meshes) {
+        for (auto &primitive: mesh->meshPrimitives) {
+            std::span<const Vertex> primitiveVertices(vertices.data() + primitive.vertexStart, primitive.vertexCount);
+
+            primitive.positionQuantization = VertexFormat::positionQuantization(primitiveVertices,
+                                                                                primitiveMorphDeltas(primitive));
+
+            glm::vec3 boundsMin(std::numeric_limits<float>::max());
+            glm::vec3 boundsMax(std::numeric_limits<float>::lowest());
+            for (const Vertex &vertex: primitiveVertices) {
+                boundsMin = glm::min(boundsMin, vertex.position);
+                boundsMax = glm::max(boundsMax, vertex.position);
+            }
+            glm::vec3 center = primitiveVertices.empty() ? glm::vec3(0.f) : (boundsMin + boundsMax) * 0.5f;
+            // a morphed vertex moves at most the sum of its deltas away
+            std::vector<float> morphReach(primitiveVertices.size(), 0.f);
+            for (const MorphDelta &delta: primitiveMorphDeltas(primitive)) {
+                morphReach[delta.vertex] += glm::length(VertexFormat::morphPosition(delta));
+            }
+            float radius = 0.f;
+            for (size_t vertex_i = 0; vertex_i < primitiveVertices.size(); vertex_i++) {
+                radius = std::max(radius, glm::length(primitiveVertices[vertex_i].position - center) +
+                                          morphReach[vertex_i]);
+            }
+            primitive.bounds = glm::vec4(center, radius);
+        }
+    }
+}
+
+void GltfScene::buildLods(const cgltf_data *data, float maxError) {
+    struct PrimitiveJob {
+        MeshPrimitive *primitive;
+        std::vector<uint32_t> lodIndices[MAX_MESH_LODS];
+        float lodErrors[MAX_MESH_LODS];
+        uint32_t lodCount;
+    };
+
+    std::vector<PrimitiveJob> jobs;
+    for (size_t mesh_i = 0; mesh_i < meshes.size(); mesh_i++) {
+        const cgltf_mesh &gltfMesh = data->meshes[mesh_i];
+        for (size_t primitive_i = 0; primitive_i < meshes[mesh_i]->meshPrimitives.size(); primitive_i++) {
+            MeshPrimitive &primitive = meshes[mesh_i]->meshPrimitives[primitive_i];
+            const cgltf_primitive &gltfPrimitive = gltfMesh.primitives[primitive_i];
+
+            primitive.lodCount = 0;
+            if (primitive.hasIndices && gltfPrimitive.type == cgltf_primitive_type_triangles &&
+                primitive.indexCount % 3 == 0 && primitive.bounds.w > 0.f) {
+                jobs.push_back({&primitive});
+            }
+        }
+    }
+
+    auto simplify = [&](size_t job_i) {
+        PrimitiveJob &job = jobs[job_i];
+        const MeshPrimitive &primitive = *job.primitive;
+
+        std::vector<uint32_t> localIndices(indices.begin() + primitive.indexStart,
+                                           indices.begin() + primitive.indexStart + primitive.indexCount);
+        for (uint32_t &index: localIndices) {
+            if (index < primitive.vertexStart || index - primitive.vertexStart >= primitive.vertexCount) {
+                return; // references vertices outside the primitive, drawn at full detail
+            }
+            index -= primitive.vertexStart;
+        }
+        std::span<const Vertex> primitiveVertices(vertices.data() + primitive.vertexStart, primitive.vertexCount);
+
+        // each level is simplified from the previous one, errors are measured against it and summed up
+        float absoluteMaxError = maxError * primitive.bounds.w;
+        float error = 0.f;
+        job.lodCount = 1;
+        const std::vector<uint32_t> *previous = &localIndices;
+        while (job.lodCount < MAX_MESH_LODS) {
+            float levelError = 0.f;
+            size_t targetIndexCount = previous->size() / 6 * 3;
+            std::vector<uint32_t> lod = MeshOpt::simplify(*previous, primitiveVertices, targetIndexCount,
+                                                          absoluteMaxError - error, &levelError);
+
+            // not worth the extra draw
+            if (lod.empty() || lod.size() > previous->size() * 9 / 10) {
+                break;
+            }
+
+            MeshOpt::optimizeVertexCache(lod, primitiveVertices.size());
+            error += levelError;
+            job.lodErrors[job.lodCount] = error;
+            job.lodIndices[job.lodCount] = std::move(lod);
+            previous = &job.lodIndices[job.lodCount];
+            job.lodCount++;
+        }
+    };
+
+    if (m_threadPool) {
+        m_threadPool->parallelFor(jobs.size(), simplify);
+    } else {
+        for (size_t job_i = 0; job_i < jobs.size(); job_i++) {
+            simplify(job_i);
+        }
+    }
+
+    size_t lodIndexCount = 0;
+    for (auto &job: jobs) {
+        MeshPrimitive &primitive = *job.primitive;
+        if (job.lodCount < 2) {
+            continue;
+        }
+
+        primitive.lodCount = job.lodCount;
+        primitive.lods[0] = {primitive.indexStart, primitive.indexCount, 0.f};
+        for (uint32_t lod_i = 1; lod_i < job.lodCount; lod_i++) {
+            const std::vector<uint32_t> &lodIndices = job.lodIndices[lod_i];
+            primitive.lods[lod_i] = {static_cast<uint32_t>(indices.size()), static_cast<uint32_t>(lodIndices.size()),
+                                     job.lodErrors[lod_i]};
+            for (uint32_t index: lodIndices) {
+                indices.push_back(index + primitive.vertexStart);
+            }
+            lodIndexCount += lodIndices.size();
+        }
+    }
+
+    std::cout << path.filename() << ": " << lodIndexCount / 3 << " lod triangles" << std::endl;
+}
+
+void GltfScene::buildMeshlets(const cgltf_data *data) {
+    struct PrimitiveJob {
+        MeshPrimitive *primitive;
+        bool coneCulling;
+        std::vector<Meshlet> meshlets;
+        std::vector<uint32_t> meshletVertices;
+        std::vector<uint32_t> meshletTriangles;
+    };
+
+    // meshes are parsed in gltf order, the source primitive tells the topology and whether it is double sided
+    std::vector<PrimitiveJob> jobs;
+    for (size_t mesh_i = 0; mesh_i < meshes.size(); mesh_i++) {
+        const cgltf_mesh &gltfMesh = data->meshes[mesh_i];
+        for (size_t primitive_i = 0; primitive_i < meshes[mesh_i]->meshPrimitives.size(); primitive_i++) {
+            MeshPrimitive &primitive = meshes[mesh_i]->meshPrimitives[primitive_i];
+            const cgltf_primitive &gltfPrimitive = gltfMesh.primitives[primitive_i];
+            primitive.meshletOffset = 0;
+            primitive.meshletCount = 0;
+
+            if (primitive.hasIndices && gltfPrimitive.type == cgltf_primitive_type_triangles &&
+                primitive.indexCount % 3 == 0) {
+                bool doubleSided = gltfPrimitive.material && gltfPrimitive.material->double_sided;
+                jobs.push_back({&primitive, !doubleSided});
+            }
+        }
+    }
+
+    auto build = [&](size_t job_i) {
+        PrimitiveJob &job = jobs[job_i];
+        const MeshPrimitive &primitive = *job.primitive;
+
+        std::vector<uint32_t> localIndices(indices.begin() + primitive.indexStart,
+                                           indices.begin() + primitive.indexStart + primitive.indexCount);
+        for (uint32_t &index: localIndices) {
+            if (index < primitive.vertexStart || index - primitive.vertexStart >= primitive.vertexCount) {
+                return; // references vertices outside the primitive, drawn without meshlets
+            }
+            index -= primitive.vertexStart;
+        }
+
+        MeshOpt::buildMeshlets(localIndices,
+                               std::span(vertices.data() + primitive.vertexStart, primitive.vertexCount),
+                               job.meshlets, job.meshletVertices, job.meshletTriangles, job.coneCulling);
+    };
+
+    if (m_threadPool) {
+        m_threadPool->parallelFor(jobs.size(), build);
+    } else {
+        for (size_t job_i = 0; job_i < jobs.size(); job_i++) {
+            build(job_i);
+        }
+    }
+
+    meshlets.clear();
+    meshletVertices.clear();
+    meshletTriangles.clear();
+
+    size_t triangleCount = 0;
+    for (auto &job: jobs) {
+        MeshPrimitive &primitive = *job.primitive;
+        primitive.meshletOffset = static_cast<uint32_t>(meshlets.size());
+        primitive.meshletCount = static_cast<uint32_t>(job.meshlets.size());
+
+        for (Meshlet &meshlet: job.meshlets) {
+            meshlet.vertexOffset += static_cast<uint32_t>(meshletVertices.size());
+            meshlet.triangleOffset += static_cast<uint32_t>(meshletTriangles.size());
+            meshlet.indexOffset += primitive.indexStart;
+            meshlets.push_back(meshlet);
+        }
+        for (uint32_t vertex: job.meshletVertices) {
+            meshletVertices.push_back(vertex + primitive.vertexStart);
+        }
+        meshletTriangles.insert(meshletTriangles.end(), job.meshletTriangles.begin(), job.meshletTriangles.end());
+        triangleCount += job.meshletTriangles.size();
+    }
+
+    std::cout << path.filename() << ": " << meshlets.size() << " meshlets for " << triangleCount << " triangles"
+              << std::endl;
 }
 
 void GltfScene::parseNodes(const cgltf_data *data) {
@@ -619,6 +1310,16 @@ void GltfScene::parseNodes(const cgltf_data *data) {
 
         if (gltfNode.mesh != nullptr) {
             newNode->mesh = meshes[gltfNode.mesh - data->meshes];
+
+            // node weights override the mesh's, targets without either start at 0
+            if (gltfNode.weights_count != 0) {
+                newNode->weights.assign(gltfNode.weights, gltfNode.weights + gltfNode.weights_count);
+            } else {
+                newNode->weights = newNode->mesh->weights;
+            }
+            for (const auto &primitive: newNode->mesh->meshPrimitives) {
+                newNode->weights.resize(std::max<size_t>(newNode->weights.size(), primitive.morphTargetCount), 0.f);
+            }
         }
 
         newNode->translation = {
@@ -668,260 +1369,203 @@ void GltfScene::parseNodes(const cgltf_data *data) {
 
 void GltfScene::parseAnimations(const cgltf_data *data) {
     for (size_t animation_i = 0; animation_i < data->animations_count; animation_i++) {
-        const cgltf_animation *gltfAnimation = &data->animations[animation_i];
-        Animation animation = {};
-
-        if (gltfAnimation->name) {
-            animation.name = gltfAnimation->name;
-        }
-
-        for (size_t sampler_i = 0; sampler_i < gltfAnimation->samplers_count; sampler_i++) {
-            const cgltf_animation_sampler *gltfSampler = &gltfAnimation->samplers[sampler_i];
-            AnimationSampler sampler = {};
-
-            switch (gltfSampler->interpolation) {
-                case cgltf_interpolation_type_linear:
-                    sampler.interpolation = AnimationSampler::Interpolation::eLinear;
-                    break;
-                case cgltf_interpolation_type_step:
-                    sampler.interpolation = AnimationSampler::Interpolation::eStep;
-                    break;
-                case cgltf_interpolation_type_cubic_spline:
-                    sampler.interpolation = AnimationSampler::Interpolation::eCubicSpline;
-                    break;
-                default:
-                    sampler.interpolation = AnimationSampler::Interpolation::eLinear;
-                    break;
-            }
-
-            const cgltf_accessor *inputAccessor = gltfSampler->input;
-            const cgltf_buffer_view *inputBufferView = inputAccessor->buffer_view;
-            const auto *inputBuffer = static_cast<const std::byte *>(inputBufferView->buffer->data);
-            const auto *input = reinterpret_cast<const float *>(&inputBuffer[inputAccessor->offset +
-                                                                             inputBufferView->offset]);
-
-            for (size_t input_i = 0; input_i < inputAccessor->count; input_i++) {
-                sampler.inputs.emplace_back(input[input_i]);
-            }
-
-            const cgltf_accessor *outputAccessor = gltfSampler->output;
-            const cgltf_buffer_view *outputBufferView = outputAccessor->buffer_view;
-            const auto *outputBuffer = static_cast<const std::byte *>(outputBufferView->buffer->data);
-
-            switch (outputAccessor->type) {
-                case cgltf_type_vec3: {
-                    const auto *output = reinterpret_cast<const glm::vec3 *>(&outputBuffer[outputAccessor->offset +
-                                                                                           outputBufferView->offset]);
-                    for (size_t output_i = 0; output_i < outputAccessor->count; output_i++) {
-                        sampler.outputs.emplace_back(output[output_i], 0.f);
-                    }
-                    break;
-                }
-                case cgltf_type_vec4: {
-                    const auto *output = reinterpret_cast<const glm::vec4 *>(&outputBuffer[outputAccessor->offset +
-                                                                                           outputBufferView->offset]);
-                    for (size_t output_i = 0; output_i < outputAccessor->count; output_i++) {
-                        sampler.outputs.emplace_back(output[output_i]);
-                    }
-                    break;
-                }
-                default: {
-                    std::cout << "Invalid animation sampler output type" << std::endl;
-                    break;
+        animations.emplace_back(AnimationClip::parse(data, &data->animations[animation_i]));
+    }
+}
+
+void GltfScene::validateAnimations() {
+    for (auto &animation: animations) {
+        size_t channelCount = animation.channels.size();
+        size_t dropped = AnimationClip::validate(animation, nodes.size());
+        if (dropped > 0) {
+            std::cerr << "Dropped " << dropped << " of " << channelCount << " channels of animation \""
+                      << animation.name << "\" in " << path << std::endl;
+        }
+    }
+}
+
+void GltfScene::compressAnimations() {
+    size_t rawSize = 0;
+    size_t compressedSize = 0;
+    for (auto &animation: animations) {
+        rawSize += AnimationClip::memorySize(animation);
+        AnimationClip::compress(animation);
+        compressedSize += AnimationClip::memorySize(animation);
+    }
+
+    if (rawSize > 0) {
+        std::cout << "Compressed animations of " << path << " from " << rawSize << " to " << compressedSize
+                  << " bytes" << std::endl;
+    }
+}
+
+GltfScene::~GltfScene() {
+    clear();
+}
+
+void GltfScene::linkNodes() {
+    std::unordered_map<const Node *, uint32_t> nodeIndices;
+    for (size_t node_i = 0; node_i < nodes.size(); node_i++) {
+        nodeIndices[nodes[node_i].get()] = static_cast<uint32_t>(node_i);
+    }
+
+    // depth first from every top level node, so each subtree is a contiguous range right after its root
+    std::vector<uint32_t> order;
+    std::vector<uint32_t> parents(nodes.size(), UINT32_MAX);
+    std::vector<bool> visited(nodes.size(), false);
+    std::stack<uint32_t> nodeStack;
+    for (const auto &topLevelNode: topLevelNodes) {
+        nodeStack.push(nodeIndices.at(topLevelNode.get()));
+        while (!nodeStack.empty()) {
+            uint32_t node_i = nodeStack.top();
+            nodeStack.pop();
+            if (visited[node_i]) {
+                continue;
+            }
+            visited[node_i] = true;
+            order.push_back(node_i);
+
+            for (const auto &child: nodes[node_i]->children) {
+                uint32_t child_i = nodeIndices.at(child.get());
+                if (!visited[child_i]) {
+                    parents[child_i] = node_i;
+                    nodeStack.push(child_i);
                 }
             }
+        }
+    }
 
-            for (const auto &timestamp: sampler.inputs) {
-                if (timestamp < animation.start) {
-                    animation.start = timestamp;
-                }
-                if (timestamp > animation.end) {
-                    animation.end = timestamp;
-                }
+    // only a cycle leaves nodes unreached, they are kept as top level nodes so every index stays valid
+    if (order.size() < nodes.size()) {
+        std::cerr << "Node hierarchy of " << path << " has a cycle, " << nodes.size() - order.size()
+                  << " nodes are detached from it" << std::endl;
+        for (uint32_t node_i = 0; node_i < nodes.size(); node_i++) {
+            if (!visited[node_i]) {
+                parents[node_i] = UINT32_MAX;
+                order.push_back(node_i);
             }
+        }
+    }
+
+    std::vector<uint32_t> flatIndices(nodes.size());
+    for (uint32_t flat_i = 0; flat_i < order.size(); flat_i++) {
+        flatIndices[order[flat_i]] = flat_i;
+    }
 
-            animation.samplers.emplace_back(sampler);
+    std::vector<std::shared_ptr<Node> > flatNodes;
+    flatNodes.reserve(nodes.size());
+    nodeParents.resize(nodes.size());
+    nodeMatrices.resize(nodes.size());
+    meshNodes.clear();
+    for (uint32_t flat_i = 0; flat_i < order.size(); flat_i++) {
+        uint32_t parent_i = parents[order[flat_i]];
+        flatNodes.push_back(nodes[order[flat_i]]);
+        nodeParents[flat_i] = parent_i == UINT32_MAX ? UINT32_MAX : flatIndices[parent_i];
+        nodeMatrices[flat_i] = flatNodes.back()->matrix;
+        if (flatNodes.back()->mesh) {
+            meshNodes.push_back(flat_i);
         }
+    }
+    nodes = std::move(flatNodes);
 
-        for (size_t channel_i = 0; channel_i < gltfAnimation->channels_count; channel_i++) {
-            const cgltf_animation_channel *gltfChannel = &gltfAnimation->channels[channel_i];
-            AnimationChannel channel = {};
+    // children come after their parent, so walking backwards every subtree is complete before its parent's
+    nodeSubtreeEnds.resize(nodes.size());
+    for (uint32_t flat_i = 0; flat_i < nodes.size(); flat_i++) {
+        nodeSubtreeEnds[flat_i] = flat_i + 1;
+    }
+    for (size_t flat_i = nodes.size(); flat_i-- > 0;) {
+        if (nodeParents[flat_i] != UINT32_MAX) {
+            uint32_t &parentEnd = nodeSubtreeEnds[nodeParents[flat_i]];
+            parentEnd = std::max(parentEnd, nodeSubtreeEnds[flat_i]);
+        }
+    }
 
-            switch (gltfChannel->target_path) {
-                case cgltf_animation_path_type_rotation:
-                    channel.path = AnimationChannel::Path::eRotation;
-                    break;
-                case cgltf_animation_path_type_scale:
-                    channel.path = AnimationChannel::Path::eScale;
-                    break;
-                case cgltf_animation_path_type_translation:
-                    channel.path = AnimationChannel::Path::eTranslation;
-                    break;
-                case cgltf_animation_path_type_weights:
-                    channel.path = AnimationChannel::Path::eWeights;
-                    break;
-                default:
-                    std::cout << "Invalid animation channel path" << std::endl;
-                    break;
+    // channels were validated against the node count, skin indices come from the source or the cache unchecked
+    for (auto &animation: animations) {
+        for (auto &channel: animation.channels) {
+            channel.nodeIndex = flatIndices[channel.nodeIndex];
+        }
+    }
+    for (auto &skin: skins) {
+        if (skin->skeletonNodeIndex < nodes.size()) {
+            skin->skeletonNodeIndex = flatIndices[skin->skeletonNodeIndex];
+        }
+        for (uint32_t &joint: skin->jointNodeIndices) {
+            if (joint < nodes.size()) {
+                joint = flatIndices[joint];
             }
+        }
+    }
 
-            channel.nodeIndex = gltfChannel->target_node - data->nodes;
-            channel.samplerIndex = gltfChannel->sampler - gltfAnimation->samplers;
+    restPose = AnimationClip::restPose(nodes);
+    computeWorldTransforms(restPose);
 
-            animation.channels.emplace_back(channel);
-        }
+    restMeshTransforms.resize(meshNodes.size());
+    restJoints.resize(std::accumulate(skinJointCounts.begin(), skinJointCounts.end(), size_t(0)));
+    writeTransforms(restPose, restMeshTransforms.data(), restJoints.data());
+}
 
-        animations.emplace_back(animation);
+void GltfScene::animate(AnimationState &state, float deltaTime, Pose &pose) const {
+    if (state.clip < animations.size()) {
+        AnimationClip::play(animations[state.clip], state, deltaTime, pose);
     }
+    computeWorldTransforms(pose);
 }
 
-GltfScene::~GltfScene() {
-    clear();
-}
+void GltfScene::computeWorldTransforms(Pose &pose) const {
+    if (pose.changedNodes.empty()) {
+        return;
+    }
 
-void GltfScene::updateAnimation(float deltaTime) {
-    for (auto &animation: animations) {
-        animation.currentTime += deltaTime;
-        while (animation.currentTime > animation.end) {
-            animation.currentTime -= animation.end;
+    // flag the path up to the root of every changed node, stopping at the first ancestor already flagged
+    for (uint32_t node_i: pose.changedNodes) {
+        while (node_i != UINT32_MAX && !(pose.nodeFlags[node_i] & Pose::eSubtreeChanged)) {
+            pose.nodeFlags[node_i] |= Pose::eSubtreeChanged;
+            node_i = nodeParents[node_i];
         }
+    }
 
-        for (auto &channel: animation.channels) {
-            const AnimationSampler &sampler = animation.samplers[channel.samplerIndex];
-
-            if (sampler.inputs.size() > sampler.outputs.size()) {
-                std::cout << "Invalid sampler input/output sizes" << std::endl;
-            }
-
-            for (size_t timestamp_i = 0; timestamp_i < sampler.inputs.size() - 1; timestamp_i++) {
-                if (animation.currentTime > sampler.inputs[timestamp_i] &&
-                    animation.currentTime < sampler.inputs[timestamp_i + 1]) {
-                    float td = sampler.inputs[timestamp_i + 1] - sampler.inputs[timestamp_i];
-                    float interpolateValue = (animation.currentTime - sampler.inputs[timestamp_i]) / td;
-
-                    switch (sampler.interpolation) {
-                        case AnimationSampler::eLinear: {
-                            if (sampler.inputs.size() != sampler.outputs.size()) {
-                                std::cout << "input/output size must be equal for linear interpolation" << std::endl;
-                            }
-                            switch (channel.path) {
-                                case AnimationChannel::eTranslation: {
-                                    nodes[channel.nodeIndex]->translation = glm::mix(
-                                            sampler.outputs[timestamp_i], sampler.outputs[timestamp_i + 1],
-                                            interpolateValue
-                                    );
-                                    break;
-                                }
-                                case AnimationChannel::eRotation: {
-                                    glm::quat q1;
-                                    q1.x = sampler.outputs[timestamp_i].x;
-                                    q1.y = sampler.outputs[timestamp_i].y;
-                                    q1.z = sampler.outputs[timestamp_i].z;
-                                    q1.w = sampler.outputs[timestamp_i].w;
-
-                                    glm::quat q2;
-                                    q2.x = sampler.outputs[timestamp_i + 1].x;
-                                    q2.y = sampler.outputs[timestamp_i + 1].y;
-                                    q2.z = sampler.outputs[timestamp_i + 1].z;
-                                    q2.w = sampler.outputs[timestamp_i + 1].w;
-
-                                    nodes[channel.nodeIndex]->rotation = glm::normalize(
-                                            glm::slerp(q1, q2, interpolateValue));
-                                    break;
-                                }
-                                case AnimationChannel::eScale: {
-                                    nodes[channel.nodeIndex]->scale = glm::mix(
-                                            sampler.outputs[timestamp_i], sampler.outputs[timestamp_i + 1],
-                                            interpolateValue
-                                    );
-                                    break;
-                                }
-                                case AnimationChannel::eWeights: {
-                                    std::cout << "weights animation channel not yet supported" << std::endl;
-                                }
-                            }
-                            break;
-                        }
-                        case AnimationSampler::eCubicSpline: {
-                            if (sampler.inputs.size() * 3 != sampler.outputs.size()) {
-                                std::cout << "output size must be 3x input for cubic spline interpolation" << std::endl;
-                            }
-
-                            float t = interpolateValue;
-                            float t2 = t * t;
-                            float t3 = t2 * t;
-
-                            glm::vec4 ak = sampler.outputs[timestamp_i * 3];
-                            glm::vec4 vk = sampler.outputs[timestamp_i * 3 + 1];
-                            glm::vec4 bk = sampler.outputs[timestamp_i * 3 + 2];
-
-                            glm::vec4 ak_p1 = sampler.outputs[(timestamp_i + 1) * 3];
-                            glm::vec4 vk_p1 = sampler.outputs[(timestamp_i + 1) * 3 + 1];
-
-                            // calculation per gltf spec
-                            glm::vec4 result = (2 * t3 - 3 * t2 + 1) * vk +
-                                               td * (t3 - 2 * t2 + t) * bk +
-                                               (-2 * t3 + 3 * t2) * vk_p1 +
-                                               td * (t3 - t2) * ak_p1;
-
-                            switch (channel.path) {
-                                case AnimationChannel::eTranslation: {
-                                    nodes[channel.nodeIndex]->translation = result;
-                                    break;
-                                }
-                                case AnimationChannel::eRotation: {
-                                    result = normalize(result);
-                                    glm::quat quat;
-                                    quat.x = result.x;
-                                    quat.y = result.y;
-                                    quat.z = result.z;
-                                    quat.w = result.w;
-                                    nodes[channel.nodeIndex]->rotation = quat;
-                                    break;
-                                }
-                                case AnimationChannel::eScale: {
-                                    nodes[channel.nodeIndex]->scale = result;
-                                    break;
-                                }
-                                case AnimationChannel::eWeights: {
-                                    std::cout << "weights animation channel not yet supported" << std::endl;
-                                }
-                            }
-                            break;
-                        }
-                        case AnimationSampler::eStep: {
-                            if (sampler.inputs.size() != sampler.outputs.size()) {
-                                std::cout << "input/output size must be equal for step interpolation" << std::endl;
-                            }
-
-                            switch (channel.path) {
-                                case AnimationChannel::eTranslation: {
-                                    nodes[channel.nodeIndex]->translation = sampler.outputs[timestamp_i];
-                                    break;
-                                }
-                                case AnimationChannel::eRotation: {
-                                    glm::quat quat;
-                                    quat.x = sampler.outputs[timestamp_i].x;
-                                    quat.y = sampler.outputs[timestamp_i].y;
-                                    quat.z = sampler.outputs[timestamp_i].z;
-                                    quat.w = sampler.outputs[timestamp_i].w;
-                                    nodes[channel.nodeIndex]->rotation = quat;
-                                    break;
-                                }
-                                case AnimationChannel::eScale: {
-                                    nodes[channel.nodeIndex]->scale = sampler.outputs[timestamp_i];
-                                    break;
-                                }
-                                case AnimationChannel::eWeights: {
-                                    std::cout << "weights animation channel not yet supported" << std::endl;
-                                    break;
-                                }
-                            }
-                            break;
-                        }
-                    }
-                    break;
-                }
+    uint32_t node_i = 0;
+    while (node_i < nodeParents.size()) {
+        uint8_t flags = pose.nodeFlags[node_i];
+        uint32_t parent_i = nodeParents[node_i];
+        bool parentMoved = parent_i != UINT32_MAX && (pose.nodeFlags[parent_i] & Pose::eWorldChanged);
+        if (!parentMoved && !(flags & Pose::eSubtreeChanged)) {
+            node_i = nodeSubtreeEnds[node_i];
+            continue;
+        }
+
+        if (flags & Pose::eLocalChanged) {
+            pose.localTransforms[node_i] = glm::translate(glm::mat4(1.f), pose.translations[node_i]) *
+                                           glm::toMat4(pose.rotations[node_i]) *
+                                           glm::scale(glm::mat4(1.f), pose.scales[node_i]) * nodeMatrices[node_i];
+        }
+        if (parentMoved || (flags & Pose::eLocalChanged)) {
+            pose.worldTransforms[node_i] = parent_i == UINT32_MAX
+                                               ? pose.localTransforms[node_i]
+                                               : pose.worldTransforms[parent_i] * pose.localTransforms[node_i];
+            pose.nodeFlags[node_i] |= Pose::eWorldChanged;
+        }
+        node_i++;
+    }
+
+    std::fill(pose.nodeFlags.begin(), pose.nodeFlags.end(), 0);
+    pose.changedNodes.clear();
+}
+
+void GltfScene::writeTransforms(const Pose &pose, glm::mat4 *meshTransforms, glm::mat4 *joints) const {
+    for (size_t meshNode_i = 0; meshNode_i < meshNodes.size(); meshNode_i++) {
+        uint32_t node_i = meshNodes[meshNode_i];
+        const Node &node = *nodes[node_i];
+        meshTransforms[meshNode_i] = pose.worldTransforms[node_i];
+
+        if (node.hasSkin) {
+            glm::mat4 inverseWorldTransform = glm::inverse(pose.worldTransforms[node_i]);
+            const Skin *skin = skins[node.skin].get();
+            glm::mat4 *skinJoints = joints + jointOffsets[node.skin];
+            for (size_t joint_i = 0; joint_i < skin->jointNodeIndices.size(); joint_i++) {
+                skinJoints[joint_i] = inverseWorldTransform * pose.worldTransforms[skin->jointNodeIndices[joint_i]] *
+                                      skin->inverseBindMatrices[joint_i];
             }
         }
     }
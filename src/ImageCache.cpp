@@ -0,0 +1,58 @@
+#include "ImageCache.h"
+
+#include "VulkanContext.h"
+
+SharedImage::SharedImage(VulkanContext *vulkanContext, const VulkanImage &image, uint64_t uploadValue,
+                         size_t sizeBytes)
+        : image(image), uploadValue(uploadValue), sizeBytes(sizeBytes), m_vulkanContext(vulkanContext) {
+}
+
+SharedImage::~SharedImage() {
+    m_vulkanContext->uploadManager.wait(uploadValue);
+    m_vulkanContext->destroyImage(image);
+}
+
+std::shared_ptr<SharedImage> ImageCache::find(uint64_t key) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_stats.lookups++;
+
+    auto it = m_images.find(key);
+    if (it == m_images.end()) {
+        return nullptr;
+    }
+
+    std::shared_ptr<SharedImage> image = it->second.lock();
+    if (!image) {
+        m_images.erase(it);
+        return nullptr;
+    }
+
+    m_stats.hits++;
+    m_stats.bytesSaved += image->sizeBytes;
+    return image;
+}
+
+std::shared_ptr<SharedImage> ImageCache::insert(uint64_t key, const std::shared_ptr<SharedImage> &image) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    auto [it, inserted] = m_images.try_emplace(key, image);
+    if (inserted) {
+        return image;
+    }
+
+    // decoded on two threads at once, the first one wins and the other copy is dropped
+    std::shared_ptr<SharedImage> existing = it->second.lock();
+    if (!existing) {
+        it->second = image;
+        return image;
+    }
+
+    m_stats.hits++;
+    m_stats.bytesSaved += existing->sizeBytes;
+    return existing;
+}
+
+ImageCache::Stats ImageCache::stats() const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_stats;
+}
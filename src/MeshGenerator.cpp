@@ -1,24 +1,16 @@
 #include <numbers>
 #include "MeshGenerator.h"
 #include "CalcTangents.h"
+#include "VertexFormat.h"
 
 void generateTangents(MeshBuffers &meshBuffers) {
-    CalcTangents mikktspace;
-    CalcTangentData tangentData = {
-            meshBuffers.indices,
-            meshBuffers.vertices,
-            { // pass only relevant data to calc tangent
-                    .indexStart = 0,
-                    .indexCount = static_cast<uint32_t>(meshBuffers.indices.size()),
-            }
+    MeshPrimitive primitive = { // pass only relevant data to calc tangent
+            .indexStart = 0,
+            .vertexStart = 0,
+            .indexCount = static_cast<uint32_t>(meshBuffers.indices.size()),
+            .vertexCount = static_cast<uint32_t>(meshBuffers.vertices.size()),
     };
-    mikktspace.calculate(&tangentData);
-    for (auto& vertex : meshBuffers.vertices) {
-        vertex.bitangent =
-                glm::vec4(glm::cross(vertex.normal,
-                                     glm::vec3(vertex.tangent.x, vertex.tangent.y, vertex.tangent.z)),
-                          vertex.tangent.w);
-    }
+    CalcTangents().calculate(meshBuffers.indices, meshBuffers.vertices, std::span(&primitive, 1));
 }
 
 MeshBuffers createCubeMesh(float edgeX, float edgeY, float edgeZ) {
@@ -135,6 +127,7 @@ MeshBuffers createCubeMesh(float edgeX, float edgeY, float edgeZ) {
     };
 
     generateTangents(meshBuffers);
+    meshBuffers.positionQuantization = VertexFormat::positionQuantization(meshBuffers.vertices);
 
     return meshBuffers;
 }
@@ -190,6 +183,7 @@ MeshBuffers createSphereMesh(float radius, uint32_t meridians, uint32_t parallel
     }
 
     generateTangents(meshBuffers);
+    meshBuffers.positionQuantization = VertexFormat::positionQuantization(meshBuffers.vertices);
 
     return meshBuffers;
 
@@ -0,0 +1,896 @@
+#include "MeshOptimizer.h"
+
+#include <algorithm>
+#include <bit>
+#include <cmath>
+#include <cstring>
+#include <numeric>
+#include <tuple>
+
+#include "Utils.h"
+
+namespace MeshOpt {
+    // triangles using each vertex, as offsets into one flat list
+    struct TriangleAdjacency {
+        std::vector<uint32_t> offsets;
+        std::vector<uint32_t> counts;
+        std::vector<uint32_t> triangles;
+    };
+
+    static TriangleAdjacency buildAdjacency(std::span<const uint32_t> indices, size_t vertexCount) {
+        TriangleAdjacency adjacency = {};
+        adjacency.offsets.resize(vertexCount);
+        adjacency.counts.resize(vertexCount, 0);
+        adjacency.triangles.resize(indices.size());
+
+        for (uint32_t index: indices) {
+            adjacency.counts[index]++;
+        }
+
+        uint32_t offset = 0;
+        for (size_t vertex_i = 0; vertex_i < vertexCount; vertex_i++) {
+            adjacency.offsets[vertex_i] = offset;
+            offset += adjacency.counts[vertex_i];
+        }
+
+        std::vector<uint32_t> fill = adjacency.offsets;
+        for (size_t index_i = 0; index_i < indices.size(); index_i++) {
+            adjacency.triangles[fill[indices[index_i]]++] = static_cast<uint32_t>(index_i / 3);
+        }
+
+        return adjacency;
+    }
+
+    size_t weldVertices(std::span<Vertex> vertices, std::vector<uint32_t> &indices, float epsilon) {
+        static_assert(sizeof(Vertex) % sizeof(float) == 0, "vertex is compared as an array of floats");
+        constexpr size_t COMPONENT_COUNT = sizeof(Vertex) / sizeof(float);
+        constexpr uint32_t EMPTY_SLOT = UINT32_MAX;
+
+        // raw bits, or grid cells, of every component
+        std::vector<uint32_t> keys(vertices.size() * COMPONENT_COUNT);
+        for (size_t vertex_i = 0; vertex_i < vertices.size(); vertex_i++) {
+            uint32_t *key = &keys[vertex_i * COMPONENT_COUNT];
+            if (epsilon > 0.f) {
+                float components[COMPONENT_COUNT];
+                memcpy(components, &vertices[vertex_i], sizeof(Vertex));
+                for (size_t c = 0; c < COMPONENT_COUNT; c++) {
+                    key[c] = static_cast<uint32_t>(static_cast<int32_t>(std::floor(components[c] / epsilon + 0.5f)));
+                }
+            } else {
+                memcpy(key, &vertices[vertex_i], sizeof(Vertex));
+            }
+        }
+
+        // open addressing, the table holds the first input vertex of every unique key
+        size_t tableSize = std::bit_ceil(std::max<size_t>(vertices.size() * 2, 16));
+        std::vector<uint32_t> table(tableSize, EMPTY_SLOT);
+        std::vector<uint32_t> remap(vertices.size());
+        size_t keyBytes = COMPONENT_COUNT * sizeof(uint32_t);
+        size_t uniqueCount = 0;
+
+        for (size_t vertex_i = 0; vertex_i < vertices.size(); vertex_i++) {
+            const uint32_t *key = &keys[vertex_i * COMPONENT_COUNT];
+            size_t slot = hashBytes(key, keyBytes) & (tableSize - 1);
+
+            while (table[slot] != EMPTY_SLOT && memcmp(&keys[table[slot] * COMPONENT_COUNT], key, keyBytes) != 0) {
+                slot = (slot + 1) & (tableSize - 1);
+            }
+
+            if (table[slot] == EMPTY_SLOT) {
+                table[slot] = static_cast<uint32_t>(vertex_i);
+                remap[vertex_i] = static_cast<uint32_t>(uniqueCount);
+                vertices[uniqueCount++] = vertices[vertex_i];
+            } else {
+                remap[vertex_i] = remap[table[slot]];
+            }
+        }
+
+        indices = std::move(remap);
+        return uniqueCount;
+    }
+
+    VertexCacheStats analyzeVertexCache(std::span<const uint32_t> indices, size_t vertexCount, uint32_t cacheSize) {
+        VertexCacheStats stats = {};
+        if (indices.size() < 3) {
+            return stats;
+        }
+
+        // a vertex is cached if it was loaded less than cacheSize misses ago
+        std::vector<uint32_t> loadedAt(vertexCount, 0);
+        std::vector<bool> referenced(vertexCount, false);
+        uint32_t misses = 0;
+        size_t referencedCount = 0;
+
+        for (uint32_t index: indices) {
+            if (loadedAt[index] == 0 || misses + 1 - loadedAt[index] > cacheSize) {
+                misses++;
+                loadedAt[index] = misses;
+            }
+            if (!referenced[index]) {
+                referenced[index] = true;
+                referencedCount++;
+            }
+        }
+
+        stats.acmr = static_cast<float>(misses) / static_cast<float>(indices.size() / 3);
+        stats.atvr = static_cast<float>(misses) / static_cast<float>(referencedCount);
+
+        return stats;
+    }
+
+    void optimizeVertexCache(std::span<uint32_t> indices, size_t vertexCount, uint32_t cacheSize) {
+        size_t triangleCount = indices.size() / 3;
+        if (triangleCount == 0 || vertexCount == 0) {
+            return;
+        }
+
+        TriangleAdjacency adjacency = buildAdjacency(indices, vertexCount);
+
+        std::vector<uint32_t> liveTriangles = adjacency.counts;
+        std::vector<uint32_t> cacheTimestamps(vertexCount, 0);
+        std::vector<bool> emitted(triangleCount, false);
+        std::vector<uint32_t> deadEnd;
+        std::vector<uint32_t> candidates;
+
+        std::vector<uint32_t> output;
+        output.reserve(indices.size());
+
+        uint32_t time = cacheSize + 1;
+        size_t cursor = 0;
+        int64_t fanning = 0;
+
+        while (fanning >= 0) {
+            candidates.clear();
+
+            uint32_t begin = adjacency.offsets[fanning];
+            uint32_t end = begin + adjacency.counts[fanning];
+            for (uint32_t adjacency_i = begin; adjacency_i < end; adjacency_i++) {
+                uint32_t triangle = adjacency.triangles[adjacency_i];
+                if (emitted[triangle]) {
+                    continue;
+                }
+                emitted[triangle] = true;
+
+                for (uint32_t corner = 0; corner < 3; corner++) {
+                    uint32_t vertex = indices[triangle * 3 + corner];
+                    output.push_back(vertex);
+                    deadEnd.push_back(vertex);
+                    candidates.push_back(vertex);
+                    liveTriangles[vertex]--;
+
+                    if (time - cacheTimestamps[vertex] > cacheSize) {
+                        cacheTimestamps[vertex] = time++;
+                    }
+                }
+            }
+
+            // prefer the oldest candidate that is still cached after its remaining triangles are emitted
+            int64_t next = -1;
+            int64_t bestPriority = -1;
+            for (uint32_t vertex: candidates) {
+                if (liveTriangles[vertex] == 0) {
+                    continue;
+                }
+                int64_t priority = 0;
+                if (time - cacheTimestamps[vertex] + 2 * liveTriangles[vertex] <= cacheSize) {
+                    priority = time - cacheTimestamps[vertex];
+                }
+                if (priority > bestPriority) {
+                    bestPriority = priority;
+                    next = vertex;
+                }
+            }
+
+            if (next < 0) {
+                // dead end, back off to recently used vertices, then to the next unprocessed one in input order
+                while (!deadEnd.empty() && next < 0) {
+                    uint32_t vertex = deadEnd.back();
+                    deadEnd.pop_back();
+                    if (liveTriangles[vertex] > 0) {
+                        next = vertex;
+                    }
+                }
+                while (cursor < vertexCount && next < 0) {
+                    if (liveTriangles[cursor] > 0) {
+                        next = static_cast<int64_t>(cursor);
+                    }
+                    cursor++;
+                }
+            }
+
+            fanning = next;
+        }
+
+        std::copy(output.begin(), output.end(), indices.begin());
+    }
+
+    void optimizeOverdraw(std::span<uint32_t> indices, std::span<const Vertex> vertices, float threshold,
+                          uint32_t cacheSize) {
+        size_t triangleCount = indices.size() / 3;
+        if (triangleCount < 2) {
+            return;
+        }
+
+        float meshAcmr = analyzeVertexCache(indices, vertices.size(), cacheSize).acmr;
+
+        // cut where the acmr of the current cluster, simulated from an empty cache, has dropped to within threshold
+        // of the whole mesh, and always where the cache restarts in the original order (a triangle with three misses)
+        std::vector<uint32_t> clusterStarts = {0};
+        std::vector<uint32_t> loadedAt(vertices.size(), 0);
+        std::vector<uint32_t> clusterLoadedAt(vertices.size(), 0);
+        uint32_t misses = 0;
+        uint32_t clusterMissesTotal = 0; // monotonic, so clusterLoadedAt never needs clearing
+        uint32_t clusterBase = 0;
+        uint32_t clusterTriangles = 0;
+
+        auto isMiss = [cacheSize](std::vector<uint32_t> &loaded, uint32_t vertex, uint32_t &counter, uint32_t base) {
+            if (loaded[vertex] <= base || counter + 1 - loaded[vertex] > cacheSize) {
+                counter++;
+                loaded[vertex] = counter;
+                return true;
+            }
+            return false;
+        };
+
+        for (uint32_t triangle_i = 0; triangle_i < triangleCount; triangle_i++) {
+            if (clusterTriangles > 0) {
+                float clusterAcmr = static_cast<float>(clusterMissesTotal - clusterBase) /
+                                    static_cast<float>(clusterTriangles);
+                bool cacheRestart = true;
+                for (uint32_t corner = 0; corner < 3; corner++) {
+                    uint32_t vertex = indices[triangle_i * 3 + corner];
+                    cacheRestart &= loadedAt[vertex] == 0 || misses - loadedAt[vertex] >= cacheSize;
+                }
+
+                if (cacheRestart || clusterAcmr <= meshAcmr * threshold) {
+                    clusterStarts.push_back(triangle_i);
+                    clusterBase = clusterMissesTotal;
+                    clusterTriangles = 0;
+                }
+            }
+
+            for (uint32_t corner = 0; corner < 3; corner++) {
+                uint32_t vertex = indices[triangle_i * 3 + corner];
+                isMiss(loadedAt, vertex, misses, 0);
+                isMiss(clusterLoadedAt, vertex, clusterMissesTotal, clusterBase);
+            }
+            clusterTriangles++;
+        }
+
+        size_t clusterCount = clusterStarts.size();
+        clusterStarts.push_back(static_cast<uint32_t>(triangleCount));
+
+        // area weighted centroid and normal per cluster
+        glm::vec3 meshCentroid(0.f);
+        for (const Vertex &vertex: vertices) {
+            meshCentroid += vertex.position;
+        }
+        meshCentroid /= static_cast<float>(vertices.size());
+
+        std::vector<float> sortKeys(clusterCount);
+        for (size_t cluster_i = 0; cluster_i < clusterCount; cluster_i++) {
+            glm::vec3 centroid(0.f);
+            glm::vec3 normal(0.f);
+            float area = 0.f;
+
+            for (uint32_t triangle_i = clusterStarts[cluster_i]; triangle_i < clusterStarts[cluster_i + 1]; triangle_i++) {
+                const glm::vec3 &p0 = vertices[indices[triangle_i * 3]].position;
+                const glm::vec3 &p1 = vertices[indices[triangle_i * 3 + 1]].position;
+                const glm::vec3 &p2 = vertices[indices[triangle_i * 3 + 2]].position;
+
+                glm::vec3 triangleNormal = glm::cross(p1 - p0, p2 - p0);
+                float triangleArea = glm::length(triangleNormal);
+
+                centroid += (p0 + p1 + p2) * (triangleArea / 3.f);
+                normal += triangleNormal;
+                area += triangleArea;
+            }
+
+            if (area > 0.f) {
+                centroid /= area;
+            }
+            float normalLength = glm::length(normal);
+            if (normalLength > 0.f) {
+                normal /= normalLength;
+            }
+
+            sortKeys[cluster_i] = glm::dot(centroid - meshCentroid, normal);
+        }
+
+        std::vector<uint32_t> clusterOrder(clusterCount);
+        std::iota(clusterOrder.begin(), clusterOrder.end(), 0);
+        std::stable_sort(clusterOrder.begin(), clusterOrder.end(), [&](uint32_t a, uint32_t b) {
+            return sortKeys[a] > sortKeys[b];
+        });
+
+        std::vector<uint32_t> output;
+        output.reserve(indices.size());
+        for (uint32_t cluster_i: clusterOrder) {
+            output.insert(output.end(), indices.begin() + clusterStarts[cluster_i] * 3,
+                          indices.begin() + clusterStarts[cluster_i + 1] * 3);
+        }
+
+        std::copy(output.begin(), output.end(), indices.begin());
+    }
+
+    std::vector<uint32_t> optimizeVertexFetch(std::span<uint32_t> indices, std::span<Vertex> vertices) {
+        constexpr uint32_t UNMAPPED = UINT32_MAX;
+
+        std::vector<uint32_t> remap(vertices.size(), UNMAPPED);
+        uint32_t nextVertex = 0;
+        for (uint32_t &index: indices) {
+            if (remap[index] == UNMAPPED) {
+                remap[index] = nextVertex++;
+            }
+            index = remap[index];
+        }
+        for (uint32_t &mapped: remap) {
+            if (mapped == UNMAPPED) {
+                mapped = nextVertex++;
+            }
+        }
+
+        std::vector<Vertex> reordered(vertices.size());
+        for (size_t vertex_i = 0; vertex_i < vertices.size(); vertex_i++) {
+            reordered[remap[vertex_i]] = vertices[vertex_i];
+        }
+        std::copy(reordered.begin(), reordered.end(), vertices.begin());
+
+        return remap;
+    }
+
+    // sum of squared distances to planes, weighted by triangle area
+    struct Quadric {
+        double a00 = 0, a11 = 0, a22 = 0, a01 = 0, a02 = 0, a12 = 0;
+        double b0 = 0, b1 = 0, b2 = 0;
+        double c = 0;
+        double weight = 0;
+
+        void addPlane(glm::vec3 normal, float distance, float planeWeight) {
+            double x = normal.x, y = normal.y, z = normal.z, d = distance, w = planeWeight;
+            a00 += w * x * x;
+            a11 += w * y * y;
+            a22 += w * z * z;
+            a01 += w * x * y;
+            a02 += w * x * z;
+            a12 += w * y * z;
+            b0 += w * x * d;
+            b1 += w * y * d;
+            b2 += w * z * d;
+            c += w * d * d;
+            weight += w;
+        }
+
+        void add(const Quadric &other) {
+            a00 += other.a00;
+            a11 += other.a11;
+            a22 += other.a22;
+            a01 += other.a01;
+            a02 += other.a02;
+            a12 += other.a12;
+            b0 += other.b0;
+            b1 += other.b1;
+            b2 += other.b2;
+            c += other.c;
+            weight += other.weight;
+        }
+
+        // mean squared distance of point to the planes
+        [[nodiscard]] float error(glm::vec3 point) const {
+            double x = point.x, y = point.y, z = point.z;
+            double sum = a00 * x * x + a11 * y * y + a22 * z * z + 2 * (a01 * x * y + a02 * x * z + a12 * y * z) +
+                         2 * (b0 * x + b1 * y + b2 * z) + c;
+            return weight > 0 ? static_cast<float>(std::abs(sum) / weight) : 0.f;
+        }
+    };
+
+    enum class VertexKind : uint8_t {
+        eManifold,
+        eBorder,
+        eSeam,
+        eLocked,
+    };
+
+    enum class EdgeKind : uint8_t {
+        eInterior,
+        eBorder, // one triangle
+        eSeam, // two triangles that don't share the wedges
+        eComplex, // more than two triangles
+    };
+
+    // border edges are held in place by a plane through the edge, weighted up against the surface planes
+    constexpr float BORDER_QUADRIC_WEIGHT = 10.f;
+
+    std::vector<uint32_t> simplify(std::span<const uint32_t> indices, std::span<const Vertex> vertices,
+                                   size_t targetIndexCount, float targetError, float *error) {
+        const size_t vertexCount = vertices.size();
+
+        // vertices with the same position are wedges of it, linked in a ring. the position is named by its lowest
+        // vertex index
+        std::vector<uint32_t> positionId(vertexCount);
+        std::vector<uint32_t> wedgeNext(vertexCount);
+        {
+            std::vector<uint32_t> order(vertexCount);
+            std::iota(order.begin(), order.end(), 0);
+            std::sort(order.begin(), order.end(), [&](uint32_t a, uint32_t b) {
+                const glm::vec3 &pa = vertices[a].position;
+                const glm::vec3 &pb = vertices[b].position;
+                return std::tie(pa.x, pa.y, pa.z, a) < std::tie(pb.x, pb.y, pb.z, b);
+            });
+
+            for (size_t group = 0; group < vertexCount;) {
+                size_t groupEnd = group + 1;
+                while (groupEnd < vertexCount &&
+                       vertices[order[groupEnd]].position == vertices[order[group]].position) {
+                    groupEnd++;
+                }
+                for (size_t order_i = group; order_i < groupEnd; order_i++) {
+                    positionId[order[order_i]] = order[group];
+                    wedgeNext[order[order_i]] = order[order_i + 1 < groupEnd ? order_i + 1 : group];
+                }
+                group = groupEnd;
+            }
+        }
+
+        auto position = [&](uint32_t vertex) -> const glm::vec3 & {
+            return vertices[vertex].position;
+        };
+
+        std::vector<uint32_t> result;
+        result.reserve(indices.size());
+        for (size_t index_i = 0; index_i + 2 < indices.size(); index_i += 3) {
+            uint32_t p0 = positionId[indices[index_i]];
+            uint32_t p1 = positionId[indices[index_i + 1]];
+            uint32_t p2 = positionId[indices[index_i + 2]];
+            if (p0 != p1 && p1 != p2 && p0 != p2) {
+                result.insert(result.end(), &indices[index_i], &indices[index_i] + 3);
+            }
+        }
+
+        // undirected position edges, one entry per triangle using them, and directed wedge edges
+        std::vector<uint64_t> positionEdges;
+        std::vector<uint64_t> vertexEdges;
+        auto positionEdgeKey = [&](uint32_t v0, uint32_t v1) {
+            uint32_t p0 = positionId[v0];
+            uint32_t p1 = positionId[v1];
+            return (static_cast<uint64_t>(std::min(p0, p1)) << 32) | std::max(p0, p1);
+        };
+        auto vertexEdgeKey = [](uint32_t v0, uint32_t v1) {
+            return (static_cast<uint64_t>(v0) << 32) | v1;
+        };
+        auto updateEdges = [&]() {
+            positionEdges.clear();
+            vertexEdges.clear();
+            for (size_t index_i = 0; index_i < result.size(); index_i += 3) {
+                for (size_t corner = 0; corner < 3; corner++) {
+                    uint32_t v0 = result[index_i + corner];
+                    uint32_t v1 = result[index_i + (corner + 1) % 3];
+                    positionEdges.push_back(positionEdgeKey(v0, v1));
+                    vertexEdges.push_back(vertexEdgeKey(v0, v1));
+                }
+            }
+            std::sort(positionEdges.begin(), positionEdges.end());
+            std::sort(vertexEdges.begin(), vertexEdges.end());
+        };
+        // kind of the triangle edge v0 -> v1
+        auto edgeKind = [&](uint32_t v0, uint32_t v1) {
+            auto range = std::equal_range(positionEdges.begin(), positionEdges.end(), positionEdgeKey(v0, v1));
+            size_t triangleCount = range.second - range.first;
+            if (triangleCount == 1) {
+                return EdgeKind::eBorder;
+            }
+            if (triangleCount > 2) {
+                return EdgeKind::eComplex;
+            }
+            bool shared = std::binary_search(vertexEdges.begin(), vertexEdges.end(), vertexEdgeKey(v1, v0));
+            return shared ? EdgeKind::eInterior : EdgeKind::eSeam;
+        };
+
+        updateEdges();
+
+        // a border vertex sits on exactly two border edges, a seam vertex has two wedges on exactly two seam
+        // edges. anything else that isn't plain manifold is locked
+        std::vector<VertexKind> kinds(vertexCount, VertexKind::eManifold);
+        {
+            std::vector<uint32_t> borderEdges(vertexCount, 0);
+            std::vector<uint32_t> seamSides(vertexCount, 0);
+            std::vector<bool> complex(vertexCount, false);
+            for (size_t index_i = 0; index_i < result.size(); index_i += 3) {
+                for (size_t corner = 0; corner < 3; corner++) {
+                    uint32_t v0 = result[index_i + corner];
+                    uint32_t v1 = result[index_i + (corner + 1) % 3];
+                    uint32_t p0 = positionId[v0];
+                    uint32_t p1 = positionId[v1];
+                    switch (edgeKind(v0, v1)) {
+                        case EdgeKind::eBorder:
+                            borderEdges[p0]++;
+                            borderEdges[p1]++;
+                            break;
+                        case EdgeKind::eSeam:
+                            // seen once from each side
+                            seamSides[p0]++;
+                            seamSides[p1]++;
+                            break;
+                        case EdgeKind::eComplex:
+                            complex[p0] = true;
+                            complex[p1] = true;
+                            break;
+                        default:
+                            break;
+                    }
+                }
+            }
+
+            for (uint32_t vertex = 0; vertex < vertexCount; vertex++) {
+                if (positionId[vertex] != vertex) {
+                    continue;
+                }
+
+                uint32_t wedgeCount = 1;
+                for (uint32_t wedge = wedgeNext[vertex]; wedge != vertex; wedge = wedgeNext[wedge]) {
+                    wedgeCount++;
+                }
+
+                if (complex[vertex]) {
+                    kinds[vertex] = VertexKind::eLocked;
+                } else if (borderEdges[vertex] == 0 && seamSides[vertex] == 0) {
+                    kinds[vertex] = wedgeCount == 1 ? VertexKind::eManifold : VertexKind::eLocked;
+                } else if (borderEdges[vertex] == 2 && seamSides[vertex] == 0 && wedgeCount == 1) {
+                    kinds[vertex] = VertexKind::eBorder;
+                } else if (seamSides[vertex] == 4 && borderEdges[vertex] == 0 && wedgeCount == 2) {
+                    kinds[vertex] = VertexKind::eSeam;
+                } else {
+                    kinds[vertex] = VertexKind::eLocked;
+                }
+            }
+        }
+
+        std::vector<Quadric> quadrics(vertexCount);
+        for (size_t index_i = 0; index_i < result.size(); index_i += 3) {
+            const uint32_t *triangle = &result[index_i];
+            glm::vec3 normal = glm::cross(position(triangle[1]) - position(triangle[0]),
+                                          position(triangle[2]) - position(triangle[0]));
+            float doubleArea = glm::length(normal);
+            if (doubleArea <= 0.f) {
+                continue;
+            }
+            normal /= doubleArea;
+
+            float distance = -glm::dot(normal, position(triangle[0]));
+            for (size_t corner = 0; corner < 3; corner++) {
+                quadrics[positionId[triangle[corner]]].addPlane(normal, distance, doubleArea * 0.5f);
+            }
+
+            for (size_t corner = 0; corner < 3; corner++) {
+                uint32_t v0 = triangle[corner];
+                uint32_t v1 = triangle[(corner + 1) % 3];
+                EdgeKind kind = edgeKind(v0, v1);
+                if (kind != EdgeKind::eBorder && kind != EdgeKind::eSeam) {
+                    continue;
+                }
+
+                glm::vec3 edge = position(v1) - position(v0);
+                float edgeLength = glm::length(edge);
+                if (edgeLength <= 0.f) {
+                    continue;
+                }
+                glm::vec3 edgeNormal = glm::normalize(glm::cross(edge, normal));
+                float edgeDistance = -glm::dot(edgeNormal, position(v0));
+                float edgeWeight = edgeLength * edgeLength * BORDER_QUADRIC_WEIGHT;
+                quadrics[positionId[v0]].addPlane(edgeNormal, edgeDistance, edgeWeight);
+                quadrics[positionId[v1]].addPlane(edgeNormal, edgeDistance, edgeWeight);
+            }
+        }
+
+        struct Collapse {
+            float error;
+            uint32_t from; // positions
+            uint32_t to;
+        };
+
+        auto canCollapse = [&](uint32_t from, uint32_t to, EdgeKind edge) {
+            switch (kinds[from]) {
+                case VertexKind::eManifold:
+                    return edge == EdgeKind::eInterior;
+                case VertexKind::eBorder:
+                    return edge == EdgeKind::eBorder &&
+                           (kinds[to] == VertexKind::eBorder || kinds[to] == VertexKind::eLocked);
+                case VertexKind::eSeam:
+                    return edge == EdgeKind::eSeam &&
+                           (kinds[to] == VertexKind::eSeam || kinds[to] == VertexKind::eLocked);
+                default:
+                    return false;
+            }
+        };
+
+        const float maxErrorSquared = targetError * targetError;
+        float resultErrorSquared = 0.f;
+
+        std::vector<uint32_t> positionIndices;
+        std::vector<Collapse> collapses;
+        std::vector<bool> collapseLocked(vertexCount);
+        std::vector<uint32_t> remap(vertexCount);
+        std::vector<std::pair<uint32_t, uint32_t> > wedgePairs;
+
+        // each pass collapses the cheapest edges whose neighbourhoods don't overlap, then rebuilds the topology
+        while (result.size() > targetIndexCount) {
+            positionIndices.resize(result.size());
+            for (size_t index_i = 0; index_i < result.size(); index_i++) {
+                positionIndices[index_i] = positionId[result[index_i]];
+            }
+            TriangleAdjacency adjacency = buildAdjacency(positionIndices, vertexCount);
+
+            collapses.clear();
+            for (size_t index_i = 0; index_i < result.size(); index_i += 3) {
+                for (size_t corner = 0; corner < 3; corner++) {
+                    uint32_t v0 = result[index_i + corner];
+                    uint32_t v1 = result[index_i + (corner + 1) % 3];
+                    uint32_t p0 = positionId[v0];
+                    uint32_t p1 = positionId[v1];
+
+                    EdgeKind edge = edgeKind(v0, v1);
+                    if (canCollapse(p0, p1, edge)) {
+                        collapses.push_back({quadrics[p0].error(position(p1)), p0, p1});
+                    }
+                    if (canCollapse(p1, p0, edge)) {
+                        collapses.push_back({quadrics[p1].error(position(p0)), p1, p0});
+                    }
+                }
+            }
+            std::sort(collapses.begin(), collapses.end(), [](const Collapse &a, const Collapse &b) {
+                return a.error < b.error;
+            });
+
+            std::fill(collapseLocked.begin(), collapseLocked.end(), false);
+            std::iota(remap.begin(), remap.end(), 0);
+
+            size_t trianglesToRemove = (result.size() - targetIndexCount + 2) / 3;
+            size_t trianglesRemoved = 0;
+            bool collapsed = false;
+
+            for (const Collapse &collapse: collapses) {
+                if (trianglesRemoved >= trianglesToRemove || collapse.error > maxErrorSquared) {
+                    break;
+                }
+                if (collapseLocked[collapse.from] || collapseLocked[collapse.to]) {
+                    continue;
+                }
+
+                const uint32_t *adjacentBegin = &adjacency.triangles[adjacency.offsets[collapse.from]];
+                std::span<const uint32_t> adjacentTriangles(adjacentBegin, adjacency.counts[collapse.from]);
+
+                // reject collapses that flip or fold a remaining triangle
+                bool flips = false;
+                for (uint32_t triangle: adjacentTriangles) {
+                    const uint32_t *corners = &positionIndices[triangle * 3];
+                    if (corners[0] == collapse.to || corners[1] == collapse.to || corners[2] == collapse.to) {
+                        continue; // collapses away
+                    }
+
+                    glm::vec3 before[3];
+                    glm::vec3 after[3];
+                    for (size_t corner = 0; corner < 3; corner++) {
+                        before[corner] = position(corners[corner]);
+                        after[corner] = corners[corner] == collapse.from ? position(collapse.to) : before[corner];
+                    }
+                    glm::vec3 normalBefore = glm::cross(before[1] - before[0], before[2] - before[0]);
+                    glm::vec3 normalAfter = glm::cross(after[1] - after[0], after[2] - after[0]);
+                    // also rejects large rotations, small ones can still add up over many collapses
+                    if (glm::dot(normalBefore, normalAfter) <=
+                        0.25f * glm::length(normalBefore) * glm::length(normalAfter)) {
+                        flips = true;
+                        break;
+                    }
+                }
+                if (flips) {
+                    continue;
+                }
+
+                // every wedge moves to the wedge of the target it shares a triangle with, which keeps seams intact
+                wedgePairs.clear();
+                uint32_t wedge = collapse.from;
+                do {
+                    uint32_t partner = UINT32_MAX;
+                    for (uint32_t triangle: adjacentTriangles) {
+                        const uint32_t *corners = &result[triangle * 3];
+                        if (corners[0] != wedge && corners[1] != wedge && corners[2] != wedge) {
+                            continue;
+                        }
+                        for (size_t corner = 0; corner < 3; corner++) {
+                            if (positionId[corners[corner]] == collapse.to) {
+                                partner = corners[corner];
+                            }
+                        }
+                        if (partner != UINT32_MAX) {
+                            break;
+                        }
+                    }
+                    if (partner == UINT32_MAX) {
+                        break;
+                    }
+                    wedgePairs.emplace_back(wedge, partner);
+                    wedge = wedgeNext[wedge];
+                } while (wedge != collapse.from);
+
+                if (wedge != collapse.from || wedgePairs.empty()) {
+                    continue; // a wedge without a partner
+                }
+
+                for (const auto &[from, to]: wedgePairs) {
+                    remap[from] = to;
+                }
+                quadrics[collapse.to].add(quadrics[collapse.from]);
+
+                collapseLocked[collapse.from] = true;
+                collapseLocked[collapse.to] = true;
+                for (uint32_t triangle: adjacentTriangles) {
+                    for (size_t corner = 0; corner < 3; corner++) {
+                        collapseLocked[positionIndices[triangle * 3 + corner]] = true;
+                    }
+                }
+
+                trianglesRemoved += kinds[collapse.from] == VertexKind::eBorder ? 1 : 2;
+                resultErrorSquared = std::max(resultErrorSquared, collapse.error);
+                collapsed = true;
+            }
+
+            if (!collapsed) {
+                break;
+            }
+
+            size_t writeIndex = 0;
+            for (size_t index_i = 0; index_i < result.size(); index_i += 3) {
+                uint32_t v0 = remap[result[index_i]];
+                uint32_t v1 = remap[result[index_i + 1]];
+                uint32_t v2 = remap[result[index_i + 2]];
+                uint32_t p0 = positionId[v0];
+                uint32_t p1 = positionId[v1];
+                uint32_t p2 = positionId[v2];
+                if (p0 != p1 && p1 != p2 && p0 != p2) {
+                    result[writeIndex++] = v0;
+                    result[writeIndex++] = v1;
+                    result[writeIndex++] = v2;
+                }
+            }
+            result.resize(writeIndex);
+
+            updateEdges();
+        }
+
+        if (error) {
+            *error = std::sqrt(resultErrorSquared);
+        }
+
+        return result;
+    }
+
+    static void computeMeshletBounds(Meshlet &meshlet, std::span<const uint32_t> localIndices,
+                                     std::span<const uint32_t> meshletVertices, std::span<const Vertex> vertices,
+                                     bool coneCulling) {
+        glm::vec3 minPosition = vertices[meshletVertices[0]].position;
+        glm::vec3 maxPosition = minPosition;
+        for (uint32_t vertex: meshletVertices) {
+            minPosition = glm::min(minPosition, vertices[vertex].position);
+            maxPosition = glm::max(maxPosition, vertices[vertex].position);
+        }
+
+        meshlet.center = (minPosition + maxPosition) * 0.5f;
+        meshlet.radius = 0.f;
+        for (uint32_t vertex: meshletVertices) {
+            meshlet.radius = std::max(meshlet.radius, glm::length(vertices[vertex].position - meshlet.center));
+        }
+
+        // the cone is left open (cutoff 1) unless every triangle faces within ~84 degrees of the average
+        meshlet.coneAxis = glm::vec3(0.f, 0.f, 1.f);
+        meshlet.coneCutoff = 1.f;
+        if (!coneCulling) {
+            return;
+        }
+
+        std::vector<glm::vec3> normals;
+        normals.reserve(localIndices.size() / 3);
+        glm::vec3 normalSum(0.f);
+        for (size_t triangle_i = 0; triangle_i + 2 < localIndices.size(); triangle_i += 3) {
+            glm::vec3 p0 = vertices[meshletVertices[localIndices[triangle_i + 0]]].position;
+            glm::vec3 p1 = vertices[meshletVertices[localIndices[triangle_i + 1]]].position;
+            glm::vec3 p2 = vertices[meshletVertices[localIndices[triangle_i + 2]]].position;
+
+            glm::vec3 normal = glm::cross(p1 - p0, p2 - p0);
+            float area = glm::length(normal);
+            if (area <= 0.f) {
+                continue; // degenerate triangles face nowhere
+            }
+            normals.push_back(normal / area);
+            normalSum += normals.back();
+        }
+
+        float axisLength = glm::length(normalSum);
+        if (normals.empty() || axisLength <= 0.f) {
+            return;
+        }
+        glm::vec3 axis = normalSum / axisLength;
+
+        float minDot = 1.f;
+        for (const glm::vec3 &normal: normals) {
+            minDot = std::min(minDot, glm::dot(normal, axis));
+        }
+
+        meshlet.coneAxis = axis;
+        if (minDot > 0.1f) {
+            meshlet.coneCutoff = std::sqrt(1.f - minDot * minDot);
+        }
+    }
+
+    void buildMeshlets(std::span<const uint32_t> indices, std::span<const Vertex> vertices,
+                       std::vector<Meshlet> &meshlets, std::vector<uint32_t> &meshletVertices,
+                       std::vector<uint32_t> &meshletTriangles, bool coneCulling) {
+        constexpr uint32_t UNMAPPED = UINT32_MAX;
+
+        // local index of each vertex in the meshlet being built
+        std::vector<uint32_t> localIndex(vertices.size(), UNMAPPED);
+
+        Meshlet meshlet = {};
+        std::vector<uint32_t> localIndices;
+        localIndices.reserve(MESHLET_MAX_TRIANGLES * 3);
+
+        auto finishMeshlet = [&]() {
+            if (meshlet.triangleCount == 0) {
+                return;
+            }
+
+            std::span<const uint32_t> currentVertices(meshletVertices.data() + meshlet.vertexOffset,
+                                                      meshlet.vertexCount);
+            computeMeshletBounds(meshlet, localIndices, currentVertices, vertices, coneCulling);
+
+            for (uint32_t vertex: currentVertices) {
+                localIndex[vertex] = UNMAPPED;
+            }
+            meshlets.push_back(meshlet);
+
+            meshlet = {};
+            meshlet.vertexOffset = static_cast<uint32_t>(meshletVertices.size());
+            meshlet.triangleOffset = static_cast<uint32_t>(meshletTriangles.size());
+            localIndices.clear();
+        };
+
+        meshlet.vertexOffset = static_cast<uint32_t>(meshletVertices.size());
+        meshlet.triangleOffset = static_cast<uint32_t>(meshletTriangles.size());
+
+        for (size_t triangle_i = 0; triangle_i + 2 < indices.size(); triangle_i += 3) {
+            const uint32_t *triangle = &indices[triangle_i];
+
+            uint32_t newVertices = 0;
+            for (uint32_t corner = 0; corner < 3; corner++) {
+                bool repeated = (corner > 0 && triangle[corner] == triangle[0]) ||
+                                (corner > 1 && triangle[corner] == triangle[1]);
+                if (localIndex[triangle[corner]] == UNMAPPED && !repeated) {
+                    newVertices++;
+                }
+            }
+
+            if (meshlet.vertexCount + newVertices > MESHLET_MAX_VERTICES ||
+                meshlet.triangleCount + 1 > MESHLET_MAX_TRIANGLES) {
+                finishMeshlet();
+            }
+
+            if (meshlet.triangleCount == 0) {
+                meshlet.indexOffset = static_cast<uint32_t>(triangle_i);
+            }
+
+            uint32_t packed = 0;
+            for (uint32_t corner = 0; corner < 3; corner++) {
+                uint32_t vertex = triangle[corner];
+                if (localIndex[vertex] == UNMAPPED) {
+                    localIndex[vertex] = meshlet.vertexCount++;
+                    meshletVertices.push_back(vertex);
+                }
+                localIndices.push_back(localIndex[vertex]);
+                packed |= localIndex[vertex] << (corner * 8);
+            }
+            meshletTriangles.push_back(packed);
+            meshlet.triangleCount++;
+        }
+
+        finishMeshlet();
+    }
+}
@@ -0,0 +1,64 @@
+#include "RangeAllocator.h"
+
+#include <iterator>
+
+uint32_t RangeAllocator::allocate(uint32_t count) {
+    if (count == 0) {
+        return m_size;
+    }
+
+    for (auto it = m_freeRanges.begin(); it != m_freeRanges.end(); it++) {
+        if (it->second < count) {
+            continue;
+        }
+
+        uint32_t offset = it->first;
+        uint32_t remaining = it->second - count;
+        m_freeRanges.erase(it);
+        if (remaining != 0) {
+            m_freeRanges.emplace(offset + count, remaining);
+        }
+        m_freeCount -= count;
+        return offset;
+    }
+
+    uint32_t offset = m_size;
+    m_size += count;
+    return offset;
+}
+
+void RangeAllocator::free(uint32_t offset, uint32_t count) {
+    if (count == 0) {
+        return;
+    }
+
+    auto next = m_freeRanges.lower_bound(offset);
+    if (next != m_freeRanges.end() && offset + count == next->first) {
+        count += next->second;
+        m_freeCount -= next->second;
+        next = m_freeRanges.erase(next);
+    }
+    if (next != m_freeRanges.begin()) {
+        auto prev = std::prev(next);
+        if (prev->first + prev->second == offset) {
+            offset = prev->first;
+            count += prev->second;
+            m_freeCount -= prev->second;
+            m_freeRanges.erase(prev);
+        }
+    }
+
+    if (offset + count == m_size) {
+        m_size = offset;
+        return;
+    }
+
+    m_freeRanges.emplace(offset, count);
+    m_freeCount += count;
+}
+
+void RangeAllocator::reset(uint32_t size) {
+    m_freeRanges.clear();
+    m_size = size;
+    m_freeCount = 0;
+}
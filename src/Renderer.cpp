@@ -3,7 +3,9 @@
 #include <VulkanInit.h>
 #include <VulkanPipeline.h>
 #include <VulkanUtils.h>
-#include <stack>
+#include <algorithm>
+#include <chrono>
+#include <cstddef>
 
 #include <glm/glm.hpp>
 #include <glm/gtc/matrix_transform.hpp>
@@ -21,7 +23,14 @@ static constexpr uint32_t PREFILTERED_CUBE_BINDING = 7;
 static constexpr uint32_t BRDF_LUT_BINDING = 8;
 static constexpr uint32_t TEXTURE_BINDING = 9;
 
-Renderer::Renderer() {
+// sets constant_id 0 (SKINNED) of mesh_bindless.vert and meshlet.mesh
+static VkSpecializationInfo skinnedSpecializationInfo() {
+    static const VkBool32 skinned = VK_TRUE;
+    static const VkSpecializationMapEntry skinnedEntry = {0, 0, sizeof(VkBool32)};
+    return {1, &skinnedEntry, sizeof(VkBool32), &skinned};
+}
+
+Renderer::Renderer(uint32_t threadCount) : m_threadPool(threadCount) {
     setupVulkan();
 }
 
@@ -43,6 +52,9 @@ void Renderer::run() {
         vkWaitForFences(m_vulkanContext.device, 1, &m_vulkanContext.frames[currentFrame].renderFence, VK_TRUE, 1e9);
         VK_CHECK(vkResetFences(m_vulkanContext.device, 1, &m_vulkanContext.frames[currentFrame].renderFence))
 
+        collectRetiredResources(false);
+        integrateLoadedModels();
+
         uint32_t imageIndex;
         VkResult swapchainRet = vkAcquireNextImageKHR(m_vulkanContext.device, m_vulkanContext.swapchain, 1e9,
                                                       m_vulkanContext.frames[currentFrame].imageAvailableSemaphore,
@@ -99,6 +111,8 @@ void Renderer::run() {
 
         VkSubmitInfo2 submit = VkInit::submitInfo(&cmdSubmitInfo, &signalInfo, &waitInfo);
 
+        std::unique_lock<std::mutex> queueLock(m_vulkanContext.queueMutex);
+
         VK_CHECK(
                 vkQueueSubmit2(m_vulkanContext.graphicsQueue, 1, &submit,
                                m_vulkanContext.frames[currentFrame].renderFence))
@@ -115,158 +129,298 @@ void Renderer::run() {
         presentInfo.pImageIndices = &imageIndex;
 
         VkResult presentRet = vkQueuePresentKHR(m_vulkanContext.presentQueue, &presentInfo);
+        queueLock.unlock();
+
         if (presentRet == VK_ERROR_OUT_OF_DATE_KHR) {
             m_vulkanContext.resizeWindow();
         }
 
         currentFrame = (currentFrame + 1) % MAX_CONCURRENT_FRAMES;
+        m_frameNumber++;
+
+        m_vulkanContext.uploadManager.collect();
     }
 }
 
-uint32_t Renderer::loadGltf(std::filesystem::path filePath) {
-    auto scene = std::make_unique<GltfScene>(&m_vulkanContext);
-    scene->load(filePath);
+uint32_t Renderer::loadGltf(std::filesystem::path filePath, const GltfLoadOptions &loadOptions) {
+    auto scene = std::make_unique<GltfScene>(&m_vulkanContext, &m_threadPool, &m_imageCache);
+    scene->load(filePath, loadOptions);
 
     if (!scene->loaded) {
         return LOAD_FAILED;
     }
 
     uint32_t modelId = getLoadedModelId();
+    m_modelDatas.emplace_back();
+
+    addScene(std::move(scene), modelId);
+    flushGeometryUploads();
+
+    return modelId;
+}
+
+uint32_t Renderer::loadGltfAsync(std::filesystem::path filePath, const GltfLoadOptions &loadOptions) {
+    uint32_t modelId = getLoadedModelId();
+    m_modelDatas.emplace_back(); // loading, without draw datas until addScene
+
+    PendingLoad pendingLoad = {};
+    pendingLoad.modelId = modelId;
+    pendingLoad.future = m_threadPool.submit([this, filePath, loadOptions]() {
+        auto scene = std::make_unique<GltfScene>(&m_vulkanContext, &m_threadPool, &m_imageCache);
+        scene->load(filePath, loadOptions);
+        return scene;
+    });
+    m_pendingLoads.push_back(std::move(pendingLoad));
+
+    return modelId;
+}
+
+ModelState Renderer::modelState(uint32_t modelId) const {
+    if (modelId >= m_modelDatas.size()) {
+        return ModelState::eFailed;
+    }
+    return m_modelDatas[modelId].state;
+}
+
+void Renderer::integrateLoadedModels() {
+    bool modelAdded = false;
 
+    for (auto it = m_pendingLoads.begin(); it != m_pendingLoads.end();) {
+        if (!it->scene) {
+            if (it->future.wait_for(std::chrono::seconds(0)) != std::future_status::ready) {
+                it++;
+                continue;
+            }
+
+            it->scene = it->future.get();
+            if (!it->scene->loaded) {
+                std::cerr << "Failed to load model " << it->modelId << std::endl;
+                if (m_modelDatas[it->modelId].state == ModelState::eLoading) {
+                    m_modelDatas[it->modelId].state = ModelState::eFailed;
+                }
+                it = m_pendingLoads.erase(it);
+                continue;
+            }
+        }
+
+        // textures are sampled as soon as their descriptors are written, wait for their copies
+        if (!m_vulkanContext.uploadManager.isComplete(it->scene->uploadValue)) {
+            it++;
+            continue;
+        }
+
+        // unloaded while loading, no frame has seen its images
+        if (m_modelDatas[it->modelId].state == ModelState::eUnloaded) {
+            it = m_pendingLoads.erase(it);
+            continue;
+        }
+
+        addScene(std::move(it->scene), it->modelId);
+        modelAdded = true;
+        it = m_pendingLoads.erase(it);
+    }
+
+    if (modelAdded) {
+        flushGeometryUploads();
+    }
+}
+
+void Renderer::addScene(std::unique_ptr<GltfScene> scene, uint32_t modelId) {
     ModelData modelData = {};
+    modelData.state = ModelState::eResident;
+
+    // packed per primitive, each has its own position quantization. only skinned primitives get skin vertices
+    std::vector<GpuVertex> vertices(scene->vertices.size());
+    std::vector<SkinVertex> skinVertices;
+    for (const auto &mesh: scene->meshes) {
+        for (const auto &primitive: mesh->meshPrimitives) {
+            auto primitiveVertices = std::span(scene->vertices).subspan(primitive.vertexStart, primitive.vertexCount);
+            VertexFormat::pack(primitiveVertices, primitive.positionQuantization, &vertices[primitive.vertexStart]);
+
+            if (primitive.hasSkin) {
+                size_t skinVertexStart = primitive.skinVertexStart;
+                skinVertices.resize(std::max(skinVertices.size(), skinVertexStart + primitive.vertexCount));
+                VertexFormat::packSkin(primitiveVertices, &skinVertices[skinVertexStart]);
+            }
+        }
+    }
 
-    modelData.vertexOffset = m_vertices.size();
-    m_vertices.insert(m_vertices.end(), scene->vertices.begin(), scene->vertices.end());
+    modelData.vertexCount = vertices.size();
+    modelData.vertexOffset = m_vertexArena.allocate(modelData.vertexCount);
+    m_vertexArena.upload(modelData.vertexOffset, vertices.data(), vertices.size());
 
-    modelData.indexOffset = m_indices.size();
-    m_indices.insert(m_indices.end(), scene->indices.begin(), scene->indices.end());
+    modelData.skinVertexCount = skinVertices.size();
+    modelData.skinVertexOffset = m_skinArena.allocate(modelData.skinVertexCount);
+    m_skinArena.upload(modelData.skinVertexOffset, skinVertices.data(), skinVertices.size());
 
     // make sure index points to the right vertex
-    for (size_t index_i = modelData.indexOffset; index_i < m_indices.size(); index_i++) {
-        m_indices[index_i] += modelData.vertexOffset;
+    std::vector<uint32_t> indices = std::move(scene->indices);
+    for (auto &index: indices) {
+        index += modelData.vertexOffset;
     }
 
-    modelData.textureOffset = m_textures.size();
-    m_textures.insert(m_textures.end(), scene->textures.begin(), scene->textures.end());
+    modelData.indexCount = indices.size();
+    modelData.indexOffset = m_indexArena.allocate(modelData.indexCount);
+    m_indexArena.upload(modelData.indexOffset, indices.data(), indices.size());
+
+    std::vector<Meshlet> meshlets = std::move(scene->meshlets);
+    std::vector<uint32_t> meshletVertices = std::move(scene->meshletVertices);
+    std::vector<uint32_t> meshletTriangles = std::move(scene->meshletTriangles);
+
+    modelData.meshletCount = meshlets.size();
+    modelData.meshletVertexCount = meshletVertices.size();
+    modelData.meshletTriangleCount = meshletTriangles.size();
+    modelData.meshletOffset = m_meshletArena.allocate(modelData.meshletCount);
+    modelData.meshletVertexOffset = m_meshletVertexArena.allocate(modelData.meshletVertexCount);
+    modelData.meshletTriangleOffset = m_meshletTriangleArena.allocate(modelData.meshletTriangleCount);
+
+    // make sure meshlets point to their own vertices, triangles and indices
+    for (auto &meshlet: meshlets) {
+        meshlet.vertexOffset += modelData.meshletVertexOffset;
+        meshlet.triangleOffset += modelData.meshletTriangleOffset;
+        meshlet.indexOffset += modelData.indexOffset;
+    }
+    for (auto &vertex: meshletVertices) {
+        vertex += modelData.vertexOffset;
+    }
+
+    m_meshletArena.upload(modelData.meshletOffset, meshlets.data(), meshlets.size());
+    m_meshletVertexArena.upload(modelData.meshletVertexOffset, meshletVertices.data(), meshletVertices.size());
+    m_meshletTriangleArena.upload(modelData.meshletTriangleOffset, meshletTriangles.data(), meshletTriangles.size());
+
+    // deltas and ranges are relative to their primitive, they move as they are
+    modelData.morphDeltaCount = scene->morphDeltas.size();
+    modelData.morphRangeCount = scene->morphRanges.size();
+    modelData.morphDeltaOffset = m_morphDeltaArena.allocate(modelData.morphDeltaCount);
+    modelData.morphRangeOffset = m_morphRangeArena.allocate(modelData.morphRangeCount);
+    m_morphDeltaArena.upload(modelData.morphDeltaOffset, scene->morphDeltas.data(), scene->morphDeltas.size());
+    m_morphRangeArena.upload(modelData.morphRangeOffset, scene->morphRanges.data(), scene->morphRanges.size());
+    scene->morphDeltas = {};
+    scene->morphRanges = {};
+
+    // the arenas hold the only copy of the geometry from here on
+    scene->vertices = {};
+
+    // one bindless slot per distinct image view and sampler, shared by every model using the pair
+    DescriptorWriter writer;
+    uint32_t sharedSlotCount = 0;
+    for (const auto &texture: scene->textures) {
+        auto [it, inserted] = m_textureSlotLookup.try_emplace({texture->imageview, texture->sampler}, 0);
+        if (inserted) {
+            it->second = m_textureSlots.allocate(1);
+            m_textures.resize(std::max<size_t>(m_textures.size(), m_textureSlots.size()));
+            m_textureRefCounts.resize(m_textures.size());
+            m_textures[it->second] = texture;
+            writer.writeImage(TEXTURE_BINDING, texture->imageview, texture->sampler,
+                              VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,
+                              it->second);
+        } else {
+            sharedSlotCount++;
+        }
+        m_textureRefCounts[it->second]++;
+        modelData.textureSlots.push_back(it->second);
+    }
 
-    modelData.materialOffset = m_materials.size();
-    m_materials.insert(m_materials.end(), scene->materials.begin(), scene->materials.end());
+    std::vector<Material> materials = scene->materials;
 
     // make sure material points to the right texture
-    for (size_t material_i = modelData.materialOffset; material_i < m_materials.size(); material_i++) {
-        if (m_materials[material_i].baseTextureOffset == NO_TEXTURE_INDEX) {
-            m_materials[material_i].baseTextureOffset = 0; // opaque white texture at index 0
+    for (auto &material: materials) {
+        if (material.baseTextureOffset == NO_TEXTURE_INDEX) {
+            material.baseTextureOffset = 0; // opaque white texture at index 0
         } else {
-            m_materials[material_i].baseTextureOffset += modelData.textureOffset;
+            material.baseTextureOffset = modelData.textureSlots[material.baseTextureOffset];
         }
 
-        if (m_materials[material_i].metallicRoughnessTextureOffset == NO_TEXTURE_INDEX) {
-            m_materials[material_i].metallicRoughnessTextureOffset = 1; // <0.0, 1.0, 1.0> texture at index 1
+        if (material.metallicRoughnessTextureOffset == NO_TEXTURE_INDEX) {
+            material.metallicRoughnessTextureOffset = 1; // <0.0, 1.0, 1.0> texture at index 1
         } else {
-            m_materials[material_i].metallicRoughnessTextureOffset += modelData.textureOffset;
+            material.metallicRoughnessTextureOffset = modelData.textureSlots[material.metallicRoughnessTextureOffset];
         }
 
-        if (m_materials[material_i].normalTextureOffset == NO_TEXTURE_INDEX) {
-            m_materials[material_i].normalTextureOffset = 2; // <0.5, 0.5, 1.0> texture at index 2
+        if (material.normalTextureOffset == NO_TEXTURE_INDEX) {
+            material.normalTextureOffset = 2; // <0.5, 0.5, 1.0> texture at index 2
         } else {
-            m_materials[material_i].normalTextureOffset += modelData.textureOffset;
+            material.normalTextureOffset = modelData.textureSlots[material.normalTextureOffset];
         }
 
-        if (m_materials[material_i].emissiveTextureOffset == NO_TEXTURE_INDEX) {
-            m_materials[material_i].emissiveTextureOffset = 0; // opaque white texture at index 0
+        if (material.emissiveTextureOffset == NO_TEXTURE_INDEX) {
+            material.emissiveTextureOffset = 0; // opaque white texture at index 0
         } else {
-            m_materials[material_i].emissiveTextureOffset += modelData.textureOffset;
+            material.emissiveTextureOffset = modelData.textureSlots[material.emissiveTextureOffset];
         }
 
-        if (m_materials[material_i].occlusionTextureOffset == NO_TEXTURE_INDEX) {
-            m_materials[material_i].occlusionTextureOffset = 0; // opaque white texture at index 0
+        if (material.occlusionTextureOffset == NO_TEXTURE_INDEX) {
+            material.occlusionTextureOffset = 0; // opaque white texture at index 0
         } else {
-            m_materials[material_i].occlusionTextureOffset += modelData.textureOffset;
+            material.occlusionTextureOffset = modelData.textureSlots[material.occlusionTextureOffset];
         }
     }
 
-    DescriptorWriter writer;
-    for (size_t texture_i = modelData.textureOffset; texture_i < m_textures.size(); texture_i++) {
-        writer.writeImage(TEXTURE_BINDING, m_textures[texture_i]->imageview, m_textures[texture_i]->sampler,
-                          VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,
-                          texture_i);
-    }
+    modelData.materialCount = materials.size();
+    modelData.materialOffset = m_materialArena.allocate(modelData.materialCount);
+    m_materialArena.upload(modelData.materialOffset, materials.data(), materials.size());
+
     for (size_t frame_i = 0; frame_i < MAX_CONCURRENT_FRAMES; frame_i++) {
         writer.updateSet(m_vulkanContext.device, bindlessDescriptorSets[frame_i]);
     }
 
-    m_sceneDatas.emplace_back(std::move(scene), modelId);
+    ImageCache::Stats imageStats = m_imageCache.stats();
+    std::cout << "Model " << modelId << ": " << sharedSlotCount << " of " << scene->textures.size()
+              << " textures share a bindless slot. image cache: " << imageStats.hits << " of " << imageStats.lookups
+              << " lookups hit (" << (imageStats.lookups ? 100.f * imageStats.hits / imageStats.lookups : 0.f)
+              << "%), " << imageStats.bytesSaved / (1024 * 1024) << " MB not uploaded" << std::endl;
 
-    m_modelDatas.emplace_back(modelData);
-
-    destroyStaticBuffers();
-    createStaticBuffers();
+    m_sceneDatas.emplace_back(std::move(scene), modelId);
 
-    return modelId;
+    m_modelDatas[modelId] = modelData;
 }
 
-void Renderer::createStaticBuffers() {
-    const size_t vertexBufferSize = m_vertices.size() * sizeof(Vertex);
-    const size_t indexBufferSize = m_indices.size() * sizeof(uint32_t);
-    const size_t materialBufferSize = m_materials.size() * sizeof(Material);
-
-    const size_t stagingBufferSize = vertexBufferSize + indexBufferSize + materialBufferSize;
+// elements per arena chunk, every arena starts with one chunk and grows by whole chunks
+static constexpr uint32_t VERTEX_ARENA_CHUNK = 1 << 20;
+static constexpr uint32_t INDEX_ARENA_CHUNK = 1 << 22;
+static constexpr uint32_t MATERIAL_ARENA_CHUNK = 1024;
+static constexpr uint32_t SKIN_ARENA_CHUNK = 1 << 18;
+static constexpr uint32_t MESHLET_ARENA_CHUNK = 1 << 16;
+static constexpr uint32_t MESHLET_VERTEX_ARENA_CHUNK = 1 << 20;
+static constexpr uint32_t MESHLET_TRIANGLE_ARENA_CHUNK = 1 << 20;
+static constexpr uint32_t MORPH_DELTA_ARENA_CHUNK = 1 << 16;
+static constexpr uint32_t MORPH_RANGE_ARENA_CHUNK = 1 << 16;
+
+std::array<ArenaBuffer *, 9> Renderer::geometryArenas() {
+    return {&m_vertexArena, &m_indexArena, &m_materialArena, &m_skinArena, &m_meshletArena, &m_meshletVertexArena,
+            &m_meshletTriangleArena, &m_morphDeltaArena, &m_morphRangeArena};
+}
 
-    VulkanBuffer stagingBuffer = m_vulkanContext.createBuffer(stagingBufferSize,
-                                                              VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
-                                                              VMA_ALLOCATION_CREATE_MAPPED_BIT |
-                                                              VMA_ALLOCATION_CREATE_HOST_ACCESS_SEQUENTIAL_WRITE_BIT);
-    void *data = stagingBuffer.info.pMappedData;
+void Renderer::initGeometryArenas() {
+    const VkBufferUsageFlags storageUsage = VK_BUFFER_USAGE_STORAGE_BUFFER_BIT |
+                                            VK_BUFFER_USAGE_SHADER_DEVICE_ADDRESS_BIT;
+
+    m_vertexArena.init(&m_vulkanContext, sizeof(GpuVertex), VERTEX_ARENA_CHUNK, storageUsage);
+    // rebase patches indices in place through a buffer device address
+    m_indexArena.init(&m_vulkanContext, sizeof(uint32_t), INDEX_ARENA_CHUNK,
+                      VK_BUFFER_USAGE_INDEX_BUFFER_BIT | storageUsage);
+    m_materialArena.init(&m_vulkanContext, sizeof(Material), MATERIAL_ARENA_CHUNK, storageUsage);
+    m_skinArena.init(&m_vulkanContext, sizeof(SkinVertex), SKIN_ARENA_CHUNK, storageUsage);
+    m_meshletArena.init(&m_vulkanContext, sizeof(Meshlet), MESHLET_ARENA_CHUNK, storageUsage);
+    m_meshletVertexArena.init(&m_vulkanContext, sizeof(uint32_t), MESHLET_VERTEX_ARENA_CHUNK, storageUsage);
+    m_meshletTriangleArena.init(&m_vulkanContext, sizeof(uint32_t), MESHLET_TRIANGLE_ARENA_CHUNK, storageUsage);
+    m_morphDeltaArena.init(&m_vulkanContext, sizeof(MorphDelta), MORPH_DELTA_ARENA_CHUNK, storageUsage);
+    m_morphRangeArena.init(&m_vulkanContext, sizeof(uint32_t), MORPH_RANGE_ARENA_CHUNK, storageUsage);
+}
 
-    m_boundedVertexBuffer = m_vulkanContext.createBuffer(vertexBufferSize,
-                                                         VK_BUFFER_USAGE_STORAGE_BUFFER_BIT |
-                                                         VK_BUFFER_USAGE_TRANSFER_DST_BIT |
-                                                         VK_BUFFER_USAGE_SHADER_DEVICE_ADDRESS_BIT,
-                                                         VMA_ALLOCATION_CREATE_DEDICATED_MEMORY_BIT);
-    memcpy(data, m_vertices.data(), vertexBufferSize);
+void Renderer::flushGeometryUploads() {
+    // the frames recorded after this are submitted after the batch, whose final barrier makes the copies visible
+    m_geometryUploadValue = m_vulkanContext.uploadManager.flush();
 
-    if (indexBufferSize != 0) {
-        m_boundedIndexBuffer = m_vulkanContext.createBuffer(indexBufferSize,
-                                                            VK_BUFFER_USAGE_INDEX_BUFFER_BIT |
-                                                            VK_BUFFER_USAGE_TRANSFER_DST_BIT,
-                                                            VMA_ALLOCATION_CREATE_DEDICATED_MEMORY_BIT);
-        memcpy(static_cast<uint8_t *>(data) + vertexBufferSize, m_indices.data(), indexBufferSize);
-    }
+    retireArenaBuffers();
+}
 
-    m_boundedMaterialBuffer = m_vulkanContext.createBuffer(materialBufferSize,
-                                                           VK_BUFFER_USAGE_STORAGE_BUFFER_BIT |
-                                                           VK_BUFFER_USAGE_TRANSFER_DST_BIT |
-                                                           VK_BUFFER_USAGE_SHADER_DEVICE_ADDRESS_BIT,
-                                                           VMA_ALLOCATION_CREATE_DEDICATED_MEMORY_BIT);
-    memcpy(static_cast<uint8_t *>(data) + vertexBufferSize + indexBufferSize, m_materials.data(),
-           materialBufferSize);
-
-    m_vulkanContext.immediateSubmit([&](VkCommandBuffer cmd) {
-        VkBufferCopy vertexCopy = {0};
-        vertexCopy.dstOffset = 0;
-        vertexCopy.srcOffset = 0;
-        vertexCopy.size = vertexBufferSize;
-        vkCmdCopyBuffer(cmd, stagingBuffer.buffer, m_boundedVertexBuffer.buffer,
-                        1, &vertexCopy);
-
-        if (indexBufferSize != 0) {
-            VkBufferCopy indexCopy = {0};
-            indexCopy.dstOffset = 0;
-            indexCopy.srcOffset = vertexBufferSize;
-            indexCopy.size = indexBufferSize;
-            vkCmdCopyBuffer(cmd, stagingBuffer.buffer, m_boundedIndexBuffer.buffer,
-                            1, &indexCopy);
+void Renderer::retireArenaBuffers() {
+    for (ArenaBuffer *arena: geometryArenas()) {
+        for (const auto &buffer: arena->takeRetiredBuffers()) {
+            retireBuffer(buffer);
         }
-
-        VkBufferCopy materialCopy = {0};
-        materialCopy.dstOffset = 0;
-        materialCopy.srcOffset = vertexBufferSize + indexBufferSize;
-        materialCopy.size = materialBufferSize;
-        vkCmdCopyBuffer(cmd, stagingBuffer.buffer, m_boundedMaterialBuffer.buffer,
-                        1, &materialCopy);
-    });
-
-    m_vulkanContext.destroyBuffer(stagingBuffer);
+    }
 }
 
 void Renderer::setupVulkan() {
@@ -311,8 +465,15 @@ void Renderer::setupVulkan() {
     bindFlags.pBindingFlags = flagArray.data();
     descriptorLayoutBuilder.bindings[TEXTURE_BINDING].descriptorCount = MAX_TEXTURES;
 
+    // the meshlet cull pass and the task/mesh stages read the uniform and transforms
+    VkShaderStageFlags globalStages = VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT |
+                                      VK_SHADER_STAGE_COMPUTE_BIT;
+    if (m_vulkanContext.meshShadersEnabled) {
+        globalStages |= VK_SHADER_STAGE_TASK_BIT_EXT | VK_SHADER_STAGE_MESH_BIT_EXT;
+    }
+
     globalDescriptorLayout = descriptorLayoutBuilder.build(m_vulkanContext.device,
-                                                           VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT,
+                                                           globalStages,
                                                            &bindFlags,
                                                            VK_DESCRIPTOR_SET_LAYOUT_CREATE_UPDATE_AFTER_BIND_POOL_BIT);
 
@@ -360,9 +521,19 @@ void Renderer::setupVulkan() {
 
     trianglePipeline = trianglePipelineBuilder.build(m_vulkanContext.device);
 
+    VkSpecializationInfo skinnedSpecialization = skinnedSpecializationInfo();
+    trianglePipelineBuilder.setSpecialization(VK_SHADER_STAGE_VERTEX_BIT, &skinnedSpecialization);
+    skinnedTrianglePipeline = trianglePipelineBuilder.build(m_vulkanContext.device);
+
     vkDestroyShaderModule(m_vulkanContext.device, triangleVertShader, nullptr);
     vkDestroyShaderModule(m_vulkanContext.device, triangleFragShader, nullptr);
 
+    initMeshletPipelines();
+
+    initMorphBlendPipeline();
+
+    initArenaRebasePipeline();
+
     m_uniformBuffer = m_vulkanContext.createBuffer(sizeof(GlobalUniformData),
                                                    VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT |
                                                    VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
@@ -381,6 +552,8 @@ void Renderer::setupVulkan() {
     m_skybox->load("assets/skyboxes/equirectangular/free_hdri_sky_816.jpg");
     m_skybox->init();
 
+    initGeometryArenas();
+
     initDefaultData();
 
     initSkyboxPipeline();
@@ -389,6 +562,14 @@ void Renderer::setupVulkan() {
 void Renderer::terminateVulkan() {
     vkDeviceWaitIdle(m_vulkanContext.device);
 
+    // imports still running use the context and the pool
+    for (auto &pendingLoad: m_pendingLoads) {
+        if (pendingLoad.future.valid()) {
+            pendingLoad.future.wait();
+        }
+    }
+    m_pendingLoads.clear();
+
     // todo: move memory allocation stuff in scene to renderer
     m_sceneDatas.clear();
 
@@ -397,24 +578,31 @@ void Renderer::terminateVulkan() {
     m_vulkanContext.destroyImage(opaqueWhiteTextureImage);
     m_vulkanContext.destroyImage(opaqueCyanTextureImage);
     m_vulkanContext.destroyImage(defaultNormalTextureImage);
-    vkDestroySampler(m_vulkanContext.device, defaultSampler, nullptr);
+    m_vulkanContext.releaseSampler(defaultSampler);
 
     globalDescriptors.destroyPools(m_vulkanContext.device);
     skyboxDescriptors.destroyPools(m_vulkanContext.device);
 
-    destroyStaticBuffers();
+    for (ArenaBuffer *arena: geometryArenas()) {
+        arena->terminate();
+    }
+    collectRetiredResources(true);
     if (m_lightBuffer.buffer != VK_NULL_HANDLE) {
         m_vulkanContext.destroyBuffer(m_lightBuffer);
     }
-    if (m_modelTransformBuffer.buffer != VK_NULL_HANDLE) {
-        m_vulkanContext.destroyBuffer(m_modelTransformBuffer);
-    }
 
     m_vulkanContext.destroyBuffer(m_uniformBuffer);
-    m_vulkanContext.destroyBuffer(m_transformBuffer);
-    m_vulkanContext.destroyBuffer(m_jointBuffer);
 
     for (size_t frame_i = 0; frame_i < MAX_CONCURRENT_FRAMES; frame_i++) {
+        if (m_transformBuffers[frame_i].buffer != VK_NULL_HANDLE) {
+            m_vulkanContext.destroyBuffer(m_transformBuffers[frame_i]);
+        }
+        if (m_jointBuffers[frame_i].buffer != VK_NULL_HANDLE) {
+            m_vulkanContext.destroyBuffer(m_jointBuffers[frame_i]);
+        }
+        if (m_modelTransformBuffers[frame_i].buffer != VK_NULL_HANDLE) {
+            m_vulkanContext.destroyBuffer(m_modelTransformBuffers[frame_i]);
+        }
         if (m_boundedUniformBuffers[frame_i].buffer != VK_NULL_HANDLE) {
             m_vulkanContext.destroyBuffer(m_boundedUniformBuffers[frame_i]);
         }
@@ -430,11 +618,33 @@ void Renderer::terminateVulkan() {
         if (m_boundedModelTransformBuffer[frame_i].buffer != VK_NULL_HANDLE) {
             m_vulkanContext.destroyBuffer(m_boundedModelTransformBuffer[frame_i]);
         }
+        if (m_meshletDrawCommandBuffers[frame_i].buffer != VK_NULL_HANDLE) {
+            m_vulkanContext.destroyBuffer(m_meshletDrawCommandBuffers[frame_i]);
+        }
+        if (m_meshletDrawCountBuffers[frame_i].buffer != VK_NULL_HANDLE) {
+            m_vulkanContext.destroyBuffer(m_meshletDrawCountBuffers[frame_i]);
+        }
+        if (m_morphedVertexBuffers[frame_i].buffer != VK_NULL_HANDLE) {
+            m_vulkanContext.destroyBuffer(m_morphedVertexBuffers[frame_i]);
+        }
+        if (m_morphWeightBuffers[frame_i].buffer != VK_NULL_HANDLE) {
+            m_vulkanContext.destroyBuffer(m_morphWeightBuffers[frame_i]);
+        }
     }
 
     vkDestroyDescriptorSetLayout(m_vulkanContext.device, globalDescriptorLayout, nullptr);
     vkDestroyPipelineLayout(m_vulkanContext.device, trianglePipelineLayout, nullptr);
     vkDestroyPipeline(m_vulkanContext.device, trianglePipeline, nullptr);
+    vkDestroyPipeline(m_vulkanContext.device, skinnedTrianglePipeline, nullptr);
+    vkDestroyPipelineLayout(m_vulkanContext.device, meshletPipelineLayout, nullptr);
+    vkDestroyPipeline(m_vulkanContext.device, meshletPipeline, nullptr);
+    vkDestroyPipeline(m_vulkanContext.device, skinnedMeshletPipeline, nullptr);
+    vkDestroyPipelineLayout(m_vulkanContext.device, meshletCullPipelineLayout, nullptr);
+    vkDestroyPipeline(m_vulkanContext.device, meshletCullPipeline, nullptr);
+    vkDestroyPipelineLayout(m_vulkanContext.device, morphBlendPipelineLayout, nullptr);
+    vkDestroyPipeline(m_vulkanContext.device, morphBlendPipeline, nullptr);
+    vkDestroyPipelineLayout(m_vulkanContext.device, arenaRebasePipelineLayout, nullptr);
+    vkDestroyPipeline(m_vulkanContext.device, arenaRebasePipeline, nullptr);
 
     vkDestroyDescriptorSetLayout(m_vulkanContext.device, skyboxDescriptorLayout, nullptr);
     vkDestroyPipelineLayout(m_vulkanContext.device, skyboxPipelineLayout, nullptr);
@@ -444,16 +654,16 @@ void Renderer::terminateVulkan() {
 }
 
 void Renderer::drawGeometry(VkCommandBuffer cmd) {
-    if (m_vertices.empty()) {
+    if (m_vertexArena.empty()) {
         return;
     }
 
+    compactGeometry(cmd);
+
     updateLightPos(0);
     rotateRenderObjects();
     updateLightBuffer(cmd);
 
-    createDrawDatas(cmd);
-
     VkRenderingAttachmentInfo colorAttachment = VkInit::attachmentInfo(m_vulkanContext.drawImage.imageView, nullptr);
     VkRenderingAttachmentInfo depthAttachment = VkInit::depthAttachmentInfo(m_vulkanContext.depthImage.imageView);
 
@@ -475,6 +685,8 @@ void Renderer::drawGeometry(VkCommandBuffer cmd) {
     m_globalUniformData.cameraPos = m_camera.position;
     m_globalUniformData.numLights = m_lights.size();
 
+    createDrawDatas(cmd);
+
     GlobalUniformData *globalUniformData = static_cast<GlobalUniformData *>(m_uniformBuffer.info.pMappedData);
     *globalUniformData = m_globalUniformData;
 
@@ -488,7 +700,7 @@ void Renderer::drawGeometry(VkCommandBuffer cmd) {
     DescriptorWriter writer;
     writer.writeBuffer(UNIFORM_BINDING, m_boundedUniformBuffers[currentFrame].buffer, sizeof(GlobalUniformData), 0,
                        VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER);
-    writer.writeBuffer(MATERIAL_BINDING, m_boundedMaterialBuffer.buffer, m_boundedMaterialBuffer.info.size, 0,
+    writer.writeBuffer(MATERIAL_BINDING, m_materialArena.buffer().buffer, m_materialArena.buffer().info.size, 0,
                        VK_DESCRIPTOR_TYPE_STORAGE_BUFFER);
     writer.writeBuffer(TRANSFORM_BINDING, m_boundedTransformBuffers[currentFrame].buffer,
                        m_boundedTransformBuffers[currentFrame].info.size, 0, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER);
@@ -513,6 +725,12 @@ void Renderer::drawGeometry(VkCommandBuffer cmd) {
                       VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, 0);
     writer.updateSet(m_vulkanContext.device, bindlessDescriptorSets[currentFrame]);
 
+    blendMorphTargets(cmd);
+
+    if (!m_vulkanContext.meshShadersEnabled) {
+        cullMeshlets(cmd);
+    }
+
     VkRenderingInfo renderInfo = VkInit::renderingInfo(m_vulkanContext.windowExtent, &colorAttachment,
                                                        &depthAttachment);
     vkCmdBeginRendering(cmd, &renderInfo);
@@ -523,34 +741,106 @@ void Renderer::drawGeometry(VkCommandBuffer cmd) {
 
     vkCmdBindDescriptorSets(cmd, VK_PIPELINE_BIND_POINT_GRAPHICS, trianglePipelineLayout,
                             0, 1, &bindlessDescriptorSets[currentFrame], 0, nullptr);
-    if (!m_indices.empty()) {
-        vkCmdBindIndexBuffer(cmd, m_boundedIndexBuffer.buffer, 0, VK_INDEX_TYPE_UINT32);
+    if (!m_indexArena.empty()) {
+        vkCmdBindIndexBuffer(cmd, m_indexArena.buffer().buffer, 0, VK_INDEX_TYPE_UINT32);
     }
 
+    VkDeviceAddress vertexBuffer = m_vulkanContext.getBufferAddress(m_vertexArena.buffer());
+    VkDeviceAddress morphedVertexBuffer = m_morphInstances.empty()
+                                          ? vertexBuffer
+                                          : m_vulkanContext.getBufferAddress(m_morphedVertexBuffers[currentFrame]);
+
     PushConstantsBindless pcb = {};
-    pcb.vertexBuffer = m_vulkanContext.getBufferAddress(m_boundedVertexBuffer);
+    pcb.skinBuffer = m_vulkanContext.getBufferAddress(m_skinArena.buffer());
 
+    // both variants share trianglePipelineLayout, switching keeps the set and push constants bound
+    VkPipeline boundPipeline = trianglePipeline;
     for (const auto &drawData: m_drawDatas) {
-        if (drawData.instanceCount == 0) {
+        if (drawData.instanceCount == 0 || (drawData.meshletCount != 0 && m_vulkanContext.meshShadersEnabled)) {
             continue;
         }
 
+        VkPipeline pipeline = drawData.skinned ? skinnedTrianglePipeline : trianglePipeline;
+        if (pipeline != boundPipeline) {
+            vkCmdBindPipeline(cmd, VK_PIPELINE_BIND_POINT_GRAPHICS, pipeline);
+            boundPipeline = pipeline;
+        }
+
         pcb.transformOffset = drawData.transformOffset;
         pcb.materialOffset = drawData.materialOffset;
         pcb.jointOffset = drawData.jointOffset;
         pcb.modelTransformOffset = drawData.modelTransformOffset;
+        pcb.positionQuantization = drawData.positionQuantization;
+        pcb.skinVertexOffset = drawData.skinVertexOffset;
+        pcb.vertexBuffer = drawData.morphed ? morphedVertexBuffer : vertexBuffer;
+        pcb.morphVertexOffset = drawData.morphVertexOffset;
 
         vkCmdPushConstants(cmd, trianglePipelineLayout, VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT,
                            0,
                            sizeof(PushConstantsBindless),
                            &pcb);
-        if (drawData.hasIndices) {
+        if (drawData.meshletCount != 0) {
+            // one command per visible meshlet instance, written by cullMeshlets
+            vkCmdDrawIndexedIndirectCount(cmd, m_meshletDrawCommandBuffers[currentFrame].buffer,
+                                          drawData.drawCommandOffset * sizeof(VkDrawIndexedIndirectCommand),
+                                          m_meshletDrawCountBuffers[currentFrame].buffer,
+                                          drawData.drawCountIndex * sizeof(uint32_t),
+                                          drawData.meshletCount * drawData.instanceCount,
+                                          sizeof(VkDrawIndexedIndirectCommand));
+        } else if (drawData.hasIndices) {
             vkCmdDrawIndexed(cmd, drawData.indexCount, drawData.instanceCount, drawData.indexOffset, 0, 0);
         } else {
             vkCmdDraw(cmd, drawData.vertexCount, drawData.instanceCount, drawData.vertexOffset, 0);
         }
     }
 
+    if (m_vulkanContext.meshShadersEnabled && !m_meshletArena.empty()) {
+        vkCmdBindPipeline(cmd, VK_PIPELINE_BIND_POINT_GRAPHICS, meshletPipeline);
+        // push constant ranges differ from trianglePipelineLayout, so the set has to be bound again
+        vkCmdBindDescriptorSets(cmd, VK_PIPELINE_BIND_POINT_GRAPHICS, meshletPipelineLayout,
+                                0, 1, &bindlessDescriptorSets[currentFrame], 0, nullptr);
+
+        PushConstantsMeshlet pcm = {};
+        pcm.meshletBuffer = m_vulkanContext.getBufferAddress(m_meshletArena.buffer());
+        pcm.meshletVertexBuffer = m_vulkanContext.getBufferAddress(m_meshletVertexArena.buffer());
+        pcm.meshletTriangleBuffer = m_vulkanContext.getBufferAddress(m_meshletTriangleArena.buffer());
+        pcm.skinBuffer = pcb.skinBuffer;
+
+        VkPipeline boundMeshletPipeline = meshletPipeline;
+        for (const auto &drawData: m_drawDatas) {
+            if (drawData.instanceCount == 0 || drawData.meshletCount == 0) {
+                continue;
+            }
+
+            VkPipeline pipeline = drawData.skinned ? skinnedMeshletPipeline : meshletPipeline;
+            if (pipeline != boundMeshletPipeline) {
+                vkCmdBindPipeline(cmd, VK_PIPELINE_BIND_POINT_GRAPHICS, pipeline);
+                boundMeshletPipeline = pipeline;
+            }
+
+            pcm.transformOffset = drawData.transformOffset;
+            pcm.materialOffset = drawData.materialOffset;
+            pcm.jointOffset = drawData.jointOffset;
+            pcm.modelTransformOffset = drawData.modelTransformOffset;
+            pcm.meshletOffset = drawData.meshletOffset;
+            pcm.meshletCount = drawData.meshletCount;
+            pcm.cullMeshlets = drawData.cullMeshlets;
+            pcm.positionQuantization = drawData.positionQuantization;
+            pcm.skinVertexOffset = drawData.skinVertexOffset;
+            pcm.vertexBuffer = drawData.morphed ? morphedVertexBuffer : vertexBuffer;
+            pcm.morphVertexOffset = drawData.morphVertexOffset;
+
+            vkCmdPushConstants(cmd, meshletPipelineLayout,
+                               VK_SHADER_STAGE_TASK_BIT_EXT | VK_SHADER_STAGE_MESH_BIT_EXT |
+                               VK_SHADER_STAGE_FRAGMENT_BIT,
+                               0,
+                               sizeof(PushConstantsMeshlet),
+                               &pcm);
+            // a task workgroup culls 32 meshlets of one instance
+            vkCmdDrawMeshTasksEXT(cmd, (drawData.meshletCount + 31) / 32, drawData.instanceCount, 1);
+        }
+    }
+
     // skybox
     DescriptorWriter skyboxWriter;
     skyboxWriter.writeImage(0, m_skybox->prefilteredCube.imageView, m_skybox->sampler,
@@ -574,7 +864,6 @@ void Renderer::drawGeometry(VkCommandBuffer cmd) {
 
 void Renderer::initDefaultData() {
     m_textures.clear();
-    m_materials.clear();
     m_joints = {glm::mat4(1.f)};
 
     opaqueWhiteTextureImage = m_vulkanContext.createImage(&VkUtil::opaqueWhite, VkExtent3D(1, 1, 1),
@@ -586,6 +875,7 @@ void Renderer::initDefaultData() {
     opaqueCyanTextureImage = m_vulkanContext.createImage(&VkUtil::opaqueCyan, VkExtent3D(1, 1, 1),
                                                          VK_FORMAT_R8G8B8A8_UNORM,
                                                          VK_IMAGE_USAGE_SAMPLED_BIT, false);
+    m_vulkanContext.uploadManager.flush();
 
     VkSamplerCreateInfo samplerInfo = {};
     samplerInfo.sType = VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO;
@@ -594,7 +884,7 @@ void Renderer::initDefaultData() {
     samplerInfo.mipmapMode = VK_SAMPLER_MIPMAP_MODE_LINEAR;
     samplerInfo.maxLod = 16.f;
 
-    vkCreateSampler(m_vulkanContext.device, &samplerInfo, nullptr, &defaultSampler);
+    defaultSampler = m_vulkanContext.acquireSampler(samplerInfo);
 
     Texture opaqueWhiteTexture = {
             "opaque_white_texture",
@@ -617,6 +907,8 @@ void Renderer::initDefaultData() {
     m_textures.emplace_back(std::make_shared<Texture>(opaqueWhiteTexture));
     m_textures.emplace_back(std::make_shared<Texture>(opaqueCyanTexture));
     m_textures.emplace_back(std::make_shared<Texture>(defaultNormalTexture));
+    m_textureSlots.allocate(m_textures.size());
+    m_textureRefCounts.assign(m_textures.size(), 1); // never released
 
     Material defaultMaterial = {
             .baseColorFactor = {1.f, 1.f, 1.f, 1.f},
@@ -627,7 +919,9 @@ void Renderer::initDefaultData() {
             .normalTextureOffset = 2, // the default normal texture is at index 2
     };
 
-    m_materials.emplace_back(defaultMaterial);
+    uint32_t defaultMaterialOffset = m_materialArena.allocate(1); // 0, generated meshes use it
+    m_materialArena.upload(defaultMaterialOffset, &defaultMaterial, 1);
+    flushGeometryUploads();
 
     DescriptorWriter writer;
     for (size_t texture_i = 0; texture_i < m_textures.size(); texture_i++) {
@@ -640,16 +934,459 @@ void Renderer::initDefaultData() {
     }
 }
 
-void Renderer::destroyStaticBuffers() {
-    if (m_boundedIndexBuffer.buffer != VK_NULL_HANDLE) {
-        m_vulkanContext.destroyBuffer(m_boundedIndexBuffer);
+void Renderer::retireBuffer(const VulkanBuffer &buffer) {
+    m_retiredBuffers.push_back({buffer, m_frameNumber, m_geometryUploadValue});
+}
+
+void Renderer::collectRetiredResources(bool deviceIdle) {
+    for (auto it = m_retiredBuffers.begin(); it != m_retiredBuffers.end();) {
+        // every frame recorded before the buffer was retired has passed its fence once MAX_CONCURRENT_FRAMES
+        // more have started
+        if (deviceIdle) {
+            m_vulkanContext.uploadManager.wait(it->uploadValue);
+        } else if (m_frameNumber < it->frameNumber + MAX_CONCURRENT_FRAMES ||
+                   !m_vulkanContext.uploadManager.isComplete(it->uploadValue)) {
+            it++;
+            continue;
+        }
+
+        m_vulkanContext.destroyBuffer(it->buffer);
+        it = m_retiredBuffers.erase(it);
     }
-    if (m_boundedVertexBuffer.buffer != VK_NULL_HANDLE) {
-        m_vulkanContext.destroyBuffer(m_boundedVertexBuffer);
+
+    for (auto it = m_retiredModels.begin(); it != m_retiredModels.end();) {
+        if (!deviceIdle && m_frameNumber < it->frameNumber + MAX_CONCURRENT_FRAMES) {
+            it++;
+            continue;
+        }
+
+        releaseModel(it->modelData);
+        it = m_retiredModels.erase(it); // destroys the scene's images and samplers
     }
-    if (m_boundedMaterialBuffer.buffer != VK_NULL_HANDLE) {
-        m_vulkanContext.destroyBuffer(m_boundedMaterialBuffer);
+}
+
+void Renderer::initMeshletPipelines() {
+    if (m_vulkanContext.meshShadersEnabled) {
+        VkPushConstantRange pushConstantsRange = {};
+        pushConstantsRange.offset = 0;
+        pushConstantsRange.size = sizeof(PushConstantsMeshlet);
+        pushConstantsRange.stageFlags = VK_SHADER_STAGE_TASK_BIT_EXT | VK_SHADER_STAGE_MESH_BIT_EXT |
+                                        VK_SHADER_STAGE_FRAGMENT_BIT;
+
+        VkPipelineLayoutCreateInfo pipelineLayoutInfo = VkInit::pipelineLayoutCreateInfo();
+        pipelineLayoutInfo.setLayoutCount = 1;
+        pipelineLayoutInfo.pSetLayouts = &globalDescriptorLayout;
+        pipelineLayoutInfo.pPushConstantRanges = &pushConstantsRange;
+        pipelineLayoutInfo.pushConstantRangeCount = 1;
+
+        VK_CHECK(vkCreatePipelineLayout(m_vulkanContext.device, &pipelineLayoutInfo, nullptr, &meshletPipelineLayout))
+
+        VkShaderModule meshletTaskShader, meshletMeshShader, meshletFragShader;
+        VK_CHECK(m_vulkanContext.createShaderModule("shaders/pbr/meshlet.task.spv", &meshletTaskShader))
+        VK_CHECK(m_vulkanContext.createShaderModule("shaders/pbr/meshlet.mesh.spv", &meshletMeshShader))
+        VK_CHECK(m_vulkanContext.createShaderModule("shaders/pbr/texture_bindless.frag.spv", &meshletFragShader))
+
+        PipelineBuilder meshletPipelineBuilder;
+        meshletPipelineBuilder
+                .setLayout(meshletPipelineLayout)
+                .setMeshShaders(meshletTaskShader, meshletMeshShader, meshletFragShader)
+                .setPolygonMode(VK_POLYGON_MODE_FILL)
+                .setCullMode(VK_CULL_MODE_NONE, VK_FRONT_FACE_COUNTER_CLOCKWISE)
+                .setMultisamplingNone()
+                .disableBlending()
+                .enableDepthTest(VK_TRUE, VK_COMPARE_OP_LESS_OR_EQUAL)
+                .setColorAttachmentFormat(m_vulkanContext.drawImage.imageFormat)
+                .setDepthAttachmentFormat(m_vulkanContext.depthImage.imageFormat);
+
+        meshletPipeline = meshletPipelineBuilder.build(m_vulkanContext.device);
+
+        VkSpecializationInfo skinnedSpecialization = skinnedSpecializationInfo();
+        meshletPipelineBuilder.setSpecialization(VK_SHADER_STAGE_MESH_BIT_EXT, &skinnedSpecialization);
+        skinnedMeshletPipeline = meshletPipelineBuilder.build(m_vulkanContext.device);
+
+        vkDestroyShaderModule(m_vulkanContext.device, meshletTaskShader, nullptr);
+        vkDestroyShaderModule(m_vulkanContext.device, meshletMeshShader, nullptr);
+        vkDestroyShaderModule(m_vulkanContext.device, meshletFragShader, nullptr);
+        return;
     }
+
+    VkPushConstantRange pushConstantsRange = {};
+    pushConstantsRange.offset = 0;
+    pushConstantsRange.size = sizeof(PushConstantsMeshletCull);
+    pushConstantsRange.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+
+    VkPipelineLayoutCreateInfo pipelineLayoutInfo = VkInit::pipelineLayoutCreateInfo();
+    pipelineLayoutInfo.setLayoutCount = 1;
+    pipelineLayoutInfo.pSetLayouts = &globalDescriptorLayout;
+    pipelineLayoutInfo.pPushConstantRanges = &pushConstantsRange;
+    pipelineLayoutInfo.pushConstantRangeCount = 1;
+
+    VK_CHECK(vkCreatePipelineLayout(m_vulkanContext.device, &pipelineLayoutInfo, nullptr, &meshletCullPipelineLayout))
+
+    VkShaderModule meshletCullShader;
+    VK_CHECK(m_vulkanContext.createShaderModule("shaders/pbr/meshlet_cull.comp.spv", &meshletCullShader))
+
+    VkComputePipelineCreateInfo pipelineInfo = {};
+    pipelineInfo.sType = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO;
+    pipelineInfo.stage = VkInit::pipelineShaderStageCreateInfo(VK_SHADER_STAGE_COMPUTE_BIT, meshletCullShader);
+    pipelineInfo.layout = meshletCullPipelineLayout;
+
+    VK_CHECK(vkCreateComputePipelines(m_vulkanContext.device, VK_NULL_HANDLE, 1, &pipelineInfo, nullptr,
+                                      &meshletCullPipeline))
+
+    vkDestroyShaderModule(m_vulkanContext.device, meshletCullShader, nullptr);
+}
+
+void Renderer::initArenaRebasePipeline() {
+    VkPushConstantRange pushConstantsRange = {};
+    pushConstantsRange.offset = 0;
+    pushConstantsRange.size = sizeof(PushConstantsRebase);
+    pushConstantsRange.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+
+    VkPipelineLayoutCreateInfo pipelineLayoutInfo = VkInit::pipelineLayoutCreateInfo();
+    pipelineLayoutInfo.pPushConstantRanges = &pushConstantsRange;
+    pipelineLayoutInfo.pushConstantRangeCount = 1;
+
+    VK_CHECK(vkCreatePipelineLayout(m_vulkanContext.device, &pipelineLayoutInfo, nullptr, &arenaRebasePipelineLayout))
+
+    VkShaderModule arenaRebaseShader;
+    VK_CHECK(m_vulkanContext.createShaderModule("shaders/geometry/arena_rebase.comp.spv", &arenaRebaseShader))
+
+    VkComputePipelineCreateInfo pipelineInfo = {};
+    pipelineInfo.sType = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO;
+    pipelineInfo.stage = VkInit::pipelineShaderStageCreateInfo(VK_SHADER_STAGE_COMPUTE_BIT, arenaRebaseShader);
+    pipelineInfo.layout = arenaRebasePipelineLayout;
+
+    VK_CHECK(vkCreateComputePipelines(m_vulkanContext.device, VK_NULL_HANDLE, 1, &pipelineInfo, nullptr,
+                                      &arenaRebasePipeline))
+
+    vkDestroyShaderModule(m_vulkanContext.device, arenaRebaseShader, nullptr);
+}
+
+void Renderer::compactGeometry(VkCommandBuffer cmd) {
+    // materials are left out, they are small and the default material is pinned at offset 0
+    std::array<ArenaBuffer *, 8> arenas = {&m_vertexArena, &m_indexArena, &m_skinArena, &m_meshletArena,
+                                           &m_meshletVertexArena, &m_meshletTriangleArena, &m_morphDeltaArena,
+                                           &m_morphRangeArena};
+
+    // ranges of unloaded models waiting for release are still in the old layout
+    if (!m_geometryCompaction || !m_retiredModels.empty() ||
+        std::none_of(arenas.begin(), arenas.end(), [](ArenaBuffer *arena) { return arena->fragmented(); })) {
+        return;
+    }
+
+    std::vector<uint32_t> modelIds;
+    for (uint32_t model_i = 0; model_i < m_modelDatas.size(); model_i++) {
+        if (m_modelDatas[model_i].state == ModelState::eResident) {
+            modelIds.push_back(model_i);
+        }
+    }
+
+    // new offsets of the resident models' ranges, in modelIds order
+    auto compactArena = [&](ArenaBuffer &arena, uint32_t ModelData::*offset, uint32_t ModelData::*count) {
+        std::vector<std::pair<uint32_t, uint32_t>> ranges;
+        for (uint32_t modelId: modelIds) {
+            ranges.emplace_back(m_modelDatas[modelId].*offset, m_modelDatas[modelId].*count);
+        }
+        return arena.compact(cmd, ranges);
+    };
+
+    auto vertexOffsets = compactArena(m_vertexArena, &ModelData::vertexOffset, &ModelData::vertexCount);
+    auto indexOffsets = compactArena(m_indexArena, &ModelData::indexOffset, &ModelData::indexCount);
+    auto skinVertexOffsets = compactArena(m_skinArena, &ModelData::skinVertexOffset, &ModelData::skinVertexCount);
+    auto meshletOffsets = compactArena(m_meshletArena, &ModelData::meshletOffset, &ModelData::meshletCount);
+    auto meshletVertexOffsets = compactArena(m_meshletVertexArena, &ModelData::meshletVertexOffset,
+                                             &ModelData::meshletVertexCount);
+    auto meshletTriangleOffsets = compactArena(m_meshletTriangleArena, &ModelData::meshletTriangleOffset,
+                                               &ModelData::meshletTriangleCount);
+    auto morphDeltaOffsets = compactArena(m_morphDeltaArena, &ModelData::morphDeltaOffset,
+                                          &ModelData::morphDeltaCount);
+    auto morphRangeOffsets = compactArena(m_morphRangeArena, &ModelData::morphRangeOffset,
+                                          &ModelData::morphRangeCount);
+
+    VkMemoryBarrier2 barrier = {};
+    barrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER_2;
+    barrier.srcStageMask = VK_PIPELINE_STAGE_2_ALL_TRANSFER_BIT;
+    barrier.srcAccessMask = VK_ACCESS_2_TRANSFER_WRITE_BIT;
+    barrier.dstStageMask = VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT;
+    barrier.dstAccessMask = VK_ACCESS_2_SHADER_READ_BIT | VK_ACCESS_2_SHADER_WRITE_BIT;
+
+    VkDependencyInfo dependencyInfo = {};
+    dependencyInfo.sType = VK_STRUCTURE_TYPE_DEPENDENCY_INFO;
+    dependencyInfo.memoryBarrierCount = 1;
+    dependencyInfo.pMemoryBarriers = &barrier;
+
+    vkCmdPipelineBarrier2(cmd, &dependencyInfo);
+
+    vkCmdBindPipeline(cmd, VK_PIPELINE_BIND_POINT_COMPUTE, arenaRebasePipeline);
+
+    constexpr uint32_t meshletStride = sizeof(Meshlet) / sizeof(uint32_t);
+    constexpr uint32_t meshletVertexField = offsetof(Meshlet, vertexOffset) / sizeof(uint32_t);
+    constexpr uint32_t meshletTriangleField = offsetof(Meshlet, triangleOffset) / sizeof(uint32_t);
+    constexpr uint32_t meshletIndexField = offsetof(Meshlet, indexOffset) / sizeof(uint32_t);
+
+    for (size_t model_i = 0; model_i < modelIds.size(); model_i++) {
+        ModelData &modelData = m_modelDatas[modelIds[model_i]];
+
+        int32_t vertexDelta = static_cast<int32_t>(vertexOffsets[model_i] - modelData.vertexOffset);
+        int32_t indexDelta = static_cast<int32_t>(indexOffsets[model_i] - modelData.indexOffset);
+        int32_t meshletVertexDelta = static_cast<int32_t>(meshletVertexOffsets[model_i] -
+                                                          modelData.meshletVertexOffset);
+        int32_t meshletTriangleDelta = static_cast<int32_t>(meshletTriangleOffsets[model_i] -
+                                                            modelData.meshletTriangleOffset);
+
+        // indices and meshlet vertices point into the vertex arena, meshlets into the index and meshlet arenas
+        rebase(cmd, m_indexArena, indexOffsets[model_i], modelData.indexCount, 1, vertexDelta);
+        rebase(cmd, m_meshletVertexArena, meshletVertexOffsets[model_i], modelData.meshletVertexCount, 1,
+               vertexDelta);
+
+        uint32_t firstMeshlet = meshletOffsets[model_i] * meshletStride;
+        rebase(cmd, m_meshletArena, firstMeshlet + meshletVertexField, modelData.meshletCount, meshletStride,
+               meshletVertexDelta);
+        rebase(cmd, m_meshletArena, firstMeshlet + meshletTriangleField, modelData.meshletCount, meshletStride,
+               meshletTriangleDelta);
+        rebase(cmd, m_meshletArena, firstMeshlet + meshletIndexField, modelData.meshletCount, meshletStride,
+               indexDelta);
+
+        modelData.vertexOffset = vertexOffsets[model_i];
+        modelData.indexOffset = indexOffsets[model_i];
+        modelData.skinVertexOffset = skinVertexOffsets[model_i];
+        modelData.meshletOffset = meshletOffsets[model_i];
+        modelData.meshletVertexOffset = meshletVertexOffsets[model_i];
+        modelData.meshletTriangleOffset = meshletTriangleOffsets[model_i];
+        modelData.morphDeltaOffset = morphDeltaOffsets[model_i];
+        modelData.morphRangeOffset = morphRangeOffsets[model_i];
+    }
+
+    barrier.srcStageMask = VK_PIPELINE_STAGE_2_ALL_TRANSFER_BIT | VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT;
+    barrier.srcAccessMask = VK_ACCESS_2_TRANSFER_WRITE_BIT | VK_ACCESS_2_SHADER_WRITE_BIT;
+    barrier.dstStageMask = VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT;
+    barrier.dstAccessMask = VK_ACCESS_2_MEMORY_READ_BIT;
+
+    vkCmdPipelineBarrier2(cmd, &dependencyInfo);
+
+    // the frames in flight still draw from the old buffers
+    retireArenaBuffers();
+}
+
+void Renderer::rebase(VkCommandBuffer cmd, const ArenaBuffer &arena, uint32_t first, uint32_t count, uint32_t stride,
+                      int32_t delta) {
+    if (count == 0 || delta == 0) {
+        return;
+    }
+
+    assert(arena.usage() & VK_BUFFER_USAGE_SHADER_DEVICE_ADDRESS_BIT);
+
+    PushConstantsRebase pcr = {};
+    pcr.buffer = m_vulkanContext.getBufferAddress(arena.buffer());
+    pcr.stride = stride;
+    pcr.delta = static_cast<uint32_t>(delta);
+
+    // split to stay under the minimum maxComputeWorkGroupCount of 65535
+    constexpr uint32_t maxDispatchCount = 65535 * 64;
+    for (uint32_t dispatched = 0; dispatched < count; dispatched += maxDispatchCount) {
+        pcr.first = first + dispatched * stride;
+        pcr.count = std::min(count - dispatched, maxDispatchCount);
+
+        vkCmdPushConstants(cmd, arenaRebasePipelineLayout, VK_SHADER_STAGE_COMPUTE_BIT, 0,
+                           sizeof(PushConstantsRebase), &pcr);
+        vkCmdDispatch(cmd, (pcr.count + 63) / 64, 1, 1);
+    }
+}
+
+void Renderer::cullMeshlets(VkCommandBuffer cmd) {
+    uint32_t drawCommandCount = 0;
+    uint32_t meshletDrawCount = 0;
+    for (auto &drawData: m_drawDatas) {
+        if (drawData.instanceCount == 0 || drawData.meshletCount == 0) {
+            continue;
+        }
+        drawData.drawCommandOffset = drawCommandCount;
+        drawData.drawCountIndex = meshletDrawCount++;
+        drawCommandCount += drawData.meshletCount * drawData.instanceCount;
+    }
+
+    if (meshletDrawCount == 0) {
+        return;
+    }
+
+    // grow only, the frame's previous draws are done once its fence was waited on
+    VulkanBuffer &drawCommandBuffer = m_meshletDrawCommandBuffers[currentFrame];
+    VulkanBuffer &drawCountBuffer = m_meshletDrawCountBuffers[currentFrame];
+    const size_t drawCommandBufferSize = drawCommandCount * sizeof(VkDrawIndexedIndirectCommand);
+    const size_t drawCountBufferSize = meshletDrawCount * sizeof(uint32_t);
+    const VkBufferUsageFlags indirectBufferUsage = VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT |
+                                                   VK_BUFFER_USAGE_STORAGE_BUFFER_BIT |
+                                                   VK_BUFFER_USAGE_TRANSFER_DST_BIT |
+                                                   VK_BUFFER_USAGE_SHADER_DEVICE_ADDRESS_BIT;
+
+    if (drawCommandBuffer.buffer == VK_NULL_HANDLE || drawCommandBuffer.info.size < drawCommandBufferSize) {
+        if (drawCommandBuffer.buffer != VK_NULL_HANDLE) {
+            m_vulkanContext.destroyBuffer(drawCommandBuffer);
+        }
+        drawCommandBuffer = m_vulkanContext.createBuffer(drawCommandBufferSize, indirectBufferUsage,
+                                                         VMA_ALLOCATION_CREATE_DEDICATED_MEMORY_BIT);
+    }
+    if (drawCountBuffer.buffer == VK_NULL_HANDLE || drawCountBuffer.info.size < drawCountBufferSize) {
+        if (drawCountBuffer.buffer != VK_NULL_HANDLE) {
+            m_vulkanContext.destroyBuffer(drawCountBuffer);
+        }
+        drawCountBuffer = m_vulkanContext.createBuffer(drawCountBufferSize, indirectBufferUsage,
+                                                       VMA_ALLOCATION_CREATE_DEDICATED_MEMORY_BIT);
+    }
+
+    vkCmdFillBuffer(cmd, drawCountBuffer.buffer, 0, drawCountBufferSize, 0);
+
+    // the count reset and this frame's uniform and transform copies have to land before the cull reads them
+    VkMemoryBarrier2 barrier = {};
+    barrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER_2;
+    barrier.srcStageMask = VK_PIPELINE_STAGE_2_ALL_TRANSFER_BIT;
+    barrier.srcAccessMask = VK_ACCESS_2_TRANSFER_WRITE_BIT;
+    barrier.dstStageMask = VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT;
+    barrier.dstAccessMask = VK_ACCESS_2_SHADER_READ_BIT | VK_ACCESS_2_SHADER_WRITE_BIT;
+
+    VkDependencyInfo dependencyInfo = {};
+    dependencyInfo.sType = VK_STRUCTURE_TYPE_DEPENDENCY_INFO;
+    dependencyInfo.memoryBarrierCount = 1;
+    dependencyInfo.pMemoryBarriers = &barrier;
+
+    vkCmdPipelineBarrier2(cmd, &dependencyInfo);
+
+    vkCmdBindPipeline(cmd, VK_PIPELINE_BIND_POINT_COMPUTE, meshletCullPipeline);
+    vkCmdBindDescriptorSets(cmd, VK_PIPELINE_BIND_POINT_COMPUTE, meshletCullPipelineLayout,
+                            0, 1, &bindlessDescriptorSets[currentFrame], 0, nullptr);
+
+    PushConstantsMeshletCull pcc = {};
+    pcc.meshletBuffer = m_vulkanContext.getBufferAddress(m_meshletArena.buffer());
+    pcc.drawCommandBuffer = m_vulkanContext.getBufferAddress(drawCommandBuffer);
+    pcc.drawCountBuffer = m_vulkanContext.getBufferAddress(drawCountBuffer);
+
+    for (const auto &drawData: m_drawDatas) {
+        if (drawData.instanceCount == 0 || drawData.meshletCount == 0) {
+            continue;
+        }
+
+        pcc.transformOffset = drawData.transformOffset;
+        pcc.modelTransformOffset = drawData.modelTransformOffset;
+        pcc.meshletOffset = drawData.meshletOffset;
+        pcc.meshletCount = drawData.meshletCount;
+        pcc.instanceCount = drawData.instanceCount;
+        pcc.drawCommandOffset = drawData.drawCommandOffset;
+        pcc.drawCountIndex = drawData.drawCountIndex;
+        pcc.cullMeshlets = drawData.cullMeshlets;
+
+        vkCmdPushConstants(cmd, meshletCullPipelineLayout, VK_SHADER_STAGE_COMPUTE_BIT, 0,
+                           sizeof(PushConstantsMeshletCull), &pcc);
+        vkCmdDispatch(cmd, (drawData.meshletCount * drawData.instanceCount + 63) / 64, 1, 1);
+    }
+
+    barrier.srcStageMask = VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT;
+    barrier.srcAccessMask = VK_ACCESS_2_SHADER_WRITE_BIT;
+    barrier.dstStageMask = VK_PIPELINE_STAGE_2_DRAW_INDIRECT_BIT;
+    barrier.dstAccessMask = VK_ACCESS_2_INDIRECT_COMMAND_READ_BIT;
+
+    vkCmdPipelineBarrier2(cmd, &dependencyInfo);
+}
+
+void Renderer::initMorphBlendPipeline() {
+    VkPushConstantRange pushConstantsRange = {};
+    pushConstantsRange.offset = 0;
+    pushConstantsRange.size = sizeof(PushConstantsMorphBlend);
+    pushConstantsRange.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+
+    VkPipelineLayoutCreateInfo pipelineLayoutInfo = VkInit::pipelineLayoutCreateInfo();
+    pipelineLayoutInfo.pPushConstantRanges = &pushConstantsRange;
+    pipelineLayoutInfo.pushConstantRangeCount = 1;
+
+    VK_CHECK(vkCreatePipelineLayout(m_vulkanContext.device, &pipelineLayoutInfo, nullptr, &morphBlendPipelineLayout))
+
+    VkShaderModule morphBlendShader;
+    VK_CHECK(m_vulkanContext.createShaderModule("shaders/geometry/morph_blend.comp.spv", &morphBlendShader))
+
+    VkComputePipelineCreateInfo pipelineInfo = {};
+    pipelineInfo.sType = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO;
+    pipelineInfo.stage = VkInit::pipelineShaderStageCreateInfo(VK_SHADER_STAGE_COMPUTE_BIT, morphBlendShader);
+    pipelineInfo.layout = morphBlendPipelineLayout;
+
+    VK_CHECK(vkCreateComputePipelines(m_vulkanContext.device, VK_NULL_HANDLE, 1, &pipelineInfo, nullptr,
+                                      &morphBlendPipeline))
+
+    vkDestroyShaderModule(m_vulkanContext.device, morphBlendShader, nullptr);
+}
+
+void Renderer::blendMorphTargets(VkCommandBuffer cmd) {
+    if (m_morphInstances.empty()) {
+        return;
+    }
+
+    // grow only, the frame's previous draws are done once its fence was waited on
+    VulkanBuffer &morphedVertexBuffer = m_morphedVertexBuffers[currentFrame];
+    VulkanBuffer &weightBuffer = m_morphWeightBuffers[currentFrame];
+    const size_t morphedVertexBufferSize = m_morphedVertexCount * sizeof(GpuVertex);
+    const size_t weightBufferSize = m_morphWeights.size() * sizeof(float);
+
+    if (morphedVertexBuffer.buffer == VK_NULL_HANDLE || morphedVertexBuffer.info.size < morphedVertexBufferSize) {
+        if (morphedVertexBuffer.buffer != VK_NULL_HANDLE) {
+            m_vulkanContext.destroyBuffer(morphedVertexBuffer);
+        }
+        morphedVertexBuffer = m_vulkanContext.createBuffer(morphedVertexBufferSize,
+                                                           VK_BUFFER_USAGE_STORAGE_BUFFER_BIT |
+                                                           VK_BUFFER_USAGE_SHADER_DEVICE_ADDRESS_BIT,
+                                                           VMA_ALLOCATION_CREATE_DEDICATED_MEMORY_BIT);
+    }
+    if (weightBuffer.buffer == VK_NULL_HANDLE || weightBuffer.info.size < weightBufferSize) {
+        if (weightBuffer.buffer != VK_NULL_HANDLE) {
+            m_vulkanContext.destroyBuffer(weightBuffer);
+        }
+        weightBuffer = m_vulkanContext.createBuffer(weightBufferSize,
+                                                    VK_BUFFER_USAGE_STORAGE_BUFFER_BIT |
+                                                    VK_BUFFER_USAGE_SHADER_DEVICE_ADDRESS_BIT,
+                                                    VMA_ALLOCATION_CREATE_MAPPED_BIT |
+                                                    VMA_ALLOCATION_CREATE_HOST_ACCESS_SEQUENTIAL_WRITE_BIT);
+    }
+
+    // host writes are visible to the queue once it is submitted
+    memcpy(weightBuffer.info.pMappedData, m_morphWeights.data(), weightBufferSize);
+
+    vkCmdBindPipeline(cmd, VK_PIPELINE_BIND_POINT_COMPUTE, morphBlendPipeline);
+
+    PushConstantsMorphBlend pcm = {};
+    pcm.vertexBuffer = m_vulkanContext.getBufferAddress(m_vertexArena.buffer());
+    pcm.deltaBuffer = m_vulkanContext.getBufferAddress(m_morphDeltaArena.buffer());
+    pcm.rangeBuffer = m_vulkanContext.getBufferAddress(m_morphRangeArena.buffer());
+    pcm.weightBuffer = m_vulkanContext.getBufferAddress(weightBuffer);
+    pcm.outputBuffer = m_vulkanContext.getBufferAddress(morphedVertexBuffer);
+
+    for (const auto &morphInstance: m_morphInstances) {
+        pcm.positionQuantization = morphInstance.positionQuantization;
+        pcm.vertexOffset = morphInstance.vertexOffset;
+        pcm.vertexCount = morphInstance.vertexCount;
+        pcm.deltaOffset = morphInstance.deltaOffset;
+        pcm.rangeOffset = morphInstance.rangeOffset;
+        pcm.weightOffset = morphInstance.weightOffset;
+        pcm.outputOffset = morphInstance.outputOffset;
+
+        vkCmdPushConstants(cmd, morphBlendPipelineLayout, VK_SHADER_STAGE_COMPUTE_BIT, 0,
+                           sizeof(PushConstantsMorphBlend), &pcm);
+        vkCmdDispatch(cmd, (morphInstance.vertexCount + 63) / 64, 1, 1);
+    }
+
+    VkMemoryBarrier2 barrier = {};
+    barrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER_2;
+    barrier.srcStageMask = VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT;
+    barrier.srcAccessMask = VK_ACCESS_2_SHADER_WRITE_BIT;
+    barrier.dstStageMask = VK_PIPELINE_STAGE_2_VERTEX_SHADER_BIT;
+    barrier.dstAccessMask = VK_ACCESS_2_SHADER_STORAGE_READ_BIT;
+    if (m_vulkanContext.meshShadersEnabled) {
+        barrier.dstStageMask |= VK_PIPELINE_STAGE_2_MESH_SHADER_BIT_EXT;
+    }
+
+    VkDependencyInfo dependencyInfo = {};
+    dependencyInfo.sType = VK_STRUCTURE_TYPE_DEPENDENCY_INFO;
+    dependencyInfo.memoryBarrierCount = 1;
+    dependencyInfo.pMemoryBarriers = &barrier;
+
+    vkCmdPipelineBarrier2(cmd, &dependencyInfo);
 }
 
 void Renderer::createDrawDatas(VkCommandBuffer cmd) {
@@ -657,169 +1394,285 @@ void Renderer::createDrawDatas(VkCommandBuffer cmd) {
     m_transforms = {glm::mat4(1.f)}; // transform index zero is identity matrix
     m_drawDatas.clear();
     m_modelTransforms.clear();
+    m_morphInstances.clear();
+    m_morphWeights.clear();
+    m_morphedVertexCount = 0;
 
-    for (auto &scenePair: m_sceneDatas) {
-        auto scene = scenePair.first.get();
-        auto &modelData = m_modelDatas[scenePair.second];
+    std::vector<const GltfScene *> scenes(m_modelDatas.size(), nullptr);
+    for (const auto &sceneData: m_sceneDatas) {
+        scenes[sceneData.second] = sceneData.first.get();
+    }
+    std::vector<const MeshBuffers *> generatedMeshes(m_modelDatas.size(), nullptr);
+    for (const auto &meshData: m_generatedMeshDatas) {
+        generatedMeshes[meshData.second] = meshData.first;
+    }
 
-        scene->updateAnimation(m_timer.deltaTime());
+    // render objects of a static model share its rest pose and are drawn instanced, every render object of an
+    // animated model has its own pose, transforms, joints and draws
+    struct PoseDraw {
+        uint32_t modelId;
+        const GltfScene *scene; // null for generated meshes
+        AnimationInstance *animation; // null for the rest pose
+        uint32_t transformOffset;
+        uint32_t jointOffset;
+        uint32_t drawDataOffset;
+        uint32_t drawDataCount;
+        std::vector<glm::mat4> instances; // model transforms
+    };
+    std::vector<PoseDraw> poseDraws;
+    std::vector<uint32_t> staticPoseDraws(m_modelDatas.size(), UINT32_MAX);
+
+    for (const auto &[renderObjectId, renderObject]: m_renderObjects) {
+        uint32_t modelId = renderObject.modelId;
+        const GltfScene *scene = scenes[modelId];
+        if (!scene && !generatedMeshes[modelId]) {
+            continue; // not resident yet
+        }
 
-        modelData.drawDataCount = 0;
-        modelData.drawDataOffset = m_drawDatas.size();
+        if (scene && !scene->animations.empty()) {
+            auto [it, inserted] = m_animationInstances.try_emplace(renderObjectId);
+            if (inserted) {
+                it->second.state.clip = renderObject.animationClip;
+                it->second.state.time = renderObject.animationTime;
+                it->second.state.speed = renderObject.animationSpeed;
+                it->second.pose = scene->restPose;
+            }
+            poseDraws.push_back({modelId, scene, &it->second});
+            poseDraws.back().instances.push_back(renderObject.modelMatrix);
+            continue;
+        }
 
-        modelData.jointOffset = m_joints.size();
-        size_t numSceneJoints = 0;
-        for (const auto &num: scene->skinJointCounts) {
-            numSceneJoints += num;
+        if (staticPoseDraws[modelId] == UINT32_MAX) {
+            staticPoseDraws[modelId] = poseDraws.size();
+            poseDraws.push_back({modelId, scene, nullptr});
         }
-        m_joints.resize(m_joints.size() + numSceneJoints);
+        poseDraws[staticPoseDraws[modelId]].instances.push_back(renderObject.modelMatrix);
+    }
 
-        // update world transform of nodes
-        for (const auto &topLevelNode: scene->topLevelNodes) {
-            std::stack<std::shared_ptr<Node>> nodeStack;
-            nodeStack.push(topLevelNode);
+    // a transform per mesh node, in node order, and the joints of every skin for each pose
+    for (auto &poseDraw: poseDraws) {
+        const GltfScene *scene = poseDraw.scene;
+        if (!scene) {
+            continue;
+        }
 
-            while (!nodeStack.empty()) {
-                auto currentNode = nodeStack.top();
-                nodeStack.pop();
+        poseDraw.transformOffset = m_transforms.size();
+        m_transforms.resize(m_transforms.size() + scene->meshNodes.size());
 
-                if (auto parentNode = currentNode->parent.lock()) {
-                    currentNode->worldTransform = parentNode->worldTransform * currentNode->getLocalTransform();
-                } else {
-                    currentNode->worldTransform = currentNode->getLocalTransform();
-                }
-                for (const auto &child: currentNode->children) {
-                    nodeStack.push(child);
-                }
-            }
+        poseDraw.jointOffset = m_joints.size();
+        m_joints.resize(m_joints.size() + scene->restJoints.size());
+    }
+
+    // poses only read their scene and write their own ranges. static poses copy what the scene computed at load
+    float deltaTime = m_timer.deltaTime();
+    m_threadPool.parallelFor(poseDraws.size(), [&](size_t pose_i) {
+        PoseDraw &poseDraw = poseDraws[pose_i];
+        const GltfScene *scene = poseDraw.scene;
+        if (!scene) {
+            return;
         }
 
-        // generate draw datas
-        for (const auto &topLevelNode: scene->topLevelNodes) {
-            std::stack<std::shared_ptr<Node> > nodeStack;
-            nodeStack.push(topLevelNode);
-
-            while (!nodeStack.empty()) {
-                auto currentNode = nodeStack.top();
-                nodeStack.pop();
-
-                if (currentNode->hasSkin) {
-                    glm::mat4 inverseWorldTransform = glm::inverse(currentNode->worldTransform);
-                    const Skin *skin = scene->skins[currentNode->skin].get();
-                    for (size_t joint_i = 0; joint_i < skin->jointNodeIndices.size(); joint_i++) {
-                        m_joints[modelData.jointOffset + scene->jointOffsets[currentNode->skin] + joint_i] =
-                                inverseWorldTransform * scene->nodes[skin->jointNodeIndices[joint_i]]->worldTransform *
-                                skin->inverseBindMatrices[joint_i];
-                    }
-                }
+        if (!poseDraw.animation) {
+            std::copy(scene->restMeshTransforms.begin(), scene->restMeshTransforms.end(),
+                      m_transforms.begin() + poseDraw.transformOffset);
+            std::copy(scene->restJoints.begin(), scene->restJoints.end(), m_joints.begin() + poseDraw.jointOffset);
+            return;
+        }
 
-                if (const auto &nodeMesh = currentNode->mesh) {
-                    for (const auto &meshPrimitive: nodeMesh->meshPrimitives) {
-                        DrawData drawData = {};
-                        drawData.hasIndices = meshPrimitive.hasIndices;
-                        drawData.indexOffset = meshPrimitive.indexStart + modelData.indexOffset;
-                        drawData.vertexOffset = meshPrimitive.vertexStart + modelData.vertexOffset;
-                        drawData.indexCount = meshPrimitive.indexCount;
-                        drawData.vertexCount = meshPrimitive.vertexCount;
-                        if (meshPrimitive.materialOffset == NO_MATERIAL_INDEX) {
-                            drawData.materialOffset = 0; // default material at index 0
-                        } else {
-                            drawData.materialOffset = meshPrimitive.materialOffset + modelData.materialOffset;
-                        }
-                        drawData.transformOffset = m_transforms.size();
-                        if (currentNode->hasSkin) {
-                            drawData.jointOffset = scene->jointOffsets[currentNode->skin] + modelData.jointOffset;
-                        } else {
-                            drawData.jointOffset = 0;
-                        }
-
-                        modelData.drawDataCount++;
-                        m_drawDatas.emplace_back(drawData);
-                    }
-                    m_transforms.emplace_back(currentNode->worldTransform);
-                }
+        scene->animate(poseDraw.animation->state, deltaTime, poseDraw.animation->pose);
+        scene->writeTransforms(poseDraw.animation->pose, m_transforms.data() + poseDraw.transformOffset,
+                               m_joints.data() + poseDraw.jointOffset);
+    });
 
-                for (const auto &child: currentNode->children) {
-                    nodeStack.push(child);
-                }
-            }
-        }
-    }
+    // generate draw datas
+    for (auto &poseDraw: poseDraws) {
+        const ModelData &modelData = m_modelDatas[poseDraw.modelId];
+        poseDraw.drawDataOffset = m_drawDatas.size();
 
-    for (auto &generatedMeshPair: m_generatedMeshDatas) {
-        auto &meshBuffers = generatedMeshPair.first;
-        auto &modelData = m_modelDatas[generatedMeshPair.second];
+        if (const MeshBuffers *meshBuffers = generatedMeshes[poseDraw.modelId]) {
+            DrawData drawData = {};
 
-        modelData.drawDataCount = 1;
-        modelData.drawDataOffset = m_drawDatas.size();
+            drawData.hasIndices = true;
+            drawData.indexOffset = modelData.indexOffset;
+            drawData.vertexOffset = modelData.vertexOffset;
+            drawData.indexCount = meshBuffers->indices.size();
+            drawData.vertexCount = meshBuffers->vertices.size();
+            drawData.positionQuantization = meshBuffers->positionQuantization;
 
-        DrawData drawData = {};
+            // todo: using default material and texture for now
+            drawData.materialOffset = 0;
+            drawData.jointOffset = 0;
 
-        drawData.hasIndices = true;
-        drawData.indexOffset = modelData.indexOffset;
-        drawData.vertexOffset = modelData.vertexOffset;
-        drawData.indexCount = meshBuffers->indices.size();
-        drawData.vertexCount = meshBuffers->vertices.size();
+            drawData.transformOffset = 0; // identity matrix at index 0
 
-        // todo: using default material and texture for now
-        drawData.materialOffset = 0;
-        drawData.jointOffset = 0;
+            m_drawDatas.emplace_back(drawData);
+            poseDraw.drawDataCount = 1;
+            continue;
+        }
+
+        const GltfScene *scene = poseDraw.scene;
+        const Pose &pose = poseDraw.animation ? poseDraw.animation->pose : scene->restPose;
+
+        uint32_t transformOffset = poseDraw.transformOffset;
+        for (uint32_t node_i: scene->meshNodes) {
+            const Node &node = *scene->nodes[node_i];
+
+            std::span<const float> nodeWeights(pose.weights.data() + pose.weightOffsets[node_i],
+                                               pose.weightOffsets[node_i + 1] - pose.weightOffsets[node_i]);
+
+            for (const auto &meshPrimitive: node.mesh->meshPrimitives) {
+                DrawData drawData = {};
+                drawData.hasIndices = meshPrimitive.hasIndices;
+                drawData.indexOffset = meshPrimitive.indexStart + modelData.indexOffset;
+                drawData.vertexOffset = meshPrimitive.vertexStart + modelData.vertexOffset;
+                drawData.indexCount = meshPrimitive.indexCount;
+                drawData.vertexCount = meshPrimitive.vertexCount;
+                drawData.positionQuantization = meshPrimitive.positionQuantization;
+                if (meshPrimitive.materialOffset == NO_MATERIAL_INDEX) {
+                    drawData.materialOffset = 0; // default material at index 0
+                } else {
+                    drawData.materialOffset = meshPrimitive.materialOffset + modelData.materialOffset;
+                }
+                drawData.transformOffset = transformOffset;
+                drawData.meshletOffset = meshPrimitive.meshletOffset + modelData.meshletOffset;
+                drawData.meshletCount = meshPrimitive.meshletCount;
+                drawData.skinned = node.hasSkin && meshPrimitive.hasSkin;
+                if (drawData.skinned) {
+                    drawData.skinVertexOffset = static_cast<int32_t>(modelData.skinVertexOffset +
+                                                                     meshPrimitive.skinVertexStart) -
+                                                static_cast<int32_t>(drawData.vertexOffset);
+                }
 
-        drawData.transformOffset = 0; // identity matrix at index 0
+                // all zero weights draw the base vertices, only nodes with an active target are blended
+                std::span<const float> weights = nodeWeights.first(std::min<size_t>(nodeWeights.size(),
+                                                                                    meshPrimitive.morphTargetCount));
+                drawData.morphed = std::any_of(weights.begin(), weights.end(),
+                                               [](float weight) { return weight != 0.f; });
+                if (drawData.morphed) {
+                    MorphInstance morphInstance = {};
+                    morphInstance.positionQuantization = meshPrimitive.positionQuantization;
+                    morphInstance.vertexOffset = drawData.vertexOffset;
+                    morphInstance.vertexCount = meshPrimitive.vertexCount;
+                    morphInstance.deltaOffset = modelData.morphDeltaOffset + meshPrimitive.morphDeltaStart;
+                    morphInstance.rangeOffset = modelData.morphRangeOffset + meshPrimitive.morphRangeStart;
+                    morphInstance.weightOffset = m_morphWeights.size();
+                    morphInstance.outputOffset = m_morphedVertexCount;
+                    m_morphWeights.insert(m_morphWeights.end(), weights.begin(), weights.end());
+                    m_morphedVertexCount += meshPrimitive.vertexCount;
+                    m_morphInstances.push_back(morphInstance);
+
+                    drawData.morphVertexOffset = static_cast<int32_t>(morphInstance.outputOffset) -
+                                                 static_cast<int32_t>(drawData.vertexOffset);
+                }
+                drawData.cullMeshlets = !drawData.skinned && !drawData.morphed;
+                drawData.bounds = meshPrimitive.bounds;
+                drawData.lodCount = meshPrimitive.lodCount;
+                std::copy_n(meshPrimitive.lods, meshPrimitive.lodCount, drawData.lods);
+                if (node.hasSkin) {
+                    drawData.jointOffset = scene->jointOffsets[node.skin] + poseDraw.jointOffset;
+                } else {
+                    drawData.jointOffset = 0;
+                }
 
-        m_drawDatas.emplace_back(drawData);
+                m_drawDatas.emplace_back(drawData);
+            }
+            transformOffset++;
+        }
+        poseDraw.drawDataCount = m_drawDatas.size() - poseDraw.drawDataOffset;
     }
 
     // create model transform buffer and update DrawData instance count
     // model transform for instance is at index (modelTransformOffset + gl_InstanceIndex) of modelTransformBuffer
-    std::vector<std::pair<uint32_t, std::vector<glm::mat4>>> modelsDrawn;
-    for (auto &renderObject: m_renderObjects) {
-        uint32_t modelId = renderObject.second.modelId;
-        glm::mat4 &modelTransform = renderObject.second.modelMatrix;
 
-        auto it = std::find_if(modelsDrawn.begin(), modelsDrawn.end(),
-                               [modelId](const std::pair<uint32_t, std::vector<glm::mat4>> &element) {
-                                   return element.first == modelId;
-                               });
+    // world space size of a pixel at distance 1, the view and projection are set up before this is called
+    float pixelsPerUnit = std::abs(m_globalUniformData.proj[1][1]) * m_vulkanContext.windowExtent.height * 0.5f;
 
-        if (it != modelsDrawn.end()) {
-            it->second.emplace_back(modelTransform);
-        } else {
-            modelsDrawn.emplace_back(modelId, std::vector<glm::mat4>{modelTransform});
+    std::vector<DrawData> lodDrawDatas;
+    std::array<std::vector<glm::mat4>, MAX_MESH_LODS> lodInstances;
+    for (auto &poseDraw: poseDraws) {
+        uint32_t instanceCount = poseDraw.instances.size();
+
+        auto &modelData = m_modelDatas[poseDraw.modelId];
+        uint32_t modelTransformOffset = m_modelTransforms.size();
+
+        for (auto &modelMatrix: poseDraw.instances) {
+            m_modelTransforms.emplace_back(modelMatrix);
         }
-    }
 
-    for (auto &model: modelsDrawn) {
-        uint32_t modelId = model.first;
-        uint32_t instanceCount = model.second.size();
+        for (size_t dd_i = 0; dd_i < poseDraw.drawDataCount; dd_i++) {
+            auto &drawData = m_drawDatas[poseDraw.drawDataOffset + dd_i];
+            drawData.modelTransformOffset = modelTransformOffset;
+            drawData.instanceCount = instanceCount;
 
-        auto &modelData = m_modelDatas[modelId];
+            if (drawData.lodCount < 2) {
+                continue;
+            }
 
-        for (size_t dd_i = 0; dd_i < modelData.drawDataCount; dd_i++) {
-            auto &drawData = m_drawDatas[modelData.drawDataOffset + dd_i];
+            for (auto &instances: lodInstances) {
+                instances.clear();
+            }
+            for (auto &modelMatrix: poseDraw.instances) {
+                glm::mat4 world = modelMatrix * m_transforms[drawData.transformOffset];
+                glm::vec3 center = world * glm::vec4(glm::vec3(drawData.bounds), 1.f);
+                float scale = std::max({glm::length(glm::vec3(world[0])), glm::length(glm::vec3(world[1])),
+                                        glm::length(glm::vec3(world[2]))});
+                float distance = std::max(glm::length(center - m_camera.position) - drawData.bounds.w * scale,
+                                          0.001f);
+
+                uint32_t lod = drawData.lodCount - 1;
+                while (lod > 0 && drawData.lods[lod].error * scale * pixelsPerUnit / distance > m_lodErrorThreshold) {
+                    lod--;
+                }
+                lodInstances[lod].emplace_back(modelMatrix);
+            }
+
+            if (lodInstances[0].size() == instanceCount) {
+                continue;
+            }
+
+            // full detail keeps the meshlet path, the coarser lods are plain indexed draws
             drawData.modelTransformOffset = m_modelTransforms.size();
-            drawData.instanceCount = instanceCount;
-        }
+            drawData.instanceCount = lodInstances[0].size();
+            m_modelTransforms.insert(m_modelTransforms.end(), lodInstances[0].begin(), lodInstances[0].end());
 
-        for (auto &modelMatrix: model.second) {
-            m_modelTransforms.emplace_back(modelMatrix);
+            for (uint32_t lod_i = 1; lod_i < drawData.lodCount; lod_i++) {
+                if (lodInstances[lod_i].empty()) {
+                    continue;
+                }
+                DrawData lodDrawData = drawData;
+                lodDrawData.indexOffset = drawData.lods[lod_i].indexStart + modelData.indexOffset;
+                lodDrawData.indexCount = drawData.lods[lod_i].indexCount;
+                lodDrawData.meshletCount = 0;
+                lodDrawData.lodCount = 0;
+                lodDrawData.modelTransformOffset = m_modelTransforms.size();
+                lodDrawData.instanceCount = lodInstances[lod_i].size();
+                m_modelTransforms.insert(m_modelTransforms.end(), lodInstances[lod_i].begin(),
+                                         lodInstances[lod_i].end());
+                lodDrawDatas.emplace_back(lodDrawData);
+            }
         }
     }
+    m_drawDatas.insert(m_drawDatas.end(), lodDrawDatas.begin(), lodDrawDatas.end());
 
     // (re)create buffers if size changes
     uint32_t transformBufferSize = m_transforms.size() * sizeof(glm::mat4);
     uint32_t jointBufferSize = m_joints.size() * sizeof(glm::mat4);
     uint32_t modelTransformBufferSize = m_modelTransforms.size() * sizeof(glm::mat4);
 
-    if (transformBufferSize != 0 && transformBufferSize != m_transformBuffer.info.size) {
-        if (m_transformBuffer.buffer != VK_NULL_HANDLE) {
-            m_vulkanContext.destroyBuffer(m_transformBuffer);
+    // the staging buffers are this frame's own, the previous frame's copies may still read the other ones
+    VulkanBuffer &transformBuffer = m_transformBuffers[currentFrame];
+    VulkanBuffer &jointBuffer = m_jointBuffers[currentFrame];
+    VulkanBuffer &modelTransformBuffer = m_modelTransformBuffers[currentFrame];
+
+    if (transformBufferSize != 0 && transformBufferSize != transformBuffer.info.size) {
+        if (transformBuffer.buffer != VK_NULL_HANDLE) {
+            m_vulkanContext.destroyBuffer(transformBuffer);
         }
-        m_transformBuffer = m_vulkanContext.createBuffer(transformBufferSize,
-                                                         VK_BUFFER_USAGE_STORAGE_BUFFER_BIT |
-                                                         VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
-                                                         VMA_ALLOCATION_CREATE_MAPPED_BIT |
-                                                         VMA_ALLOCATION_CREATE_HOST_ACCESS_SEQUENTIAL_WRITE_BIT);
+        transformBuffer = m_vulkanContext.createBuffer(transformBufferSize,
+                                                       VK_BUFFER_USAGE_STORAGE_BUFFER_BIT |
+                                                       VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+                                                       VMA_ALLOCATION_CREATE_MAPPED_BIT |
+                                                       VMA_ALLOCATION_CREATE_HOST_ACCESS_SEQUENTIAL_WRITE_BIT);
     }
 
     if (transformBufferSize != 0 && transformBufferSize != m_boundedTransformBuffers[currentFrame].info.size) {
@@ -832,15 +1685,15 @@ void Renderer::createDrawDatas(VkCommandBuffer cmd) {
                                                                                VMA_ALLOCATION_CREATE_DEDICATED_MEMORY_BIT);
     }
 
-    if (jointBufferSize != 0 && jointBufferSize != m_jointBuffer.info.size) {
-        if (m_jointBuffer.buffer != VK_NULL_HANDLE) {
-            m_vulkanContext.destroyBuffer(m_jointBuffer);
+    if (jointBufferSize != 0 && jointBufferSize != jointBuffer.info.size) {
+        if (jointBuffer.buffer != VK_NULL_HANDLE) {
+            m_vulkanContext.destroyBuffer(jointBuffer);
         }
-        m_jointBuffer = m_vulkanContext.createBuffer(jointBufferSize,
-                                                     VK_BUFFER_USAGE_STORAGE_BUFFER_BIT |
-                                                     VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
-                                                     VMA_ALLOCATION_CREATE_MAPPED_BIT |
-                                                     VMA_ALLOCATION_CREATE_HOST_ACCESS_SEQUENTIAL_WRITE_BIT);
+        jointBuffer = m_vulkanContext.createBuffer(jointBufferSize,
+                                                   VK_BUFFER_USAGE_STORAGE_BUFFER_BIT |
+                                                   VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+                                                   VMA_ALLOCATION_CREATE_MAPPED_BIT |
+                                                   VMA_ALLOCATION_CREATE_HOST_ACCESS_SEQUENTIAL_WRITE_BIT);
     }
 
     if (jointBufferSize != 0 && jointBufferSize != m_boundedJointBuffers[currentFrame].info.size) {
@@ -853,15 +1706,15 @@ void Renderer::createDrawDatas(VkCommandBuffer cmd) {
                                                                            VMA_ALLOCATION_CREATE_DEDICATED_MEMORY_BIT);
     }
 
-    if (modelTransformBufferSize != 0 && modelTransformBufferSize != m_modelTransformBuffer.info.size) {
-        if (m_modelTransformBuffer.buffer != VK_NULL_HANDLE) {
-            m_vulkanContext.destroyBuffer(m_modelTransformBuffer);
+    if (modelTransformBufferSize != 0 && modelTransformBufferSize != modelTransformBuffer.info.size) {
+        if (modelTransformBuffer.buffer != VK_NULL_HANDLE) {
+            m_vulkanContext.destroyBuffer(modelTransformBuffer);
         }
-        m_modelTransformBuffer = m_vulkanContext.createBuffer(modelTransformBufferSize,
-                                                              VK_BUFFER_USAGE_STORAGE_BUFFER_BIT |
-                                                              VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
-                                                              VMA_ALLOCATION_CREATE_MAPPED_BIT |
-                                                              VMA_ALLOCATION_CREATE_HOST_ACCESS_SEQUENTIAL_WRITE_BIT);
+        modelTransformBuffer = m_vulkanContext.createBuffer(modelTransformBufferSize,
+                                                            VK_BUFFER_USAGE_STORAGE_BUFFER_BIT |
+                                                            VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+                                                            VMA_ALLOCATION_CREATE_MAPPED_BIT |
+                                                            VMA_ALLOCATION_CREATE_HOST_ACCESS_SEQUENTIAL_WRITE_BIT);
     }
 
     if (modelTransformBufferSize != 0 &&
@@ -877,33 +1730,33 @@ void Renderer::createDrawDatas(VkCommandBuffer cmd) {
 
     // update buffers contents
     if (transformBufferSize != 0) {
-        memcpy(m_transformBuffer.info.pMappedData, m_transforms.data(), transformBufferSize);
+        memcpy(transformBuffer.info.pMappedData, m_transforms.data(), transformBufferSize);
         VkBufferCopy transformCopy = {0};
         transformCopy.dstOffset = 0;
         transformCopy.srcOffset = 0;
         transformCopy.size = transformBufferSize;
-        vkCmdCopyBuffer(cmd, m_transformBuffer.buffer, m_boundedTransformBuffers[currentFrame].buffer,
+        vkCmdCopyBuffer(cmd, transformBuffer.buffer, m_boundedTransformBuffers[currentFrame].buffer,
                         1, &transformCopy);
     }
 
     if (jointBufferSize != 0) {
-        memcpy(m_jointBuffer.info.pMappedData, m_joints.data(), jointBufferSize);
+        memcpy(jointBuffer.info.pMappedData, m_joints.data(), jointBufferSize);
         VkBufferCopy jointCopy = {0};
         jointCopy.dstOffset = 0;
         jointCopy.srcOffset = 0;
         jointCopy.size = jointBufferSize;
-        vkCmdCopyBuffer(cmd, m_jointBuffer.buffer, m_boundedJointBuffers[currentFrame].buffer,
+        vkCmdCopyBuffer(cmd, jointBuffer.buffer, m_boundedJointBuffers[currentFrame].buffer,
                         1, &jointCopy);
     }
 
     if (modelTransformBufferSize != 0) {
-        memcpy(m_modelTransformBuffer.info.pMappedData, m_modelTransforms.data(), modelTransformBufferSize);
+        memcpy(modelTransformBuffer.info.pMappedData, m_modelTransforms.data(), modelTransformBufferSize);
 
         VkBufferCopy modelTransformCopy = {0};
         modelTransformCopy.dstOffset = 0;
         modelTransformCopy.srcOffset = 0;
         modelTransformCopy.size = modelTransformBufferSize;
-        vkCmdCopyBuffer(cmd, m_modelTransformBuffer.buffer, m_boundedModelTransformBuffer[currentFrame].buffer,
+        vkCmdCopyBuffer(cmd, modelTransformBuffer.buffer, m_boundedModelTransformBuffer[currentFrame].buffer,
                         1, &modelTransformCopy);
     }
 }
@@ -966,34 +1819,109 @@ void Renderer::updateLightPos(uint32_t lightIndex) {
 
 uint32_t Renderer::loadGeneratedMesh(MeshBuffers *meshBuffer) {
     ModelData modelData = {};
+    modelData.state = ModelState::eResident;
 
     uint32_t modelId = getLoadedModelId();
 
-    modelData.vertexOffset = m_vertices.size();
-    m_vertices.insert(m_vertices.end(), meshBuffer->vertices.begin(), meshBuffer->vertices.end());
+    std::vector<GpuVertex> vertices(meshBuffer->vertices.size());
+    VertexFormat::pack(meshBuffer->vertices, meshBuffer->positionQuantization, vertices.data());
 
-    modelData.indexOffset = m_indices.size();
-    m_indices.insert(m_indices.end(), meshBuffer->indices.begin(), meshBuffer->indices.end());
+    modelData.vertexCount = vertices.size();
+    modelData.vertexOffset = m_vertexArena.allocate(modelData.vertexCount);
+    m_vertexArena.upload(modelData.vertexOffset, vertices.data(), vertices.size());
 
     // make sure index points to the right vertex
-    for (size_t index_i = modelData.indexOffset; index_i < m_indices.size(); index_i++) {
-        m_indices[index_i] += modelData.vertexOffset;
+    std::vector<uint32_t> indices = meshBuffer->indices;
+    for (auto &index: indices) {
+        index += modelData.vertexOffset;
     }
 
+    modelData.indexCount = indices.size();
+    modelData.indexOffset = m_indexArena.allocate(modelData.indexCount);
+    m_indexArena.upload(modelData.indexOffset, indices.data(), indices.size());
+
     // todo: use default material and textures for now, implement properly later
-    modelData.textureOffset = 0;
     modelData.materialOffset = 0;
 
     m_generatedMeshDatas.emplace_back(meshBuffer, modelId);
 
     m_modelDatas.emplace_back(modelData);
 
-    destroyStaticBuffers();
-    createStaticBuffers();
+    flushGeometryUploads();
 
     return modelId;
 }
 
+void Renderer::unloadModel(uint32_t modelId) {
+    if (modelId >= m_modelDatas.size() || m_modelDatas[modelId].state == ModelState::eUnloaded) {
+        std::cout << "invalid modelId" << std::endl;
+        return;
+    }
+
+    ModelData &modelData = m_modelDatas[modelId];
+    ModelState state = modelData.state;
+    modelData.state = ModelState::eUnloaded;
+
+    for (const auto &[renderObjectId, renderObject]: m_renderObjects) {
+        if (renderObject.modelId == modelId) {
+            m_animationInstances.erase(renderObjectId);
+        }
+    }
+    std::erase_if(m_renderObjects, [modelId](const std::pair<uint32_t, RenderObjectInfo> &renderObject) {
+        return renderObject.second.modelId == modelId;
+    });
+
+    // an import still running is dropped by integrateLoadedModels
+    if (state != ModelState::eResident) {
+        return;
+    }
+
+    RetiredModel retiredModel = {};
+    retiredModel.modelData = modelData;
+    retiredModel.frameNumber = m_frameNumber;
+
+    auto sceneIt = std::find_if(m_sceneDatas.begin(), m_sceneDatas.end(),
+                                [modelId](const std::pair<std::unique_ptr<GltfScene>, uint32_t> &sceneData) {
+                                    return sceneData.second == modelId;
+                                });
+    if (sceneIt != m_sceneDatas.end()) {
+        retiredModel.scene = std::move(sceneIt->first);
+        m_sceneDatas.erase(sceneIt);
+    }
+    std::erase_if(m_generatedMeshDatas, [modelId](const std::pair<MeshBuffers *, uint32_t> &meshData) {
+        return meshData.second == modelId;
+    });
+
+    m_retiredModels.push_back(std::move(retiredModel));
+}
+
+void Renderer::setGeometryCompaction(bool enabled) {
+    m_geometryCompaction = enabled;
+}
+
+void Renderer::releaseModel(const ModelData &modelData) {
+    m_vertexArena.free(modelData.vertexOffset, modelData.vertexCount);
+    m_indexArena.free(modelData.indexOffset, modelData.indexCount);
+    m_materialArena.free(modelData.materialOffset, modelData.materialCount);
+    m_skinArena.free(modelData.skinVertexOffset, modelData.skinVertexCount);
+    m_meshletArena.free(modelData.meshletOffset, modelData.meshletCount);
+    m_meshletVertexArena.free(modelData.meshletVertexOffset, modelData.meshletVertexCount);
+    m_meshletTriangleArena.free(modelData.meshletTriangleOffset, modelData.meshletTriangleCount);
+    m_morphDeltaArena.free(modelData.morphDeltaOffset, modelData.morphDeltaCount);
+    m_morphRangeArena.free(modelData.morphRangeOffset, modelData.morphRangeCount);
+
+    // the descriptors are left pointing at the destroyed images, the texture binding is partially bound and no
+    // material refers to them until the slots are written again
+    for (uint32_t slot: modelData.textureSlots) {
+        if (--m_textureRefCounts[slot] != 0) {
+            continue;
+        }
+        m_textureSlotLookup.erase({m_textures[slot]->imageview, m_textures[slot]->sampler});
+        m_textureSlots.free(slot, 1);
+        m_textures[slot].reset();
+    }
+}
+
 uint32_t Renderer::getLoadedModelId() {
     return m_loadedModelCount++;
 }
@@ -1003,7 +1931,7 @@ uint32_t Renderer::getRenderObjectId() {
 }
 
 uint32_t Renderer::addRenderObject(RenderObjectInfo info) {
-    if (info.modelId > m_loadedModelCount - 1) {
+    if (info.modelId > m_loadedModelCount - 1 || m_modelDatas[info.modelId].state == ModelState::eUnloaded) {
         std::cout << "invalid modelId" << std::endl;
         return LOAD_FAILED;
     }
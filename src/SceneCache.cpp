@@ -0,0 +1,389 @@
+#include "SceneCache.h"
+
+#include "GltfLoader.h"
+#include "Utils.h"
+
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <type_traits>
+#include <unordered_map>
+
+constexpr uint32_t SCENE_CACHE_MAGIC = 0x43454B56; // "VKEC"
+
+struct SceneCacheHeader {
+    uint32_t magic;
+    uint32_t loaderVersion;
+    uint64_t contentHash;
+    // layouts are written as raw bytes, refuse files from builds where they differ
+    uint32_t vertexSize;
+    uint32_t materialSize;
+    uint32_t primitiveSize;
+    uint32_t channelSize;
+    uint32_t meshletSize;
+    uint32_t morphDeltaSize;
+};
+
+class BinaryWriter {
+public:
+    std::vector<std::byte> bytes;
+
+    void writeBytes(const void *data, size_t size) {
+        const auto *begin = static_cast<const std::byte *>(data);
+        bytes.insert(bytes.end(), begin, begin + size);
+    }
+
+    template<typename T>
+    void write(const T &value) {
+        static_assert(std::is_trivially_copyable_v<T>);
+        writeBytes(&value, sizeof(T));
+    }
+
+    template<typename T>
+    void writeVector(const std::vector<T> &values) {
+        static_assert(std::is_trivially_copyable_v<T>);
+        write<uint64_t>(values.size());
+        writeBytes(values.data(), values.size() * sizeof(T));
+    }
+
+    void writeString(const std::string &str) {
+        write<uint64_t>(str.size());
+        writeBytes(str.data(), str.size());
+    }
+};
+
+// every read is bounds checked, a truncated or corrupt file only sets failed
+class BinaryReader {
+public:
+    BinaryReader(const std::byte *data, size_t size) : m_data(data), m_size(size) {}
+
+    bool failed = false;
+
+    [[nodiscard]] size_t remaining() const { return m_size - m_offset; }
+
+    bool readBytes(void *dst, size_t size) {
+        if (failed || size > remaining()) {
+            failed = true;
+            return false;
+        }
+        memcpy(dst, m_data + m_offset, size);
+        m_offset += size;
+        return true;
+    }
+
+    template<typename T>
+    T read() {
+        static_assert(std::is_trivially_copyable_v<T>);
+        T value = {};
+        readBytes(&value, sizeof(T));
+        return value;
+    }
+
+    // element counts are checked against the remaining size before allocating anything
+    uint64_t readCount(size_t elementSize) {
+        auto count = read<uint64_t>();
+        if (elementSize != 0 && count > remaining() / elementSize) {
+            failed = true;
+            return 0;
+        }
+        return count;
+    }
+
+    template<typename T>
+    void readVector(std::vector<T> &values) {
+        static_assert(std::is_trivially_copyable_v<T>);
+        values.resize(readCount(sizeof(T)));
+        readBytes(values.data(), values.size() * sizeof(T));
+    }
+
+    void readString(std::string &str) {
+        str.resize(readCount(1));
+        readBytes(str.data(), str.size());
+    }
+
+private:
+    const std::byte *m_data;
+    size_t m_size;
+    size_t m_offset = 0;
+};
+
+static SceneCacheHeader currentHeader(uint64_t contentHash) {
+    SceneCacheHeader header = {};
+    header.magic = SCENE_CACHE_MAGIC;
+    header.loaderVersion = SceneCache::LOADER_VERSION;
+    header.contentHash = contentHash;
+    header.vertexSize = sizeof(Vertex);
+    header.materialSize = sizeof(Material);
+    header.primitiveSize = sizeof(MeshPrimitive);
+    header.channelSize = sizeof(AnimationChannel);
+    header.meshletSize = sizeof(Meshlet);
+    header.morphDeltaSize = sizeof(MorphDelta);
+
+    return header;
+}
+
+static void clearCachedData(GltfScene &scene) {
+    scene.vertices.clear();
+    scene.indices.clear();
+    scene.meshlets.clear();
+    scene.meshletVertices.clear();
+    scene.meshletTriangles.clear();
+    scene.morphDeltas.clear();
+    scene.morphRanges.clear();
+    scene.materials.clear();
+    scene.materialNames.clear();
+    scene.meshes.clear();
+    scene.nodes.clear();
+    scene.topLevelNodes.clear();
+    scene.animations.clear();
+    scene.skins.clear();
+    scene.skinJointCounts.clear();
+    scene.jointOffsets.clear();
+}
+
+namespace SceneCache {
+    std::filesystem::path cachePath(const std::filesystem::path &assetPath) {
+        std::filesystem::path cacheFile = assetPath;
+        cacheFile += ".vkecache";
+
+        return cacheFile;
+    }
+
+    bool write(const std::filesystem::path &cacheFile, uint64_t contentHash, const GltfScene &scene) {
+        BinaryWriter writer;
+        writer.write(currentHeader(contentHash));
+
+        writer.writeVector(scene.vertices);
+        writer.writeVector(scene.indices);
+        writer.writeVector(scene.meshlets);
+        writer.writeVector(scene.meshletVertices);
+        writer.writeVector(scene.meshletTriangles);
+        writer.writeVector(scene.morphDeltas);
+        writer.writeVector(scene.morphRanges);
+
+        writer.writeVector(scene.materials);
+        writer.write<uint64_t>(scene.materialNames.size());
+        for (const auto &name: scene.materialNames) {
+            writer.writeString(name);
+        }
+
+        std::unordered_map<const Mesh *, uint32_t> meshIndices;
+        writer.write<uint64_t>(scene.meshes.size());
+        for (size_t mesh_i = 0; mesh_i < scene.meshes.size(); mesh_i++) {
+            writer.writeString(scene.meshes[mesh_i]->name);
+            writer.writeVector(scene.meshes[mesh_i]->meshPrimitives);
+            writer.writeVector(scene.meshes[mesh_i]->weights);
+            meshIndices[scene.meshes[mesh_i].get()] = static_cast<uint32_t>(mesh_i);
+        }
+
+        std::unordered_map<const Node *, uint32_t> nodeIndices;
+        for (size_t node_i = 0; node_i < scene.nodes.size(); node_i++) {
+            nodeIndices[scene.nodes[node_i].get()] = static_cast<uint32_t>(node_i);
+        }
+
+        writer.write<uint64_t>(scene.nodes.size());
+        for (const auto &node: scene.nodes) {
+            writer.writeString(node->name);
+            writer.write<uint32_t>(node->mesh ? meshIndices.at(node->mesh.get()) : UINT32_MAX);
+            writer.write(node->matrix);
+            writer.write(node->translation);
+            writer.write(node->rotation);
+            writer.write(node->scale);
+            writer.write<uint32_t>(node->hasSkin ? node->skin : 0);
+            writer.write<uint8_t>(node->hasSkin);
+            writer.writeVector(node->weights);
+
+            std::vector<uint32_t> children;
+            for (const auto &child: node->children) {
+                children.push_back(nodeIndices.at(child.get()));
+            }
+            writer.writeVector(children);
+        }
+
+        writer.write<uint64_t>(scene.animations.size());
+        for (const auto &animation: scene.animations) {
+            writer.writeString(animation.name);
+            writer.write(animation.start);
+            writer.write(animation.end);
+
+            writer.write<uint64_t>(animation.samplers.size());
+            for (const auto &sampler: animation.samplers) {
+                writer.write<uint32_t>(sampler.interpolation);
+                writer.write<uint32_t>(sampler.encoding);
+                writer.writeVector(sampler.inputs);
+                writer.writeVector(sampler.outputs);
+                writer.writeVector(sampler.weightOutputs);
+                writer.writeVector(sampler.frames);
+                writer.write(sampler.startTime);
+                writer.write(sampler.frameTime);
+                writer.writeVector(sampler.packedOutputs);
+                writer.write(sampler.rangeMin);
+                writer.write(sampler.rangeExtent);
+            }
+
+            writer.writeVector(animation.channels);
+        }
+
+        writer.write<uint64_t>(scene.skins.size());
+        for (const auto &skin: scene.skins) {
+            writer.writeString(skin->name);
+            writer.writeVector(skin->inverseBindMatrices);
+            writer.write(skin->skeletonNodeIndex);
+            writer.writeVector(skin->jointNodeIndices);
+        }
+        writer.writeVector(scene.skinJointCounts);
+        writer.writeVector(scene.jointOffsets);
+
+        // write next to the final file and rename, so a crash never leaves a truncated cache behind
+        std::filesystem::path tempFile = cacheFile;
+        tempFile += ".tmp";
+        {
+            std::ofstream file(tempFile, std::ios::binary | std::ios::trunc);
+            if (!file.is_open()) {
+                return false;
+            }
+            file.write(reinterpret_cast<const char *>(writer.bytes.data()),
+                       static_cast<std::streamsize>(writer.bytes.size()));
+            if (!file.good()) {
+                return false;
+            }
+        }
+
+        std::error_code error;
+        std::filesystem::rename(tempFile, cacheFile, error);
+        if (error) {
+            std::filesystem::remove(tempFile, error);
+            return false;
+        }
+
+        return true;
+    }
+
+    bool read(const std::filesystem::path &cacheFile, uint64_t contentHash, GltfScene &scene) {
+        MappedFile file(cacheFile);
+        if (!file.isOpen()) {
+            return false;
+        }
+
+        BinaryReader reader(file.data(), file.size());
+
+        SceneCacheHeader expectedHeader = currentHeader(contentHash);
+        auto header = reader.read<SceneCacheHeader>();
+        if (reader.failed || memcmp(&header, &expectedHeader, sizeof(SceneCacheHeader)) != 0) {
+            return false;
+        }
+
+        reader.readVector(scene.vertices);
+        reader.readVector(scene.indices);
+        reader.readVector(scene.meshlets);
+        reader.readVector(scene.meshletVertices);
+        reader.readVector(scene.meshletTriangles);
+        reader.readVector(scene.morphDeltas);
+        reader.readVector(scene.morphRanges);
+
+        reader.readVector(scene.materials);
+        scene.materialNames.resize(reader.readCount(sizeof(uint64_t)));
+        for (auto &name: scene.materialNames) {
+            reader.readString(name);
+        }
+
+        size_t meshCount = reader.readCount(3 * sizeof(uint64_t));
+        for (size_t mesh_i = 0; mesh_i < meshCount && !reader.failed; mesh_i++) {
+            auto mesh = std::make_shared<Mesh>();
+            reader.readString(mesh->name);
+            reader.readVector(mesh->meshPrimitives);
+            reader.readVector(mesh->weights);
+            scene.meshes.emplace_back(std::move(mesh));
+        }
+
+        size_t nodeCount = reader.readCount(sizeof(uint64_t));
+        std::vector<std::vector<uint32_t>> nodeChildren(nodeCount);
+        for (size_t node_i = 0; node_i < nodeCount && !reader.failed; node_i++) {
+            auto node = std::make_shared<Node>();
+            reader.readString(node->name);
+
+            auto meshIndex = reader.read<uint32_t>();
+            if (meshIndex != UINT32_MAX) {
+                if (meshIndex >= scene.meshes.size()) {
+                    reader.failed = true;
+                    break;
+                }
+                node->mesh = scene.meshes[meshIndex];
+            }
+
+            node->matrix = reader.read<glm::mat4>();
+            node->translation = reader.read<glm::vec3>();
+            node->rotation = reader.read<glm::quat>();
+            node->scale = reader.read<glm::vec3>();
+            node->skin = reader.read<uint32_t>();
+            node->hasSkin = reader.read<uint8_t>() != 0;
+            reader.readVector(node->weights);
+            reader.readVector(nodeChildren[node_i]);
+
+            scene.nodes.emplace_back(std::move(node));
+        }
+
+        for (size_t parent_i = 0; parent_i < scene.nodes.size() && !reader.failed; parent_i++) {
+            for (uint32_t child_i: nodeChildren[parent_i]) {
+                if (child_i >= scene.nodes.size()) {
+                    reader.failed = true;
+                    break;
+                }
+                scene.nodes[parent_i]->children.push_back(scene.nodes[child_i]);
+                scene.nodes[child_i]->parent = scene.nodes[parent_i];
+            }
+        }
+
+        size_t animationCount = reader.readCount(sizeof(uint64_t));
+        for (size_t animation_i = 0; animation_i < animationCount && !reader.failed; animation_i++) {
+            Animation animation = {};
+            reader.readString(animation.name);
+            animation.start = reader.read<float>();
+            animation.end = reader.read<float>();
+
+            animation.samplers.resize(reader.readCount(sizeof(uint32_t)));
+            for (auto &sampler: animation.samplers) {
+                sampler.interpolation = static_cast<AnimationSampler::Interpolation>(reader.read<uint32_t>());
+                sampler.encoding = static_cast<AnimationSampler::Encoding>(reader.read<uint32_t>());
+                reader.readVector(sampler.inputs);
+                reader.readVector(sampler.outputs);
+                reader.readVector(sampler.weightOutputs);
+                reader.readVector(sampler.frames);
+                sampler.startTime = reader.read<float>();
+                sampler.frameTime = reader.read<float>();
+                reader.readVector(sampler.packedOutputs);
+                sampler.rangeMin = reader.read<glm::vec3>();
+                sampler.rangeExtent = reader.read<glm::vec3>();
+            }
+
+            reader.readVector(animation.channels);
+            scene.animations.emplace_back(std::move(animation));
+        }
+
+        size_t skinCount = reader.readCount(sizeof(uint64_t));
+        for (size_t skin_i = 0; skin_i < skinCount && !reader.failed; skin_i++) {
+            auto skin = std::make_unique<Skin>();
+            reader.readString(skin->name);
+            reader.readVector(skin->inverseBindMatrices);
+            skin->skeletonNodeIndex = reader.read<uint32_t>();
+            reader.readVector(skin->jointNodeIndices);
+            scene.skins.emplace_back(std::move(skin));
+        }
+        reader.readVector(scene.skinJointCounts);
+        reader.readVector(scene.jointOffsets);
+
+        if (reader.failed) {
+            std::cerr << "Scene cache " << cacheFile << " is corrupt, reloading from source" << std::endl;
+            clearCachedData(scene);
+            return false;
+        }
+
+        for (auto &node: scene.nodes) {
+            if (node->parent.lock() == nullptr) {
+                scene.topLevelNodes.push_back(node);
+            }
+        }
+
+        return true;
+    }
+}
@@ -6,6 +6,8 @@
 #include "VulkanUtils.h"
 #include "VulkanInit.h"
 #include "VulkanPipeline.h"
+#include "TextureFile.h"
+#include "Utils.h"
 #include <numbers>
 
 Skybox::Skybox(VulkanContext *vulkanContext) : m_vulkanContext(vulkanContext) {
@@ -14,44 +16,21 @@ Skybox::Skybox(VulkanContext *vulkanContext) : m_vulkanContext(vulkanContext) {
     const size_t vertexBufferSize = meshBuffers.vertices.size() * sizeof(Vertex);
     const size_t indexBufferSize = meshBuffers.indices.size() * sizeof(uint32_t);
 
-    VulkanBuffer stagingBuffer = m_vulkanContext->createBuffer(vertexBufferSize + indexBufferSize,
-                                                               VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
-                                                               VMA_ALLOCATION_CREATE_MAPPED_BIT |
-                                                               VMA_ALLOCATION_CREATE_HOST_ACCESS_SEQUENTIAL_WRITE_BIT);
-
-    void *data = stagingBuffer.info.pMappedData;
-
     vertexBuffer = m_vulkanContext->createBuffer(vertexBufferSize,
                                                  VK_BUFFER_USAGE_STORAGE_BUFFER_BIT |
                                                  VK_BUFFER_USAGE_TRANSFER_DST_BIT |
                                                  VK_BUFFER_USAGE_SHADER_DEVICE_ADDRESS_BIT,
                                                  VMA_ALLOCATION_CREATE_DEDICATED_MEMORY_BIT);
-    memcpy(data, meshBuffers.vertices.data(), vertexBufferSize);
+    m_vulkanContext->uploadManager.uploadBuffer(vertexBuffer.buffer, 0, meshBuffers.vertices.data(), vertexBufferSize);
 
     indexBuffer = m_vulkanContext->createBuffer(indexBufferSize,
                                                 VK_BUFFER_USAGE_INDEX_BUFFER_BIT |
                                                 VK_BUFFER_USAGE_TRANSFER_DST_BIT |
                                                 VK_BUFFER_USAGE_SHADER_DEVICE_ADDRESS_BIT,
                                                 VMA_ALLOCATION_CREATE_DEDICATED_MEMORY_BIT);
-    memcpy(static_cast<std::byte *>(data) + vertexBufferSize, meshBuffers.indices.data(), indexBufferSize);
-
-    m_vulkanContext->immediateSubmit([&](VkCommandBuffer cmd) {
-        VkBufferCopy vertexCopy = {0};
-        vertexCopy.dstOffset = 0;
-        vertexCopy.srcOffset = 0;
-        vertexCopy.size = vertexBufferSize;
-        vkCmdCopyBuffer(cmd, stagingBuffer.buffer, vertexBuffer.buffer,
-                        1, &vertexCopy);
-
-        VkBufferCopy indexCopy = {0};
-        indexCopy.dstOffset = 0;
-        indexCopy.srcOffset = vertexBufferSize;
-        indexCopy.size = indexBufferSize;
-        vkCmdCopyBuffer(cmd, stagingBuffer.buffer, indexBuffer.buffer,
-                        1, &indexCopy);
-    });
+    m_vulkanContext->uploadManager.uploadBuffer(indexBuffer.buffer, 0, meshBuffers.indices.data(), indexBufferSize);
 
-    m_vulkanContext->destroyBuffer(stagingBuffer);
+    m_vulkanContext->uploadManager.flush();
 
     createOffscreenDrawImage();
 
@@ -96,36 +75,55 @@ Skybox::Skybox(VulkanContext *vulkanContext) : m_vulkanContext(vulkanContext) {
 
 bool Skybox::load(std::filesystem::path filePath) {
     auto path = std::filesystem::current_path() / filePath;
-    int width, height, numChannels;
 
     m_loaded = false;
 
-    unsigned char *stbData = stbi_load(path.string().c_str(), &width, &height, &numChannels, 4);
-    if (stbData) {
+    MappedFile file(path);
+    if (!file.isOpen()) {
+        return false;
+    }
+
+    // ktx2/dds with prebuilt mips, e.g. bc6h for hdr skies, is uploaded as is. everything else goes through stb_image
+    if (isTextureContainer(file.data(), file.size())) {
+        std::optional<TextureFile> texture = parseTextureFile(file.data(), file.size());
+        if (!texture || !m_vulkanContext->supportsSampledFormat(texture->format)) {
+            std::cerr << "Unsupported skybox texture " << path << std::endl;
+            return false;
+        }
+
+        loadedImage = m_vulkanContext->createImage(*texture, VK_IMAGE_USAGE_SAMPLED_BIT);
+    } else {
+        int width, height, numChannels;
+        unsigned char *stbData = stbi_load_from_memory(reinterpret_cast<const unsigned char *>(file.data()),
+                                                       static_cast<int>(file.size()),
+                                                       &width, &height, &numChannels, 4);
+        if (!stbData) {
+            return false;
+        }
+
         VkExtent3D extent(width, height, 1);
 
         loadedImage = m_vulkanContext->createImage(stbData, extent, VK_FORMAT_R8G8B8A8_UNORM,
                                                    VK_IMAGE_USAGE_SAMPLED_BIT, true);
 
         stbi_image_free(stbData);
-        m_loaded = true;
-
-        VkSamplerCreateInfo samplerInfo = {};
-        samplerInfo.sType = VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO;
-        samplerInfo.magFilter = VK_FILTER_LINEAR;
-        samplerInfo.minFilter = VK_FILTER_LINEAR;
-        samplerInfo.mipmapMode = VK_SAMPLER_MIPMAP_MODE_LINEAR;
-        samplerInfo.addressModeU = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
-        samplerInfo.addressModeV = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
-        samplerInfo.addressModeW = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
-        samplerInfo.maxLod = 16.f;
-
-        vkCreateSampler(m_vulkanContext->device, &samplerInfo, nullptr, &sampler);
-
-        return true;
     }
-
-    return false;
+    m_vulkanContext->uploadManager.flush();
+    m_loaded = true;
+
+    VkSamplerCreateInfo samplerInfo = {};
+    samplerInfo.sType = VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO;
+    samplerInfo.magFilter = VK_FILTER_LINEAR;
+    samplerInfo.minFilter = VK_FILTER_LINEAR;
+    samplerInfo.mipmapMode = VK_SAMPLER_MIPMAP_MODE_LINEAR;
+    samplerInfo.addressModeU = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+    samplerInfo.addressModeV = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+    samplerInfo.addressModeW = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+    samplerInfo.maxLod = 16.f;
+
+    sampler = m_vulkanContext->acquireSampler(samplerInfo);
+
+    return true;
 }
 
 Skybox::~Skybox() {
@@ -134,7 +132,7 @@ Skybox::~Skybox() {
 
     if (m_loaded) {
         m_vulkanContext->destroyImage(loadedImage);
-        vkDestroySampler(m_vulkanContext->device, sampler, nullptr);
+        m_vulkanContext->releaseSampler(sampler);
     }
 
     m_vulkanContext->destroyImage(m_offscreenImage);
@@ -0,0 +1,450 @@
+#include "TextureEncoder.h"
+
+#include "ThreadPool.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define VKE_ENCODER_SSE2
+#include <emmintrin.h>
+#endif
+
+static constexpr int BC7_WEIGHTS_4[16] = {0, 4, 9, 13, 17, 21, 26, 30, 34, 38, 43, 47, 51, 55, 60, 64};
+
+struct RgbaLevel {
+    uint32_t width;
+    uint32_t height;
+    std::vector<unsigned char> pixels;
+};
+
+static std::vector<RgbaLevel> buildMipChain(const unsigned char *rgba, uint32_t width, uint32_t height,
+                                            bool normalMap) {
+    std::vector<RgbaLevel> levels;
+    levels.push_back({width, height, std::vector<unsigned char>(rgba, rgba + size_t(width) * height * 4)});
+
+    while (levels.back().width > 1 || levels.back().height > 1) {
+        const RgbaLevel &src = levels.back();
+        RgbaLevel dst = {};
+        dst.width = std::max(src.width / 2, 1u);
+        dst.height = std::max(src.height / 2, 1u);
+        dst.pixels.resize(size_t(dst.width) * dst.height * 4);
+
+        for (uint32_t y = 0; y < dst.height; y++) {
+            for (uint32_t x = 0; x < dst.width; x++) {
+                // 2x2 box, clamped so odd and 1 pixel wide levels reuse the edge texel
+                uint32_t x0 = std::min(x * 2, src.width - 1);
+                uint32_t x1 = std::min(x * 2 + 1, src.width - 1);
+                uint32_t y0 = std::min(y * 2, src.height - 1);
+                uint32_t y1 = std::min(y * 2 + 1, src.height - 1);
+                const unsigned char *texels[4] = {
+                        &src.pixels[(size_t(y0) * src.width + x0) * 4],
+                        &src.pixels[(size_t(y0) * src.width + x1) * 4],
+                        &src.pixels[(size_t(y1) * src.width + x0) * 4],
+                        &src.pixels[(size_t(y1) * src.width + x1) * 4],
+                };
+                unsigned char *out = &dst.pixels[(size_t(y) * dst.width + x) * 4];
+
+                if (normalMap) {
+                    // average the decoded vectors and renormalize, averaging encoded values shortens normals
+                    float n[3] = {0.f, 0.f, 0.f};
+                    for (const unsigned char *texel: texels) {
+                        for (int c = 0; c < 3; c++) {
+                            n[c] += texel[c] / 255.f * 2.f - 1.f;
+                        }
+                    }
+                    float length = std::sqrt(n[0] * n[0] + n[1] * n[1] + n[2] * n[2]);
+                    if (length > 1e-6f) {
+                        for (float &component: n) {
+                            component /= length;
+                        }
+                    } else {
+                        n[0] = 0.f;
+                        n[1] = 0.f;
+                        n[2] = 1.f;
+                    }
+                    for (int c = 0; c < 3; c++) {
+                        out[c] = static_cast<unsigned char>(std::lround((n[c] * 0.5f + 0.5f) * 255.f));
+                    }
+                } else {
+                    for (int c = 0; c < 3; c++) {
+                        out[c] = static_cast<unsigned char>(
+                                (texels[0][c] + texels[1][c] + texels[2][c] + texels[3][c] + 2) / 4);
+                    }
+                }
+                out[3] = static_cast<unsigned char>((texels[0][3] + texels[1][3] + texels[2][3] + texels[3][3] + 2) / 4);
+            }
+        }
+
+        levels.push_back(std::move(dst));
+    }
+
+    return levels;
+}
+
+static void loadBlock(const RgbaLevel &level, uint32_t blockX, uint32_t blockY, float pixels[16][4]) {
+    for (uint32_t y = 0; y < 4; y++) {
+        for (uint32_t x = 0; x < 4; x++) {
+            uint32_t px = std::min(blockX * 4 + x, level.width - 1);
+            uint32_t py = std::min(blockY * 4 + y, level.height - 1);
+            const unsigned char *texel = &level.pixels[(size_t(py) * level.width + px) * 4];
+            for (int c = 0; c < 4; c++) {
+                pixels[y * 4 + x][c] = texel[c];
+            }
+        }
+    }
+}
+
+// bc7 mode 6: one subset, rgba endpoints with 7 bits + a shared p-bit each, 4 bit indices
+struct Bc7Mode6Endpoints {
+    int quantized[2][4];
+    int pBit[2];
+};
+
+static void quantizeEndpoint(const float endpoint[4], int quantized[4], int &pBit) {
+    float bestError = INFINITY;
+    for (int p = 0; p < 2; p++) {
+        int candidate[4];
+        float error = 0.f;
+        for (int c = 0; c < 4; c++) {
+            candidate[c] = std::clamp(static_cast<int>(std::lround((endpoint[c] - p) / 2.f)), 0, 127);
+            float diff = static_cast<float>((candidate[c] << 1) | p) - endpoint[c];
+            error += diff * diff;
+        }
+        if (error < bestError) {
+            bestError = error;
+            pBit = p;
+            memcpy(quantized, candidate, sizeof(candidate));
+        }
+    }
+}
+
+// picks the closest palette entry for every pixel, returns the summed squared error
+static float selectBc7Indices(const float pixels[16][4], const Bc7Mode6Endpoints &endpoints, uint8_t indices[16]) {
+    // palette laid out per channel so four entries are compared at once
+    alignas(16) float palette[4][16];
+    for (int c = 0; c < 4; c++) {
+        int e0 = (endpoints.quantized[0][c] << 1) | endpoints.pBit[0];
+        int e1 = (endpoints.quantized[1][c] << 1) | endpoints.pBit[1];
+        for (int i = 0; i < 16; i++) {
+            palette[c][i] = static_cast<float>(((64 - BC7_WEIGHTS_4[i]) * e0 + BC7_WEIGHTS_4[i] * e1 + 32) >> 6);
+        }
+    }
+
+    float totalError = 0.f;
+    for (int pixel_i = 0; pixel_i < 16; pixel_i++) {
+        alignas(16) float errors[16];
+
+#ifdef VKE_ENCODER_SSE2
+        __m128 r = _mm_set1_ps(pixels[pixel_i][0]);
+        __m128 g = _mm_set1_ps(pixels[pixel_i][1]);
+        __m128 b = _mm_set1_ps(pixels[pixel_i][2]);
+        __m128 a = _mm_set1_ps(pixels[pixel_i][3]);
+        for (int i = 0; i < 16; i += 4) {
+            __m128 dr = _mm_sub_ps(_mm_load_ps(&palette[0][i]), r);
+            __m128 dg = _mm_sub_ps(_mm_load_ps(&palette[1][i]), g);
+            __m128 db = _mm_sub_ps(_mm_load_ps(&palette[2][i]), b);
+            __m128 da = _mm_sub_ps(_mm_load_ps(&palette[3][i]), a);
+            __m128 error = _mm_add_ps(_mm_add_ps(_mm_mul_ps(dr, dr), _mm_mul_ps(dg, dg)),
+                                      _mm_add_ps(_mm_mul_ps(db, db), _mm_mul_ps(da, da)));
+            _mm_store_ps(&errors[i], error);
+        }
+#else
+        for (int i = 0; i < 16; i++) {
+            float error = 0.f;
+            for (int c = 0; c < 4; c++) {
+                float diff = palette[c][i] - pixels[pixel_i][c];
+                error += diff * diff;
+            }
+            errors[i] = error;
+        }
+#endif
+
+        int best = 0;
+        for (int i = 1; i < 16; i++) {
+            if (errors[i] < errors[best]) {
+                best = i;
+            }
+        }
+        indices[pixel_i] = static_cast<uint8_t>(best);
+        totalError += errors[best];
+    }
+
+    return totalError;
+}
+
+static float fitBc7Endpoints(const float pixels[16][4], const float e0[4], const float e1[4],
+                             Bc7Mode6Endpoints &endpoints, uint8_t indices[16]) {
+    float clamped0[4];
+    float clamped1[4];
+    for (int c = 0; c < 4; c++) {
+        clamped0[c] = std::clamp(e0[c], 0.f, 255.f);
+        clamped1[c] = std::clamp(e1[c], 0.f, 255.f);
+    }
+    quantizeEndpoint(clamped0, endpoints.quantized[0], endpoints.pBit[0]);
+    quantizeEndpoint(clamped1, endpoints.quantized[1], endpoints.pBit[1]);
+
+    return selectBc7Indices(pixels, endpoints, indices);
+}
+
+class BlockWriter {
+public:
+    explicit BlockWriter(std::byte *out) : m_out(out) {}
+
+    void write(uint32_t value, int bitCount) {
+        for (int bit_i = 0; bit_i < bitCount; bit_i++, m_bit++) {
+            if (value >> bit_i & 1) {
+                m_out[m_bit / 8] |= std::byte(1 << (m_bit % 8));
+            }
+        }
+    }
+
+private:
+    std::byte *m_out;
+    int m_bit = 0;
+};
+
+static void encodeBc7Block(const float pixels[16][4], std::byte *out) {
+    float mean[4] = {};
+    for (int pixel_i = 0; pixel_i < 16; pixel_i++) {
+        for (int c = 0; c < 4; c++) {
+            mean[c] += pixels[pixel_i][c] / 16.f;
+        }
+    }
+
+    float covariance[4][4] = {};
+    for (int pixel_i = 0; pixel_i < 16; pixel_i++) {
+        float d[4];
+        for (int c = 0; c < 4; c++) {
+            d[c] = pixels[pixel_i][c] - mean[c];
+        }
+        for (int i = 0; i < 4; i++) {
+            for (int j = 0; j < 4; j++) {
+                covariance[i][j] += d[i] * d[j];
+            }
+        }
+    }
+
+    // principal axis by power iteration
+    float axis[4] = {1.f, 1.f, 1.f, 1.f};
+    for (int iteration = 0; iteration < 8; iteration++) {
+        float next[4] = {};
+        for (int i = 0; i < 4; i++) {
+            for (int j = 0; j < 4; j++) {
+                next[i] += covariance[i][j] * axis[j];
+            }
+        }
+        float length = std::sqrt(next[0] * next[0] + next[1] * next[1] + next[2] * next[2] + next[3] * next[3]);
+        if (length < 1e-6f) {
+            break;
+        }
+        for (int c = 0; c < 4; c++) {
+            axis[c] = next[c] / length;
+        }
+    }
+
+    float minT = INFINITY;
+    float maxT = -INFINITY;
+    for (int pixel_i = 0; pixel_i < 16; pixel_i++) {
+        float t = 0.f;
+        for (int c = 0; c < 4; c++) {
+            t += (pixels[pixel_i][c] - mean[c]) * axis[c];
+        }
+        minT = std::min(minT, t);
+        maxT = std::max(maxT, t);
+    }
+
+    float e0[4];
+    float e1[4];
+    for (int c = 0; c < 4; c++) {
+        e0[c] = mean[c] + axis[c] * minT;
+        e1[c] = mean[c] + axis[c] * maxT;
+    }
+
+    Bc7Mode6Endpoints endpoints = {};
+    uint8_t indices[16];
+    float error = fitBc7Endpoints(pixels, e0, e1, endpoints, indices);
+
+    // least squares refit of the endpoints to the chosen indices, kept only if it helps
+    float sumAA = 0.f, sumAB = 0.f, sumBB = 0.f;
+    float sumAX[4] = {}, sumBX[4] = {};
+    for (int pixel_i = 0; pixel_i < 16; pixel_i++) {
+        float w = BC7_WEIGHTS_4[indices[pixel_i]] / 64.f;
+        float a = 1.f - w;
+        sumAA += a * a;
+        sumAB += a * w;
+        sumBB += w * w;
+        for (int c = 0; c < 4; c++) {
+            sumAX[c] += a * pixels[pixel_i][c];
+            sumBX[c] += w * pixels[pixel_i][c];
+        }
+    }
+    float determinant = sumAA * sumBB - sumAB * sumAB;
+    if (std::abs(determinant) > 1e-6f) {
+        float refit0[4];
+        float refit1[4];
+        for (int c = 0; c < 4; c++) {
+            refit0[c] = (sumBB * sumAX[c] - sumAB * sumBX[c]) / determinant;
+            refit1[c] = (sumAA * sumBX[c] - sumAB * sumAX[c]) / determinant;
+        }
+
+        Bc7Mode6Endpoints refitEndpoints = {};
+        uint8_t refitIndices[16];
+        float refitError = fitBc7Endpoints(pixels, refit0, refit1, refitEndpoints, refitIndices);
+        if (refitError < error) {
+            endpoints = refitEndpoints;
+            memcpy(indices, refitIndices, sizeof(refitIndices));
+        }
+    }
+
+    // the first index is stored without its top bit, swap the endpoints so it is clear
+    if (indices[0] & 8) {
+        std::swap(endpoints.quantized[0], endpoints.quantized[1]);
+        std::swap(endpoints.pBit[0], endpoints.pBit[1]);
+        for (uint8_t &index: indices) {
+            index = 15 - index;
+        }
+    }
+
+    memset(out, 0, 16);
+    BlockWriter writer(out);
+    writer.write(1 << 6, 7);
+    for (int c = 0; c < 4; c++) {
+        writer.write(endpoints.quantized[0][c], 7);
+        writer.write(endpoints.quantized[1][c], 7);
+    }
+    writer.write(endpoints.pBit[0], 1);
+    writer.write(endpoints.pBit[1], 1);
+    writer.write(indices[0], 3);
+    for (int pixel_i = 1; pixel_i < 16; pixel_i++) {
+        writer.write(indices[pixel_i], 4);
+    }
+}
+
+// 8 value mode: red_0 > red_1, six interpolated values in between
+static void encodeBc4Block(const float values[16], std::byte *out) {
+    float lowest = values[0];
+    float highest = values[0];
+    for (int i = 1; i < 16; i++) {
+        lowest = std::min(lowest, values[i]);
+        highest = std::max(highest, values[i]);
+    }
+
+    int e0 = static_cast<int>(std::lround(highest));
+    int e1 = static_cast<int>(std::lround(lowest));
+
+    memset(out, 0, 8);
+    out[0] = std::byte(e0);
+    out[1] = std::byte(e1);
+    if (e0 == e1) {
+        return;
+    }
+
+    float palette[8];
+    palette[0] = static_cast<float>(e0);
+    palette[1] = static_cast<float>(e1);
+    for (int i = 2; i < 8; i++) {
+        palette[i] = ((8 - i) * e0 + (i - 1) * e1) / 7.f;
+    }
+
+    BlockWriter writer(out + 2);
+    for (int i = 0; i < 16; i++) {
+        int best = 0;
+        for (int entry = 1; entry < 8; entry++) {
+            if (std::abs(palette[entry] - values[i]) < std::abs(palette[best] - values[i])) {
+                best = entry;
+            }
+        }
+        writer.write(best, 3);
+    }
+}
+
+static void encodeBlock(const float pixels[16][4], TextureEncoding encoding, std::byte *out) {
+    switch (encoding) {
+        case TextureEncoding::eColor: {
+            encodeBc7Block(pixels, out);
+            break;
+        }
+        case TextureEncoding::eNormal: {
+            float red[16];
+            float green[16];
+            for (int i = 0; i < 16; i++) {
+                red[i] = pixels[i][0];
+                green[i] = pixels[i][1];
+            }
+            encodeBc4Block(red, out);
+            encodeBc4Block(green, out + 8);
+            break;
+        }
+        case TextureEncoding::eSingleChannel: {
+            float red[16];
+            for (int i = 0; i < 16; i++) {
+                red[i] = pixels[i][0];
+            }
+            encodeBc4Block(red, out);
+            break;
+        }
+    }
+}
+
+EncodedTexture encodeTexture(const unsigned char *rgba, uint32_t width, uint32_t height, TextureEncoding encoding,
+                             ThreadPool *threadPool) {
+    EncodedTexture encoded = {};
+    encoded.extent = {width, height, 1};
+
+    size_t blockSize;
+    switch (encoding) {
+        case TextureEncoding::eColor:
+            encoded.format = VK_FORMAT_BC7_UNORM_BLOCK;
+            blockSize = 16;
+            break;
+        case TextureEncoding::eNormal:
+            encoded.format = VK_FORMAT_BC5_UNORM_BLOCK;
+            blockSize = 16;
+            break;
+        case TextureEncoding::eSingleChannel:
+        default:
+            encoded.format = VK_FORMAT_BC4_UNORM_BLOCK;
+            blockSize = 8;
+            break;
+    }
+
+    std::vector<RgbaLevel> mips = buildMipChain(rgba, width, height, encoding == TextureEncoding::eNormal);
+
+    size_t offset = 0;
+    for (const auto &mip: mips) {
+        ImageLevel level = {};
+        level.offset = offset;
+        level.size = size_t((mip.width + 3) / 4) * ((mip.height + 3) / 4) * blockSize;
+        level.extent = {mip.width, mip.height, 1};
+        encoded.levels.push_back(level);
+        offset += level.size;
+    }
+    encoded.data.resize(offset);
+
+    for (size_t level_i = 0; level_i < mips.size(); level_i++) {
+        const RgbaLevel &mip = mips[level_i];
+        uint32_t blocksX = (mip.width + 3) / 4;
+        uint32_t blocksY = (mip.height + 3) / 4;
+        std::byte *levelData = encoded.data.data() + encoded.levels[level_i].offset;
+
+        auto encodeRow = [&](size_t blockY) {
+            float pixels[16][4];
+            for (uint32_t blockX = 0; blockX < blocksX; blockX++) {
+                loadBlock(mip, blockX, static_cast<uint32_t>(blockY), pixels);
+                encodeBlock(pixels, encoding, levelData + (blockY * blocksX + blockX) * blockSize);
+            }
+        };
+
+        if (threadPool) {
+            threadPool->parallelFor(blocksY, encodeRow);
+        } else {
+            for (uint32_t blockY = 0; blockY < blocksY; blockY++) {
+                encodeRow(blockY);
+            }
+        }
+    }
+
+    return encoded;
+}
@@ -0,0 +1,362 @@
+#include "TextureFile.h"
+
+#include <algorithm>
+#include <cstring>
+#include <iostream>
+
+static constexpr unsigned char KTX2_IDENTIFIER[12] = {
+        0xAB, 'K', 'T', 'X', ' ', '2', '0', 0xBB, '\r', '\n', 0x1A, '\n'
+};
+static constexpr unsigned char DDS_MAGIC[4] = {'D', 'D', 'S', ' '};
+
+constexpr size_t KTX2_HEADER_SIZE = 80;
+constexpr size_t KTX2_LEVEL_INDEX_ENTRY_SIZE = 24;
+constexpr size_t KTX2_DFD_BLOCK_HEADER_SIZE = 24;
+constexpr size_t KTX2_DFD_SAMPLE_SIZE = 16;
+
+constexpr size_t DDS_HEADER_SIZE = 128; // magic included
+constexpr size_t DDS_DX10_HEADER_SIZE = 20;
+constexpr uint32_t DDS_CAPS2_CUBEMAP = 0x200;
+
+template<typename T>
+static T readValue(const std::byte *data, size_t offset) {
+    T value;
+    memcpy(&value, data + offset, sizeof(T));
+    return value;
+}
+
+template<typename T>
+static void writeValue(std::vector<std::byte> &data, size_t offset, T value) {
+    memcpy(data.data() + offset, &value, sizeof(T));
+}
+
+static constexpr uint32_t fourCC(char a, char b, char c, char d) {
+    return static_cast<uint32_t>(a) | static_cast<uint32_t>(b) << 8 |
+           static_cast<uint32_t>(c) << 16 | static_cast<uint32_t>(d) << 24;
+}
+
+// shaders convert base color to linear themselves, so srgb data is sampled through the unorm format
+static VkFormat toUnormFormat(VkFormat format) {
+    switch (format) {
+        case VK_FORMAT_BC1_RGB_SRGB_BLOCK:
+            return VK_FORMAT_BC1_RGB_UNORM_BLOCK;
+        case VK_FORMAT_BC1_RGBA_SRGB_BLOCK:
+            return VK_FORMAT_BC1_RGBA_UNORM_BLOCK;
+        case VK_FORMAT_BC3_SRGB_BLOCK:
+            return VK_FORMAT_BC3_UNORM_BLOCK;
+        case VK_FORMAT_BC7_SRGB_BLOCK:
+            return VK_FORMAT_BC7_UNORM_BLOCK;
+        default:
+            return format;
+    }
+}
+
+uint32_t blockCompressedBlockSize(VkFormat format) {
+    switch (format) {
+        case VK_FORMAT_BC1_RGB_UNORM_BLOCK:
+        case VK_FORMAT_BC1_RGB_SRGB_BLOCK:
+        case VK_FORMAT_BC1_RGBA_UNORM_BLOCK:
+        case VK_FORMAT_BC1_RGBA_SRGB_BLOCK:
+        case VK_FORMAT_BC4_UNORM_BLOCK:
+        case VK_FORMAT_BC4_SNORM_BLOCK:
+            return 8;
+        case VK_FORMAT_BC3_UNORM_BLOCK:
+        case VK_FORMAT_BC3_SRGB_BLOCK:
+        case VK_FORMAT_BC5_UNORM_BLOCK:
+        case VK_FORMAT_BC5_SNORM_BLOCK:
+        case VK_FORMAT_BC6H_UFLOAT_BLOCK:
+        case VK_FORMAT_BC6H_SFLOAT_BLOCK:
+        case VK_FORMAT_BC7_UNORM_BLOCK:
+        case VK_FORMAT_BC7_SRGB_BLOCK:
+            return 16;
+        default:
+            return 0;
+    }
+}
+
+static size_t levelSize(VkFormat format, VkExtent3D extent) {
+    size_t blocksX = (extent.width + 3) / 4;
+    size_t blocksY = (extent.height + 3) / 4;
+
+    return blocksX * blocksY * blockCompressedBlockSize(format);
+}
+
+static VkExtent3D levelExtent(VkExtent3D extent, uint32_t level) {
+    return {std::max(extent.width >> level, 1u), std::max(extent.height >> level, 1u), 1};
+}
+
+static VkFormat ddsFourCCFormat(uint32_t code) {
+    switch (code) {
+        case fourCC('D', 'X', 'T', '1'):
+            return VK_FORMAT_BC1_RGBA_UNORM_BLOCK;
+        case fourCC('D', 'X', 'T', '5'):
+            return VK_FORMAT_BC3_UNORM_BLOCK;
+        case fourCC('A', 'T', 'I', '1'):
+        case fourCC('B', 'C', '4', 'U'):
+            return VK_FORMAT_BC4_UNORM_BLOCK;
+        case fourCC('A', 'T', 'I', '2'):
+        case fourCC('B', 'C', '5', 'U'):
+            return VK_FORMAT_BC5_UNORM_BLOCK;
+        default:
+            return VK_FORMAT_UNDEFINED;
+    }
+}
+
+static VkFormat ddsDxgiFormat(uint32_t dxgiFormat) {
+    switch (dxgiFormat) {
+        case 71: // DXGI_FORMAT_BC1_UNORM
+            return VK_FORMAT_BC1_RGBA_UNORM_BLOCK;
+        case 72: // DXGI_FORMAT_BC1_UNORM_SRGB
+            return VK_FORMAT_BC1_RGBA_SRGB_BLOCK;
+        case 77: // DXGI_FORMAT_BC3_UNORM
+            return VK_FORMAT_BC3_UNORM_BLOCK;
+        case 78: // DXGI_FORMAT_BC3_UNORM_SRGB
+            return VK_FORMAT_BC3_SRGB_BLOCK;
+        case 80: // DXGI_FORMAT_BC4_UNORM
+            return VK_FORMAT_BC4_UNORM_BLOCK;
+        case 81: // DXGI_FORMAT_BC4_SNORM
+            return VK_FORMAT_BC4_SNORM_BLOCK;
+        case 83: // DXGI_FORMAT_BC5_UNORM
+            return VK_FORMAT_BC5_UNORM_BLOCK;
+        case 84: // DXGI_FORMAT_BC5_SNORM
+            return VK_FORMAT_BC5_SNORM_BLOCK;
+        case 95: // DXGI_FORMAT_BC6H_UF16
+            return VK_FORMAT_BC6H_UFLOAT_BLOCK;
+        case 96: // DXGI_FORMAT_BC6H_SF16
+            return VK_FORMAT_BC6H_SFLOAT_BLOCK;
+        case 98: // DXGI_FORMAT_BC7_UNORM
+            return VK_FORMAT_BC7_UNORM_BLOCK;
+        case 99: // DXGI_FORMAT_BC7_UNORM_SRGB
+            return VK_FORMAT_BC7_SRGB_BLOCK;
+        default:
+            return VK_FORMAT_UNDEFINED;
+    }
+}
+
+static std::optional<TextureFile> parseKtx2(const std::byte *data, size_t size) {
+    if (size < KTX2_HEADER_SIZE) {
+        std::cerr << "KTX2 file is truncated" << std::endl;
+        return std::nullopt;
+    }
+
+    auto vkFormat = static_cast<VkFormat>(readValue<uint32_t>(data, 12));
+    auto width = readValue<uint32_t>(data, 20);
+    auto height = readValue<uint32_t>(data, 24);
+    auto depth = readValue<uint32_t>(data, 28);
+    auto layerCount = readValue<uint32_t>(data, 32);
+    auto faceCount = readValue<uint32_t>(data, 36);
+    auto levelCount = std::max(readValue<uint32_t>(data, 40), 1u);
+    auto supercompressionScheme = readValue<uint32_t>(data, 44);
+
+    if (blockCompressedBlockSize(vkFormat) == 0) {
+        std::cerr << "KTX2 format " << vkFormat << " is not a supported block compressed format" << std::endl;
+        return std::nullopt;
+    }
+    if (supercompressionScheme != 0) {
+        std::cerr << "Supercompressed KTX2 files are not supported" << std::endl;
+        return std::nullopt;
+    }
+    if (width == 0 || height == 0 || depth > 1 || layerCount > 1 || faceCount != 1 || levelCount > 32) {
+        std::cerr << "Only single layer 2d KTX2 textures are supported" << std::endl;
+        return std::nullopt;
+    }
+    if (size < KTX2_HEADER_SIZE + levelCount * KTX2_LEVEL_INDEX_ENTRY_SIZE) {
+        std::cerr << "KTX2 level index is truncated" << std::endl;
+        return std::nullopt;
+    }
+
+    TextureFile texture = {};
+    texture.format = toUnormFormat(vkFormat);
+    texture.extent = {width, height, 1};
+    texture.data = data;
+    texture.size = size;
+
+    for (uint32_t level_i = 0; level_i < levelCount; level_i++) {
+        size_t entryOffset = KTX2_HEADER_SIZE + level_i * KTX2_LEVEL_INDEX_ENTRY_SIZE;
+        auto byteOffset = readValue<uint64_t>(data, entryOffset);
+        auto byteLength = readValue<uint64_t>(data, entryOffset + 8);
+
+        ImageLevel level = {};
+        level.offset = byteOffset;
+        level.size = byteLength;
+        level.extent = levelExtent(texture.extent, level_i);
+
+        if (byteOffset > size || byteLength > size - byteOffset ||
+            byteLength != levelSize(vkFormat, level.extent)) {
+            std::cerr << "KTX2 mip level " << level_i << " is out of bounds or has the wrong size" << std::endl;
+            return std::nullopt;
+        }
+
+        texture.levels.push_back(level);
+    }
+
+    return texture;
+}
+
+static std::optional<TextureFile> parseDds(const std::byte *data, size_t size) {
+    if (size < DDS_HEADER_SIZE) {
+        std::cerr << "DDS file is truncated" << std::endl;
+        return std::nullopt;
+    }
+
+    auto height = readValue<uint32_t>(data, 12);
+    auto width = readValue<uint32_t>(data, 16);
+    auto mipCount = std::max(readValue<uint32_t>(data, 28), 1u);
+    auto pixelFormatFourCC = readValue<uint32_t>(data, 84);
+    auto caps2 = readValue<uint32_t>(data, 112);
+
+    VkFormat format;
+    size_t dataOffset = DDS_HEADER_SIZE;
+    if (pixelFormatFourCC == fourCC('D', 'X', '1', '0')) {
+        if (size < DDS_HEADER_SIZE + DDS_DX10_HEADER_SIZE) {
+            std::cerr << "DDS DX10 header is truncated" << std::endl;
+            return std::nullopt;
+        }
+        format = ddsDxgiFormat(readValue<uint32_t>(data, DDS_HEADER_SIZE));
+        auto arraySize = readValue<uint32_t>(data, DDS_HEADER_SIZE + 12);
+        if (arraySize > 1) {
+            std::cerr << "DDS texture arrays are not supported" << std::endl;
+            return std::nullopt;
+        }
+        dataOffset += DDS_DX10_HEADER_SIZE;
+    } else {
+        format = ddsFourCCFormat(pixelFormatFourCC);
+    }
+
+    if (format == VK_FORMAT_UNDEFINED) {
+        std::cerr << "DDS pixel format is not a supported block compressed format" << std::endl;
+        return std::nullopt;
+    }
+    if (width == 0 || height == 0 || (caps2 & DDS_CAPS2_CUBEMAP) || mipCount > 32) {
+        std::cerr << "Only 2d DDS textures are supported" << std::endl;
+        return std::nullopt;
+    }
+
+    TextureFile texture = {};
+    texture.format = toUnormFormat(format);
+    texture.extent = {width, height, 1};
+    texture.data = data;
+    texture.size = size;
+
+    // dds levels are tightly packed after the header, largest first
+    size_t offset = dataOffset;
+    for (uint32_t level_i = 0; level_i < mipCount; level_i++) {
+        ImageLevel level = {};
+        level.offset = offset;
+        level.extent = levelExtent(texture.extent, level_i);
+        level.size = levelSize(format, level.extent);
+
+        if (level.size > size - offset) {
+            std::cerr << "DDS mip level " << level_i << " is truncated" << std::endl;
+            return std::nullopt;
+        }
+
+        texture.levels.push_back(level);
+        offset += level.size;
+    }
+
+    return texture;
+}
+
+bool isTextureContainer(const std::byte *data, size_t size) {
+    return (size >= sizeof(KTX2_IDENTIFIER) && memcmp(data, KTX2_IDENTIFIER, sizeof(KTX2_IDENTIFIER)) == 0) ||
+           (size >= sizeof(DDS_MAGIC) && memcmp(data, DDS_MAGIC, sizeof(DDS_MAGIC)) == 0);
+}
+
+std::optional<TextureFile> parseTextureFile(const std::byte *data, size_t size) {
+    if (size >= sizeof(KTX2_IDENTIFIER) && memcmp(data, KTX2_IDENTIFIER, sizeof(KTX2_IDENTIFIER)) == 0) {
+        return parseKtx2(data, size);
+    }
+    if (size >= sizeof(DDS_MAGIC) && memcmp(data, DDS_MAGIC, sizeof(DDS_MAGIC)) == 0) {
+        return parseDds(data, size);
+    }
+
+    return std::nullopt;
+}
+
+// khr data format color model and channel ids for the formats the encoder produces
+static uint8_t ktx2ColorModel(VkFormat format) {
+    switch (format) {
+        case VK_FORMAT_BC1_RGB_UNORM_BLOCK:
+        case VK_FORMAT_BC1_RGBA_UNORM_BLOCK:
+            return 128;
+        case VK_FORMAT_BC3_UNORM_BLOCK:
+            return 130;
+        case VK_FORMAT_BC4_UNORM_BLOCK:
+            return 131;
+        case VK_FORMAT_BC5_UNORM_BLOCK:
+            return 132;
+        case VK_FORMAT_BC6H_UFLOAT_BLOCK:
+            return 133;
+        default:
+            return 134; // bc7
+    }
+}
+
+std::vector<std::byte> serializeKtx2(VkFormat format, VkExtent3D extent, std::span<const ImageLevel> levels,
+                                    const std::byte *data) {
+    uint32_t blockSize = blockCompressedBlockSize(format);
+    uint32_t sampleCount = format == VK_FORMAT_BC5_UNORM_BLOCK ? 2 : 1;
+
+    size_t levelIndexSize = levels.size() * KTX2_LEVEL_INDEX_ENTRY_SIZE;
+    size_t dfdOffset = KTX2_HEADER_SIZE + levelIndexSize;
+    size_t dfdSize = 4 + KTX2_DFD_BLOCK_HEADER_SIZE + sampleCount * KTX2_DFD_SAMPLE_SIZE;
+
+    // levels are stored smallest first, each aligned to the block size
+    std::vector<size_t> levelOffsets(levels.size());
+    size_t fileSize = dfdOffset + dfdSize;
+    for (size_t level_i = levels.size(); level_i-- > 0;) {
+        fileSize = (fileSize + blockSize - 1) / blockSize * blockSize;
+        levelOffsets[level_i] = fileSize;
+        fileSize += levels[level_i].size;
+    }
+
+    std::vector<std::byte> file(fileSize);
+    memcpy(file.data(), KTX2_IDENTIFIER, sizeof(KTX2_IDENTIFIER));
+    writeValue<uint32_t>(file, 12, format);
+    writeValue<uint32_t>(file, 16, 1); // typeSize
+    writeValue<uint32_t>(file, 20, extent.width);
+    writeValue<uint32_t>(file, 24, extent.height);
+    writeValue<uint32_t>(file, 28, 0); // depth
+    writeValue<uint32_t>(file, 32, 0); // layerCount
+    writeValue<uint32_t>(file, 36, 1); // faceCount
+    writeValue<uint32_t>(file, 40, static_cast<uint32_t>(levels.size()));
+    writeValue<uint32_t>(file, 44, 0); // supercompressionScheme
+    writeValue<uint32_t>(file, 48, static_cast<uint32_t>(dfdOffset));
+    writeValue<uint32_t>(file, 52, static_cast<uint32_t>(dfdSize));
+
+    for (size_t level_i = 0; level_i < levels.size(); level_i++) {
+        size_t entryOffset = KTX2_HEADER_SIZE + level_i * KTX2_LEVEL_INDEX_ENTRY_SIZE;
+        writeValue<uint64_t>(file, entryOffset, levelOffsets[level_i]);
+        writeValue<uint64_t>(file, entryOffset + 8, levels[level_i].size);
+        writeValue<uint64_t>(file, entryOffset + 16, levels[level_i].size);
+        memcpy(file.data() + levelOffsets[level_i], data + levels[level_i].offset, levels[level_i].size);
+    }
+
+    // basic data format descriptor: linear transfer, bt709 primaries, 4x4 blocks
+    size_t blockOffset = dfdOffset + 4;
+    writeValue<uint32_t>(file, dfdOffset, static_cast<uint32_t>(dfdSize));
+    writeValue<uint32_t>(file, blockOffset, 0); // khronos vendor, basic descriptor type
+    writeValue<uint16_t>(file, blockOffset + 4, 2); // version
+    writeValue<uint16_t>(file, blockOffset + 6,
+                         static_cast<uint16_t>(KTX2_DFD_BLOCK_HEADER_SIZE + sampleCount * KTX2_DFD_SAMPLE_SIZE));
+    writeValue<uint8_t>(file, blockOffset + 8, ktx2ColorModel(format));
+    writeValue<uint8_t>(file, blockOffset + 9, 1); // primaries
+    writeValue<uint8_t>(file, blockOffset + 10, 1); // transfer
+    writeValue<uint8_t>(file, blockOffset + 11, 0); // flags
+    writeValue<uint8_t>(file, blockOffset + 12, 3); // texel block 4x4
+    writeValue<uint8_t>(file, blockOffset + 13, 3);
+    writeValue<uint8_t>(file, blockOffset + 16, static_cast<uint8_t>(blockSize));
+
+    uint32_t sampleBits = blockSize * 8 / sampleCount;
+    for (uint32_t sample_i = 0; sample_i < sampleCount; sample_i++) {
+        size_t sampleOffset = blockOffset + KTX2_DFD_BLOCK_HEADER_SIZE + sample_i * KTX2_DFD_SAMPLE_SIZE;
+        writeValue<uint16_t>(file, sampleOffset, static_cast<uint16_t>(sample_i * sampleBits));
+        writeValue<uint8_t>(file, sampleOffset + 2, static_cast<uint8_t>(sampleBits - 1));
+        writeValue<uint8_t>(file, sampleOffset + 3, static_cast<uint8_t>(sample_i)); // channel id
+        writeValue<uint32_t>(file, sampleOffset + 8, 0);
+        writeValue<uint32_t>(file, sampleOffset + 12, UINT32_MAX);
+    }
+
+    return file;
+}
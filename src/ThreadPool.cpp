@@ -0,0 +1,95 @@
+#include "ThreadPool.h"
+
+#include <algorithm>
+#include <atomic>
+
+ThreadPool::ThreadPool(uint32_t threadCount) {
+    threadCount = std::max(threadCount, 1u);
+
+    m_workers.reserve(threadCount);
+    for (uint32_t thread_i = 0; thread_i < threadCount; thread_i++) {
+        m_workers.emplace_back(&ThreadPool::workerLoop, this);
+    }
+}
+
+ThreadPool::~ThreadPool() {
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_stopping = true;
+    }
+    m_condition.notify_all();
+
+    for (auto &worker: m_workers) {
+        worker.join();
+    }
+}
+
+uint32_t ThreadPool::threadCount() const {
+    return static_cast<uint32_t>(m_workers.size());
+}
+
+void ThreadPool::workerLoop() {
+    while (true) {
+        std::function<void()> task;
+
+        {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            m_condition.wait(lock, [this]() { return m_stopping || !m_tasks.empty(); });
+
+            if (m_stopping && m_tasks.empty()) {
+                return;
+            }
+
+            task = std::move(m_tasks.front());
+            m_tasks.pop();
+        }
+
+        task();
+    }
+}
+
+void ThreadPool::parallelFor(size_t count, const std::function<void(size_t)> &func) {
+    if (count == 0) {
+        return;
+    }
+
+    if (count == 1) {
+        func(0);
+        return;
+    }
+
+    struct ParallelForState {
+        std::atomic<size_t> next = 0;
+        std::atomic<size_t> completed = 0;
+        std::mutex mutex;
+        std::condition_variable done;
+    };
+
+    // helpers that only get scheduled after the range is exhausted exit without touching func
+    auto state = std::make_shared<ParallelForState>();
+    auto work = [state, count, &func]() {
+        size_t index;
+        while ((index = state->next.fetch_add(1)) < count) {
+            func(index);
+
+            if (state->completed.fetch_add(1) + 1 == count) {
+                std::lock_guard<std::mutex> lock(state->mutex);
+                state->done.notify_all();
+            }
+        }
+    };
+
+    size_t helperCount = std::min(m_workers.size(), count - 1);
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        for (size_t helper_i = 0; helper_i < helperCount; helper_i++) {
+            m_tasks.emplace(work);
+        }
+    }
+    m_condition.notify_all();
+
+    work();
+
+    std::unique_lock<std::mutex> lock(state->mutex);
+    state->done.wait(lock, [&state, count]() { return state->completed.load() == count; });
+}
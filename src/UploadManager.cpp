@@ -0,0 +1,492 @@
+#include "UploadManager.h"
+
+#include "VulkanContext.h"
+#include "VulkanInit.h"
+#include "VulkanUtils.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+
+// keeps every staging offset valid for buffer to image copies of any format we upload
+constexpr size_t STAGING_ALIGNMENT = 16;
+
+// how long an upload waits for another thread to flush the oldest ring region before staging on its own
+constexpr auto STAGING_WAIT_TIMEOUT = std::chrono::milliseconds(50);
+
+// flags the thread contexts of the calling thread as exited when it ends, collect() frees them afterwards
+struct ThreadExitFlags {
+    std::vector<std::shared_ptr<std::atomic<bool>>> flags;
+
+    ~ThreadExitFlags() {
+        for (auto &flag: flags) {
+            *flag = true;
+        }
+    }
+};
+
+static thread_local ThreadExitFlags threadExitFlags;
+
+static size_t alignUp(size_t value, size_t alignment) {
+    return (value + alignment - 1) & ~(alignment - 1);
+}
+
+void UploadManager::init(VulkanContext *vulkanContext, size_t stagingSize) {
+    m_vulkanContext = vulkanContext;
+    m_stagingSize = stagingSize;
+
+    m_stagingRing = m_vulkanContext->createBuffer(m_stagingSize, VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+                                                  VMA_ALLOCATION_CREATE_MAPPED_BIT |
+                                                  VMA_ALLOCATION_CREATE_HOST_ACCESS_SEQUENTIAL_WRITE_BIT);
+
+    VkSemaphoreTypeCreateInfo timelineInfo = {};
+    timelineInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_TYPE_CREATE_INFO;
+    timelineInfo.semaphoreType = VK_SEMAPHORE_TYPE_TIMELINE;
+    timelineInfo.initialValue = 0;
+
+    VkSemaphoreCreateInfo semaphoreInfo = VkInit::semaphoreCreateInfo();
+    semaphoreInfo.pNext = &timelineInfo;
+
+    VK_CHECK(vkCreateSemaphore(m_vulkanContext->device, &semaphoreInfo, nullptr, &m_timelineSemaphore))
+}
+
+void UploadManager::terminate() {
+    VkDevice device = m_vulkanContext->device;
+
+    for (auto &[threadId, context]: m_threadContexts) {
+        if (context->commandBuffer != VK_NULL_HANDLE) {
+            std::cerr << "Upload batch recorded but never flushed, discarding" << std::endl;
+        }
+        for (auto &buffer: context->dedicatedBuffers) {
+            m_vulkanContext->destroyBuffer(buffer);
+        }
+        // frees all command buffers allocated from it
+        vkDestroyCommandPool(device, context->commandPool, nullptr);
+    }
+    m_threadContexts.clear();
+
+    for (auto &[value, buffer]: m_retiringBuffers) {
+        m_vulkanContext->destroyBuffer(buffer);
+    }
+    m_retiringBuffers.clear();
+    m_ringRegions.clear();
+
+    m_vulkanContext->destroyBuffer(m_stagingRing);
+    vkDestroySemaphore(device, m_timelineSemaphore, nullptr);
+}
+
+UploadManager::ThreadContext &UploadManager::getThreadContext() {
+    std::lock_guard<std::mutex> lock(m_threadContextMutex);
+
+    auto &context = m_threadContexts[std::this_thread::get_id()];
+    if (!context) {
+        context = std::make_unique<ThreadContext>();
+
+        VkCommandPoolCreateInfo commandPoolInfo = {};
+        commandPoolInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+        commandPoolInfo.flags = VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT |
+                                VK_COMMAND_POOL_CREATE_TRANSIENT_BIT;
+        commandPoolInfo.queueFamilyIndex = m_vulkanContext->graphicsFamily;
+
+        VK_CHECK(vkCreateCommandPool(m_vulkanContext->device, &commandPoolInfo, nullptr, &context->commandPool))
+    }
+
+    // first use by this thread. it may have been given the id of an exited thread whose context isn't freed yet
+    if (!context->threadExited || *context->threadExited) {
+        context->threadExited = std::make_shared<std::atomic<bool>>(false);
+        threadExitFlags.flags.push_back(context->threadExited);
+    }
+
+    return *context;
+}
+
+VkCommandBuffer UploadManager::beginBatch(ThreadContext &context) {
+    if (context.commandBuffer != VK_NULL_HANDLE) {
+        return context.commandBuffer;
+    }
+
+    uint64_t completed = completedValue();
+    while (!context.submittedCommandBuffers.empty() && context.submittedCommandBuffers.front().first <= completed) {
+        context.freeCommandBuffers.push_back(context.submittedCommandBuffers.front().second);
+        context.submittedCommandBuffers.pop_front();
+    }
+
+    VkCommandBuffer cmd;
+    if (context.freeCommandBuffers.empty()) {
+        VkCommandBufferAllocateInfo allocInfo = VkInit::commandBufferAllocateInfo(context.commandPool, 1);
+        VK_CHECK(vkAllocateCommandBuffers(m_vulkanContext->device, &allocInfo, &cmd))
+    } else {
+        cmd = context.freeCommandBuffers.back();
+        context.freeCommandBuffers.pop_back();
+        VK_CHECK(vkResetCommandBuffer(cmd, 0))
+    }
+
+    VkCommandBufferBeginInfo beginInfo = VkInit::commandBufferBeginInfo(VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT);
+    VK_CHECK(vkBeginCommandBuffer(cmd, &beginInfo))
+
+    context.commandBuffer = cmd;
+
+    return cmd;
+}
+
+bool UploadManager::tryAllocateFromRing(size_t size, size_t &offset) const {
+    if (m_ringRegions.empty()) {
+        offset = 0;
+        return size <= m_stagingSize;
+    }
+
+    size_t head = alignUp(m_ringRegions.back().end, STAGING_ALIGNMENT);
+    size_t tail = m_ringRegions.front().begin;
+
+    // the newest region starting before the oldest one means the ring has wrapped and only [head, tail) is free
+    bool wrapped = m_ringRegions.back().begin < tail;
+    if (wrapped) {
+        offset = head;
+        return head + size <= tail;
+    }
+
+    if (head + size <= m_stagingSize) {
+        offset = head;
+        return true;
+    }
+
+    offset = 0;
+    return size <= tail;
+}
+
+void UploadManager::retireRegions(uint64_t completed) {
+    while (!m_ringRegions.empty() &&
+           m_ringRegions.front().retireValue != 0 &&
+           m_ringRegions.front().retireValue <= completed) {
+        m_ringRegions.pop_front();
+        m_frontRegionId++;
+    }
+
+    std::erase_if(m_retiringBuffers, [this, completed](const std::pair<uint64_t, VulkanBuffer> &retiring) {
+        if (retiring.first <= completed) {
+            m_vulkanContext->destroyBuffer(retiring.second);
+            return true;
+        }
+        return false;
+    });
+}
+
+void UploadManager::releaseExitedThreads(uint64_t completed) {
+    std::lock_guard<std::mutex> lock(m_threadContextMutex);
+
+    std::erase_if(m_threadContexts, [this, completed](const auto &entry) {
+        const ThreadContext &context = *entry.second;
+        // a batch left unflushed is reported and dropped by terminate()
+        if (!*context.threadExited || context.commandBuffer != VK_NULL_HANDLE ||
+            context.lastSubmittedValue > completed) {
+            return false;
+        }
+
+        // frees all command buffers allocated from it
+        vkDestroyCommandPool(m_vulkanContext->device, context.commandPool, nullptr);
+        return true;
+    });
+}
+
+UploadManager::StagingAllocation UploadManager::allocateDedicatedStaging(ThreadContext &context, size_t size) {
+    VulkanBuffer buffer = m_vulkanContext->createBuffer(size, VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+                                                        VMA_ALLOCATION_CREATE_MAPPED_BIT |
+                                                        VMA_ALLOCATION_CREATE_HOST_ACCESS_SEQUENTIAL_WRITE_BIT);
+    context.dedicatedBuffers.push_back(buffer);
+
+    return {buffer.buffer, 0, buffer.info.pMappedData};
+}
+
+UploadManager::StagingAllocation UploadManager::allocateStaging(ThreadContext &context, size_t size) {
+    // large uploads would stall the ring for everyone else, give them their own staging buffer
+    if (size > m_stagingSize / 4) {
+        return allocateDedicatedStaging(context, size);
+    }
+
+    std::unique_lock<std::mutex> lock(m_ringMutex);
+
+    size_t offset;
+    while (!tryAllocateFromRing(size, offset)) {
+        // ring is full. submit our own batch so its regions can retire, then wait for the oldest one
+        lock.unlock();
+        if (context.commandBuffer != VK_NULL_HANDLE) {
+            flush();
+        }
+        lock.lock();
+
+        retireRegions(completedValue());
+        if (tryAllocateFromRing(size, offset)) {
+            break;
+        }
+
+        uint64_t oldestValue = m_ringRegions.front().retireValue;
+        if (oldestValue != 0) {
+            lock.unlock();
+            wait(oldestValue);
+            lock.lock();
+        } else {
+            // oldest region belongs to a batch another thread is still recording. that thread may be waiting on
+            // the ring too, so rather than wait for its flush indefinitely, stage this upload on its own
+            bool flushed = m_ringCondition.wait_for(lock, STAGING_WAIT_TIMEOUT, [this]() {
+                return m_ringRegions.empty() || m_ringRegions.front().retireValue != 0;
+            });
+            if (!flushed) {
+                lock.unlock();
+                return allocateDedicatedStaging(context, size);
+            }
+        }
+
+        retireRegions(completedValue());
+    }
+
+    context.regionIds.push_back(m_frontRegionId + m_ringRegions.size());
+    m_ringRegions.push_back({offset, offset + size, 0});
+
+    return {m_stagingRing.buffer, offset, static_cast<std::byte *>(m_stagingRing.info.pMappedData) + offset};
+}
+
+void UploadManager::uploadBuffer(VkBuffer dst, size_t dstOffset, const void *data, size_t size) {
+    if (size == 0) {
+        return;
+    }
+
+    ThreadContext &context = getThreadContext();
+
+    StagingAllocation staging = allocateStaging(context, size);
+    memcpy(staging.mapped, data, size);
+
+    VkCommandBuffer cmd = beginBatch(context);
+
+    VkBufferCopy copy = {};
+    copy.srcOffset = staging.offset;
+    copy.dstOffset = dstOffset;
+    copy.size = size;
+
+    vkCmdCopyBuffer(cmd, staging.buffer, dst, 1, &copy);
+}
+
+void UploadManager::copyBuffer(VkBuffer src, VkBuffer dst, size_t size) {
+    if (size == 0) {
+        return;
+    }
+
+    ThreadContext &context = getThreadContext();
+    VkCommandBuffer cmd = beginBatch(context);
+
+    // uploads earlier in the batch may still be writing src
+    VkMemoryBarrier2 barrier = {};
+    barrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER_2;
+    barrier.srcStageMask = VK_PIPELINE_STAGE_2_ALL_TRANSFER_BIT;
+    barrier.srcAccessMask = VK_ACCESS_2_TRANSFER_WRITE_BIT;
+    barrier.dstStageMask = VK_PIPELINE_STAGE_2_ALL_TRANSFER_BIT;
+    barrier.dstAccessMask = VK_ACCESS_2_TRANSFER_READ_BIT;
+
+    VkDependencyInfo dependencyInfo = {};
+    dependencyInfo.sType = VK_STRUCTURE_TYPE_DEPENDENCY_INFO;
+    dependencyInfo.memoryBarrierCount = 1;
+    dependencyInfo.pMemoryBarriers = &barrier;
+
+    vkCmdPipelineBarrier2(cmd, &dependencyInfo);
+
+    VkBufferCopy copy = {};
+    copy.srcOffset = 0;
+    copy.dstOffset = 0;
+    copy.size = size;
+
+    vkCmdCopyBuffer(cmd, src, dst, 1, &copy);
+
+    // uploads later in the batch may write into the copied range of dst, e.g. an arena reusing a freed range
+    // after growing. without this they could land before the copy and be overwritten by the old contents
+    VkMemoryBarrier2 copyBarrier = {};
+    copyBarrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER_2;
+    copyBarrier.srcStageMask = VK_PIPELINE_STAGE_2_ALL_TRANSFER_BIT;
+    copyBarrier.srcAccessMask = VK_ACCESS_2_TRANSFER_WRITE_BIT;
+    copyBarrier.dstStageMask = VK_PIPELINE_STAGE_2_ALL_TRANSFER_BIT;
+    copyBarrier.dstAccessMask = VK_ACCESS_2_TRANSFER_WRITE_BIT;
+
+    dependencyInfo.pMemoryBarriers = &copyBarrier;
+
+    vkCmdPipelineBarrier2(cmd, &dependencyInfo);
+}
+
+void UploadManager::uploadImage(const VulkanImage &image, const void *data, size_t size, bool generateMipmaps) {
+    ThreadContext &context = getThreadContext();
+
+    StagingAllocation staging = allocateStaging(context, size);
+    memcpy(staging.mapped, data, size);
+
+    VkCommandBuffer cmd = beginBatch(context);
+
+    VkUtil::transitionImage(cmd, image.image, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+                            VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT,
+                            0,
+                            VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT,
+                            VK_ACCESS_2_MEMORY_WRITE_BIT | VK_ACCESS_2_MEMORY_READ_BIT);
+
+    VkBufferImageCopy copyRegion = {};
+    copyRegion.bufferOffset = staging.offset;
+    copyRegion.bufferRowLength = 0;
+    copyRegion.bufferImageHeight = 0;
+
+    copyRegion.imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+    copyRegion.imageSubresource.mipLevel = 0;
+    copyRegion.imageSubresource.baseArrayLayer = 0;
+    copyRegion.imageSubresource.layerCount = 1;
+    copyRegion.imageExtent = image.imageExtent;
+
+    vkCmdCopyBufferToImage(cmd, staging.buffer, image.image,
+                           VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &copyRegion);
+
+    if (generateMipmaps) {
+        VkUtil::generateMipmaps(cmd, image.image, {image.imageExtent.width, image.imageExtent.height});
+    } else {
+        VkUtil::transitionImage(cmd, image.image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+                                VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
+                                VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT,
+                                VK_ACCESS_2_MEMORY_WRITE_BIT | VK_ACCESS_2_MEMORY_READ_BIT,
+                                VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT,
+                                VK_ACCESS_2_MEMORY_WRITE_BIT | VK_ACCESS_2_MEMORY_READ_BIT);
+    }
+}
+
+void UploadManager::uploadImage(const VulkanImage &image, const void *data, size_t size,
+                                std::span<const ImageLevel> levels) {
+    ThreadContext &context = getThreadContext();
+
+    // only stage the level payload, container headers would break the block alignment of the copy offsets
+    size_t rangeBegin = size;
+    size_t rangeEnd = 0;
+    for (const auto &level: levels) {
+        rangeBegin = std::min(rangeBegin, level.offset);
+        rangeEnd = std::max(rangeEnd, level.offset + level.size);
+    }
+
+    StagingAllocation staging = allocateStaging(context, rangeEnd - rangeBegin);
+    memcpy(staging.mapped, static_cast<const std::byte *>(data) + rangeBegin, rangeEnd - rangeBegin);
+
+    VkCommandBuffer cmd = beginBatch(context);
+
+    VkUtil::transitionImage(cmd, image.image, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+                            VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT,
+                            0,
+                            VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT,
+                            VK_ACCESS_2_MEMORY_WRITE_BIT | VK_ACCESS_2_MEMORY_READ_BIT);
+
+    std::vector<VkBufferImageCopy> copyRegions;
+    for (size_t level_i = 0; level_i < levels.size(); level_i++) {
+        VkBufferImageCopy copyRegion = {};
+        copyRegion.bufferOffset = staging.offset + levels[level_i].offset - rangeBegin;
+
+        copyRegion.imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+        copyRegion.imageSubresource.mipLevel = static_cast<uint32_t>(level_i);
+        copyRegion.imageSubresource.baseArrayLayer = 0;
+        copyRegion.imageSubresource.layerCount = 1;
+        copyRegion.imageExtent = levels[level_i].extent;
+
+        copyRegions.push_back(copyRegion);
+    }
+
+    vkCmdCopyBufferToImage(cmd, staging.buffer, image.image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+                           static_cast<uint32_t>(copyRegions.size()), copyRegions.data());
+
+    VkUtil::transitionImage(cmd, image.image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+                            VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
+                            VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT,
+                            VK_ACCESS_2_MEMORY_WRITE_BIT | VK_ACCESS_2_MEMORY_READ_BIT,
+                            VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT,
+                            VK_ACCESS_2_MEMORY_WRITE_BIT | VK_ACCESS_2_MEMORY_READ_BIT);
+}
+
+uint64_t UploadManager::flush() {
+    ThreadContext &context = getThreadContext();
+
+    if (context.commandBuffer == VK_NULL_HANDLE) {
+        return context.lastSubmittedValue;
+    }
+
+    // make the copies visible to whatever reads the data in later submissions
+    VkMemoryBarrier2 barrier = {};
+    barrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER_2;
+    barrier.srcStageMask = VK_PIPELINE_STAGE_2_ALL_TRANSFER_BIT;
+    barrier.srcAccessMask = VK_ACCESS_2_TRANSFER_WRITE_BIT;
+    barrier.dstStageMask = VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT;
+    barrier.dstAccessMask = VK_ACCESS_2_MEMORY_READ_BIT;
+
+    VkDependencyInfo dependencyInfo = {};
+    dependencyInfo.sType = VK_STRUCTURE_TYPE_DEPENDENCY_INFO;
+    dependencyInfo.memoryBarrierCount = 1;
+    dependencyInfo.pMemoryBarriers = &barrier;
+
+    vkCmdPipelineBarrier2(context.commandBuffer, &dependencyInfo);
+
+    VK_CHECK(vkEndCommandBuffer(context.commandBuffer))
+
+    uint64_t value;
+    {
+        // values have to be signaled in increasing order, so pick the value and submit under the same lock
+        std::lock_guard<std::mutex> queueLock(m_vulkanContext->queueMutex);
+        value = ++m_lastSubmittedValue;
+
+        VkCommandBufferSubmitInfo cmdSubmitInfo = VkInit::commandBufferSubmitInfo(context.commandBuffer);
+        VkSemaphoreSubmitInfo signalInfo = VkInit::semaphoreSubmitInfo(VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT,
+                                                                       m_timelineSemaphore);
+        signalInfo.value = value;
+
+        VkSubmitInfo2 submitInfo = VkInit::submitInfo(&cmdSubmitInfo, &signalInfo, nullptr);
+        VK_CHECK(vkQueueSubmit2(m_vulkanContext->graphicsQueue, 1, &submitInfo, VK_NULL_HANDLE))
+    }
+
+    {
+        std::lock_guard<std::mutex> ringLock(m_ringMutex);
+        for (uint64_t regionId: context.regionIds) {
+            m_ringRegions[regionId - m_frontRegionId].retireValue = value;
+        }
+        for (auto &buffer: context.dedicatedBuffers) {
+            m_retiringBuffers.emplace_back(value, buffer);
+        }
+    }
+    m_ringCondition.notify_all();
+    context.regionIds.clear();
+    context.dedicatedBuffers.clear();
+
+    context.submittedCommandBuffers.emplace_back(value, context.commandBuffer);
+    context.commandBuffer = VK_NULL_HANDLE;
+    context.lastSubmittedValue = value;
+
+    return value;
+}
+
+uint64_t UploadManager::completedValue() const {
+    uint64_t value = 0;
+    VK_CHECK(vkGetSemaphoreCounterValue(m_vulkanContext->device, m_timelineSemaphore, &value))
+
+    return value;
+}
+
+bool UploadManager::isComplete(uint64_t value) const {
+    return completedValue() >= value;
+}
+
+void UploadManager::wait(uint64_t value) const {
+    if (value == 0) {
+        return;
+    }
+
+    VkSemaphoreWaitInfo waitInfo = {};
+    waitInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_WAIT_INFO;
+    waitInfo.semaphoreCount = 1;
+    waitInfo.pSemaphores = &m_timelineSemaphore;
+    waitInfo.pValues = &value;
+
+    VK_CHECK(vkWaitSemaphores(m_vulkanContext->device, &waitInfo, UINT64_MAX))
+}
+
+void UploadManager::collect() {
+    uint64_t completed = completedValue();
+    {
+        std::lock_guard<std::mutex> lock(m_ringMutex);
+        retireRegions(completed);
+    }
+
+    releaseExitedThreads(completed);
+}
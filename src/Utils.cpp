@@ -1,6 +1,22 @@
 #include "Utils.h"
 
 #include <fstream>
+#include <bit>
+#include <cstring>
+#include <utility>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#include <psapi.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/resource.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
 
 std::vector<char> readFile(std::filesystem::path fileName, bool isBinary) {
     std::filesystem::path shaderPath = std::filesystem::current_path();
@@ -34,3 +50,204 @@ std::vector<char> readFile(std::filesystem::path fileName, bool isBinary) {
 
     return buffer;
 }
+
+MappedFile::MappedFile(const std::filesystem::path &path) {
+#ifdef _WIN32
+    HANDLE file = CreateFileW(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING,
+                              FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (file == INVALID_HANDLE_VALUE) {
+        return;
+    }
+
+    LARGE_INTEGER fileSize;
+    if (!GetFileSizeEx(file, &fileSize) || fileSize.QuadPart == 0) {
+        CloseHandle(file);
+        return;
+    }
+
+    HANDLE mapping = CreateFileMappingW(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    if (!mapping) {
+        CloseHandle(file);
+        return;
+    }
+
+    void *data = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+    if (!data) {
+        CloseHandle(mapping);
+        CloseHandle(file);
+        return;
+    }
+
+    m_fileHandle = file;
+    m_mappingHandle = mapping;
+    m_data = data;
+    m_size = static_cast<size_t>(fileSize.QuadPart);
+#else
+    int fd = open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+        return;
+    }
+
+    struct stat fileStat = {};
+    if (fstat(fd, &fileStat) != 0 || fileStat.st_size == 0) {
+        ::close(fd);
+        return;
+    }
+
+    void *data = mmap(nullptr, static_cast<size_t>(fileStat.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+    // the mapping keeps its own reference to the file
+    ::close(fd);
+    if (data == MAP_FAILED) {
+        return;
+    }
+
+    m_data = data;
+    m_size = static_cast<size_t>(fileStat.st_size);
+#endif
+}
+
+MappedFile::~MappedFile() {
+    close();
+}
+
+MappedFile::MappedFile(MappedFile &&other) noexcept {
+    *this = std::move(other);
+}
+
+MappedFile &MappedFile::operator=(MappedFile &&other) noexcept {
+    if (this != &other) {
+        close();
+        m_data = std::exchange(other.m_data, nullptr);
+        m_size = std::exchange(other.m_size, 0);
+#ifdef _WIN32
+        m_fileHandle = std::exchange(other.m_fileHandle, nullptr);
+        m_mappingHandle = std::exchange(other.m_mappingHandle, nullptr);
+#endif
+    }
+    return *this;
+}
+
+void MappedFile::close() {
+    if (!m_data) {
+        return;
+    }
+
+#ifdef _WIN32
+    UnmapViewOfFile(m_data);
+    CloseHandle(m_mappingHandle);
+    CloseHandle(m_fileHandle);
+    m_fileHandle = nullptr;
+    m_mappingHandle = nullptr;
+#else
+    munmap(m_data, m_size);
+#endif
+    m_data = nullptr;
+    m_size = 0;
+}
+
+size_t peakResidentSetSize() {
+#ifdef _WIN32
+    PROCESS_MEMORY_COUNTERS counters = {};
+    if (GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters))) {
+        return counters.PeakWorkingSetSize;
+    }
+    return 0;
+#else
+    struct rusage usage = {};
+    if (getrusage(RUSAGE_SELF, &usage) != 0) {
+        return 0;
+    }
+#ifdef __APPLE__
+    return static_cast<size_t>(usage.ru_maxrss);
+#else
+    return static_cast<size_t>(usage.ru_maxrss) * 1024;
+#endif
+#endif
+}
+
+static constexpr uint64_t XXH_PRIME_1 = 11400714785074694791ULL;
+static constexpr uint64_t XXH_PRIME_2 = 14029467366897019727ULL;
+static constexpr uint64_t XXH_PRIME_3 = 1609587929392839161ULL;
+static constexpr uint64_t XXH_PRIME_4 = 9650029242287828579ULL;
+static constexpr uint64_t XXH_PRIME_5 = 2870177450012600261ULL;
+
+static uint64_t xxhRound(uint64_t acc, uint64_t input) {
+    acc += input * XXH_PRIME_2;
+    acc = std::rotl(acc, 31);
+    return acc * XXH_PRIME_1;
+}
+
+static uint64_t xxhMergeRound(uint64_t acc, uint64_t value) {
+    acc ^= xxhRound(0, value);
+    return acc * XXH_PRIME_1 + XXH_PRIME_4;
+}
+
+static uint64_t read64(const unsigned char *bytes) {
+    uint64_t value;
+    memcpy(&value, bytes, sizeof(value));
+    return value;
+}
+
+static uint32_t read32(const unsigned char *bytes) {
+    uint32_t value;
+    memcpy(&value, bytes, sizeof(value));
+    return value;
+}
+
+uint64_t hashBytes(const void *data, size_t size, uint64_t seed) {
+    const auto *bytes = static_cast<const unsigned char *>(data);
+    const unsigned char *end = bytes + size;
+    uint64_t hash;
+
+    if (size >= 32) {
+        uint64_t v1 = seed + XXH_PRIME_1 + XXH_PRIME_2;
+        uint64_t v2 = seed + XXH_PRIME_2;
+        uint64_t v3 = seed;
+        uint64_t v4 = seed - XXH_PRIME_1;
+
+        const unsigned char *limit = end - 32;
+        do {
+            v1 = xxhRound(v1, read64(bytes));
+            v2 = xxhRound(v2, read64(bytes + 8));
+            v3 = xxhRound(v3, read64(bytes + 16));
+            v4 = xxhRound(v4, read64(bytes + 24));
+            bytes += 32;
+        } while (bytes <= limit);
+
+        hash = std::rotl(v1, 1) + std::rotl(v2, 7) + std::rotl(v3, 12) + std::rotl(v4, 18);
+        hash = xxhMergeRound(hash, v1);
+        hash = xxhMergeRound(hash, v2);
+        hash = xxhMergeRound(hash, v3);
+        hash = xxhMergeRound(hash, v4);
+    } else {
+        hash = seed + XXH_PRIME_5;
+    }
+
+    hash += size;
+
+    while (bytes + 8 <= end) {
+        hash ^= xxhRound(0, read64(bytes));
+        hash = std::rotl(hash, 27) * XXH_PRIME_1 + XXH_PRIME_4;
+        bytes += 8;
+    }
+
+    if (bytes + 4 <= end) {
+        hash ^= static_cast<uint64_t>(read32(bytes)) * XXH_PRIME_1;
+        hash = std::rotl(hash, 23) * XXH_PRIME_2 + XXH_PRIME_3;
+        bytes += 4;
+    }
+
+    while (bytes < end) {
+        hash ^= (*bytes) * XXH_PRIME_5;
+        hash = std::rotl(hash, 11) * XXH_PRIME_1;
+        bytes++;
+    }
+
+    hash ^= hash >> 33;
+    hash *= XXH_PRIME_2;
+    hash ^= hash >> 29;
+    hash *= XXH_PRIME_3;
+    hash ^= hash >> 32;
+
+    return hash;
+}
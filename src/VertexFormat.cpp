@@ -0,0 +1,128 @@
+#include "VertexFormat.h"
+
+#include <algorithm>
+#include <bit>
+#include <cmath>
+#include <limits>
+#include <vector>
+
+#include <glm/gtc/packing.hpp>
+
+namespace VertexFormat {
+    glm::vec4 positionQuantization(std::span<const Vertex> vertices, std::span<const MorphDelta> morphDeltas) {
+        if (vertices.empty()) {
+            return {0.f, 0.f, 0.f, 1.f};
+        }
+
+        // furthest each vertex can move in either direction, every target pulling the same way at full weight
+        std::vector<glm::vec3> morphMin(morphDeltas.empty() ? 0 : vertices.size(), glm::vec3(0.f));
+        std::vector<glm::vec3> morphMax(morphMin.size(), glm::vec3(0.f));
+        for (const MorphDelta &delta: morphDeltas) {
+            glm::vec3 position = morphPosition(delta);
+            morphMin[delta.vertex] += glm::min(position, 0.f);
+            morphMax[delta.vertex] += glm::max(position, 0.f);
+        }
+
+        glm::vec3 boundsMin(std::numeric_limits<float>::max());
+        glm::vec3 boundsMax(std::numeric_limits<float>::lowest());
+        for (size_t vertex_i = 0; vertex_i < vertices.size(); vertex_i++) {
+            glm::vec3 position = vertices[vertex_i].position;
+            boundsMin = glm::min(boundsMin, morphMin.empty() ? position : position + morphMin[vertex_i]);
+            boundsMax = glm::max(boundsMax, morphMax.empty() ? position : position + morphMax[vertex_i]);
+        }
+
+        glm::vec3 extent = boundsMax - boundsMin;
+        float edge = std::max({extent.x, extent.y, extent.z});
+        return {boundsMin, edge > 0.f ? edge : 1.f};
+    }
+
+    // rounds every weight to 8 bits and gives the rounding error to the largest one, so they still sum to one
+    static uint32_t packWeights(glm::vec4 weights) {
+        glm::ivec4 quantized = glm::ivec4(glm::round(glm::clamp(weights, 0.f, 1.f) * 255.f));
+        int largest = 0;
+        for (int weight_i = 1; weight_i < 4; weight_i++) {
+            if (quantized[weight_i] > quantized[largest]) {
+                largest = weight_i;
+            }
+        }
+        int sum = quantized.x + quantized.y + quantized.z + quantized.w;
+        if (sum > 0) {
+            quantized[largest] = std::clamp(quantized[largest] + 255 - sum, 0, 255);
+        }
+        return static_cast<uint32_t>(quantized.x) | static_cast<uint32_t>(quantized.y) << 8 |
+               static_cast<uint32_t>(quantized.z) << 16 | static_cast<uint32_t>(quantized.w) << 24;
+    }
+
+    MorphDelta packMorphDelta(uint32_t vertex, uint32_t target, glm::vec3 position, glm::vec3 normal,
+                              glm::vec3 tangent) {
+        MorphDelta delta = {};
+        delta.vertex = vertex;
+        delta.target = target;
+        delta.positionX = std::bit_cast<uint32_t>(position.x);
+        delta.positionY = std::bit_cast<uint32_t>(position.y);
+        delta.positionZ = std::bit_cast<uint32_t>(position.z);
+        delta.normalXY = glm::packHalf2x16(glm::vec2(normal.x, normal.y));
+        delta.normalZTangentX = glm::packHalf2x16(glm::vec2(normal.z, tangent.x));
+        delta.tangentYZ = glm::packHalf2x16(glm::vec2(tangent.y, tangent.z));
+        return delta;
+    }
+
+    glm::vec3 morphPosition(const MorphDelta &delta) {
+        return {std::bit_cast<float>(delta.positionX), std::bit_cast<float>(delta.positionY),
+                std::bit_cast<float>(delta.positionZ)};
+    }
+
+    void packSkin(std::span<const Vertex> vertices, SkinVertex *out) {
+        for (size_t vertex_i = 0; vertex_i < vertices.size(); vertex_i++) {
+            const Vertex &vertex = vertices[vertex_i];
+            SkinVertex &skin = out[vertex_i];
+
+            glm::uvec4 joints = glm::uvec4(glm::clamp(vertex.jointIndices, 0.f, 65535.f));
+            skin.jointIndices01 = joints.x | joints.y << 16;
+            skin.jointIndices23 = joints.z | joints.w << 16;
+            skin.jointWeights = packWeights(vertex.jointWeights);
+        }
+    }
+
+#ifdef VKE_PACKED_VERTICES
+    // unit vector onto the octahedron, unfolded into [-1, 1]^2
+    static glm::vec2 octahedralEncode(glm::vec3 n) {
+        float sum = std::abs(n.x) + std::abs(n.y) + std::abs(n.z);
+        if (sum <= 0.f) {
+            return glm::vec2(0.f); // missing normal, decodes to +z
+        }
+        n /= sum;
+
+        if (n.z < 0.f) {
+            glm::vec2 folded = (1.f - glm::abs(glm::vec2(n.y, n.x)));
+            return {n.x >= 0.f ? folded.x : -folded.x, n.y >= 0.f ? folded.y : -folded.y};
+        }
+        return {n.x, n.y};
+    }
+
+    void pack(std::span<const Vertex> vertices, glm::vec4 positionQuantization, GpuVertex *out) {
+        glm::vec3 origin(positionQuantization);
+        float scale = 1.f / positionQuantization.w;
+
+        for (size_t vertex_i = 0; vertex_i < vertices.size(); vertex_i++) {
+            const Vertex &vertex = vertices[vertex_i];
+            PackedVertex &packed = out[vertex_i];
+
+            glm::vec3 position = glm::clamp((vertex.position - origin) * scale, 0.f, 1.f);
+            packed.positionXY = glm::packUnorm2x16(glm::vec2(position.x, position.y));
+            packed.positionZ = glm::packUnorm2x16(glm::vec2(position.z, 0.f));
+            if (vertex.tangent.w < 0.f) {
+                packed.positionZ |= PACKED_VERTEX_BITANGENT_SIGN_BIT;
+            }
+
+            packed.normal = glm::packSnorm2x16(octahedralEncode(vertex.normal));
+            packed.tangent = glm::packSnorm2x16(octahedralEncode(glm::vec3(vertex.tangent)));
+            packed.uv = glm::packHalf2x16(glm::vec2(vertex.uv_x, vertex.uv_y));
+        }
+    }
+#else
+    void pack(std::span<const Vertex> vertices, glm::vec4, GpuVertex *out) {
+        std::copy(vertices.begin(), vertices.end(), out);
+    }
+#endif
+}
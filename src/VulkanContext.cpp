@@ -19,6 +19,7 @@ void VulkanContext::init() {
     initSwapchain();
     initCommands();
     initSyncStructures();
+    uploadManager.init(this);
 }
 
 void VulkanContext::initWindow() {
@@ -62,17 +63,53 @@ void VulkanContext::initVulkanDevice() {
     features12.descriptorBindingSampledImageUpdateAfterBind = features.descriptorBindingSampledImageUpdateAfterBind ? VK_TRUE : VK_FALSE;
     features12.descriptorBindingPartiallyBound = features.descriptorBindingPartiallyBound ? VK_TRUE : VK_FALSE;
     features12.descriptorBindingVariableDescriptorCount = features.descriptorBindingVariableDescriptorCount ? VK_TRUE : VK_FALSE;
+    features12.timelineSemaphore = features.timelineSemaphore ? VK_TRUE : VK_FALSE;
+
+    features12.drawIndirectCount = features.drawIndirectCount ? VK_TRUE : VK_FALSE;
+
+    VkPhysicalDeviceFeatures features10{};
+    features10.drawIndirectFirstInstance = features.drawIndirectFirstInstance ? VK_TRUE : VK_FALSE;
 
     vkb::PhysicalDeviceSelector selector{instance};
     vkb::PhysicalDevice vkbPhysicalDevice = selector
             .set_minimum_version(1, 3)
+            .set_required_features(features10)
             .set_required_features_13(features13)
             .set_required_features_12(features12)
             .set_surface(surface)
             .select()
             .value();
 
+    // BC textures are optional, images are uploaded uncompressed without them
+    if (features.textureCompressionBC) {
+        VkPhysicalDeviceFeatures bcFeatures{};
+        bcFeatures.textureCompressionBC = VK_TRUE;
+        textureCompressionBCEnabled = vkbPhysicalDevice.enable_features_if_present(bcFeatures);
+    }
+
+    // mesh shaders are optional, only task and mesh stages are enabled
+    VkPhysicalDeviceMeshShaderFeaturesEXT meshShaderFeatures{};
+    meshShaderFeatures.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_MESH_SHADER_FEATURES_EXT;
+    if (features.meshShader && vkbPhysicalDevice.is_extension_present(VK_EXT_MESH_SHADER_EXTENSION_NAME)) {
+        VkPhysicalDeviceFeatures2 supportedFeatures{};
+        supportedFeatures.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2;
+        supportedFeatures.pNext = &meshShaderFeatures;
+        vkGetPhysicalDeviceFeatures2(vkbPhysicalDevice, &supportedFeatures);
+
+        meshShadersEnabled = meshShaderFeatures.taskShader && meshShaderFeatures.meshShader;
+        meshShaderFeatures = {};
+        meshShaderFeatures.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_MESH_SHADER_FEATURES_EXT;
+        meshShaderFeatures.taskShader = meshShadersEnabled ? VK_TRUE : VK_FALSE;
+        meshShaderFeatures.meshShader = meshShadersEnabled ? VK_TRUE : VK_FALSE;
+        if (meshShadersEnabled) {
+            vkbPhysicalDevice.enable_extension_if_present(VK_EXT_MESH_SHADER_EXTENSION_NAME);
+        }
+    }
+
     vkb::DeviceBuilder deviceBuilder{vkbPhysicalDevice};
+    if (meshShadersEnabled) {
+        deviceBuilder.add_pNext(&meshShaderFeatures);
+    }
     vkb::Device vkbDevice = deviceBuilder.build().value();
 
     physicalDevice = vkbPhysicalDevice;
@@ -88,6 +125,8 @@ void VulkanContext::initVulkanDevice() {
 void VulkanContext::terminate() {
     vkDeviceWaitIdle(device);
 
+    uploadManager.terminate();
+
     vkDestroyFence(device, m_immediateFence, nullptr);
     vkDestroyCommandPool(device, m_immediateCommandPool, nullptr);
 
@@ -103,6 +142,15 @@ void VulkanContext::terminate() {
 
     destroySwapchain();
 
+    if (!m_samplers.empty()) {
+        std::cerr << m_samplers.size() << " samplers still acquired at shutdown" << std::endl;
+    }
+    for (auto &[key, cached]: m_samplers) {
+        vkDestroySampler(device, cached.sampler, nullptr);
+    }
+    m_samplers.clear();
+    m_samplerKeys.clear();
+
     vmaDestroyAllocator(allocator);
     vkb::destroy_device(device);
 
@@ -254,14 +302,22 @@ VulkanImage VulkanContext::createImage(VkExtent3D extent,
                                        VkFormat format,
                                        VkImageUsageFlags usage,
                                        bool mipmapped) const {
+    uint32_t mipLevels = 1;
+    if (mipmapped) {
+        mipLevels = static_cast<uint32_t>(std::floor(std::log2(std::max(extent.width, extent.height)))) + 1;
+    }
+
+    return allocateImage(extent, format, usage, mipLevels);
+}
+
+VulkanImage VulkanContext::allocateImage(VkExtent3D extent, VkFormat format, VkImageUsageFlags usage,
+                                         uint32_t mipLevels) const {
     VulkanImage newImage = {};
     newImage.imageFormat = format;
     newImage.imageExtent = extent;
 
     VkImageCreateInfo imgInfo = VkInit::imageCreateInfo(format, usage, extent);
-    if (mipmapped) {
-        imgInfo.mipLevels = static_cast<uint32_t>(std::floor(std::log2(std::max(extent.width, extent.height)))) + 1;
-    }
+    imgInfo.mipLevels = mipLevels;
 
     VmaAllocationCreateInfo allocInfo = {};
     allocInfo.usage = VMA_MEMORY_USAGE_AUTO;
@@ -283,6 +339,26 @@ VulkanImage VulkanContext::createImage(VkExtent3D extent,
     return newImage;
 }
 
+VulkanImage VulkanContext::createImage(const TextureFile &texture, VkImageUsageFlags usage) {
+    VulkanImage newImage = allocateImage(texture.extent, texture.format, usage | VK_IMAGE_USAGE_TRANSFER_DST_BIT,
+                                         static_cast<uint32_t>(texture.levels.size()));
+
+    uploadManager.uploadImage(newImage, texture.data, texture.size, texture.levels);
+
+    return newImage;
+}
+
+bool VulkanContext::supportsSampledFormat(VkFormat format) const {
+    if (format >= VK_FORMAT_BC1_RGB_UNORM_BLOCK && format <= VK_FORMAT_BC7_SRGB_BLOCK && !textureCompressionBCEnabled) {
+        return false;
+    }
+
+    VkFormatProperties properties = {};
+    vkGetPhysicalDeviceFormatProperties(physicalDevice, format, &properties);
+
+    return (properties.optimalTilingFeatures & VK_FORMAT_FEATURE_SAMPLED_IMAGE_BIT) != 0;
+}
+
 void VulkanContext::destroyImage(const VulkanImage &img) const {
     vkDestroyImageView(device, img.imageView, nullptr);
     vmaDestroyImage(allocator, img.image, img.allocation);
@@ -319,7 +395,10 @@ void VulkanContext::immediateSubmit(std::function<void(VkCommandBuffer cmd)> &&f
 
     VkCommandBufferSubmitInfo cmdSubmitInfo = VkInit::commandBufferSubmitInfo(cmd);
     VkSubmitInfo2 submitInfo = VkInit::submitInfo(&cmdSubmitInfo, nullptr, nullptr);
-    VK_CHECK(vkQueueSubmit2(graphicsQueue, 1, &submitInfo, m_immediateFence))
+    {
+        std::lock_guard<std::mutex> queueLock(queueMutex);
+        VK_CHECK(vkQueueSubmit2(graphicsQueue, 1, &submitInfo, m_immediateFence))
+    }
 
     VK_CHECK(vkWaitForFences(device, 1, &m_immediateFence, true, 1e10))
 }
@@ -332,53 +411,66 @@ VkDeviceAddress VulkanContext::getBufferAddress(const VulkanBuffer &buffer) cons
     return vkGetBufferDeviceAddress(device, &deviceAddressInfo);
 }
 
+VkSampler VulkanContext::acquireSampler(const VkSamplerCreateInfo &samplerInfo) {
+    SamplerKey key = {
+        samplerInfo.flags,
+        samplerInfo.magFilter,
+        samplerInfo.minFilter,
+        samplerInfo.mipmapMode,
+        samplerInfo.addressModeU,
+        samplerInfo.addressModeV,
+        samplerInfo.addressModeW,
+        samplerInfo.mipLodBias,
+        samplerInfo.anisotropyEnable,
+        samplerInfo.maxAnisotropy,
+        samplerInfo.compareEnable,
+        samplerInfo.compareOp,
+        samplerInfo.minLod,
+        samplerInfo.maxLod,
+        samplerInfo.borderColor,
+        samplerInfo.unnormalizedCoordinates,
+    };
+
+    std::lock_guard lock(m_samplerMutex);
+    auto [it, inserted] = m_samplers.try_emplace(key);
+    if (inserted) {
+        VK_CHECK(vkCreateSampler(device, &samplerInfo, nullptr, &it->second.sampler))
+        m_samplerKeys.emplace(it->second.sampler, key);
+    }
+    it->second.refCount++;
+
+    return it->second.sampler;
+}
+
+void VulkanContext::releaseSampler(VkSampler sampler) {
+    if (sampler == VK_NULL_HANDLE) {
+        return;
+    }
+
+    std::lock_guard lock(m_samplerMutex);
+    auto keyIt = m_samplerKeys.find(sampler);
+    if (keyIt == m_samplerKeys.end()) {
+        std::cerr << "Releasing a sampler that was not acquired" << std::endl;
+        return;
+    }
+
+    auto it = m_samplers.find(keyIt->second);
+    if (--it->second.refCount == 0) {
+        vkDestroySampler(device, sampler, nullptr);
+        m_samplers.erase(it);
+        m_samplerKeys.erase(keyIt);
+    }
+}
+
 VulkanImage VulkanContext::createImage(const void *data, VkExtent3D extent, VkFormat format, VkImageUsageFlags usage,
-                                       bool mipmapped) const {
+                                       bool mipmapped) {
     size_t dataSize = extent.depth * extent.width * extent.height * 4; // 1 byte for each rgba channel
 
-    VulkanBuffer uploadBuffer = createBuffer(dataSize, VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
-                                             VMA_ALLOCATION_CREATE_MAPPED_BIT |
-                                             VMA_ALLOCATION_CREATE_HOST_ACCESS_SEQUENTIAL_WRITE_BIT);
-    memcpy(uploadBuffer.info.pMappedData, data, dataSize);
-
     VulkanImage newImage = createImage(extent, format,
                                        usage | VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT,
                                        mipmapped);
 
-    immediateSubmit([&](VkCommandBuffer cmd) {
-        VkUtil::transitionImage(cmd, newImage.image, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
-                                VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT,
-                                0,
-                                VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT,
-                                VK_ACCESS_2_MEMORY_WRITE_BIT | VK_ACCESS_2_MEMORY_READ_BIT);
-
-        VkBufferImageCopy copyRegion = {};
-        copyRegion.bufferOffset = 0;
-        copyRegion.bufferRowLength = 0;
-        copyRegion.bufferImageHeight = 0;
-
-        copyRegion.imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
-        copyRegion.imageSubresource.mipLevel = 0;
-        copyRegion.imageSubresource.baseArrayLayer = 0;
-        copyRegion.imageSubresource.layerCount = 1;
-        copyRegion.imageExtent = extent;
-
-        vkCmdCopyBufferToImage(cmd, uploadBuffer.buffer, newImage.image,
-                               VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &copyRegion);
-
-        if (mipmapped) {
-            VkUtil::generateMipmaps(cmd, newImage.image, {newImage.imageExtent.width, newImage.imageExtent.height});
-        } else {
-            VkUtil::transitionImage(cmd, newImage.image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
-                                    VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
-                                    VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT,
-                                    VK_ACCESS_2_MEMORY_WRITE_BIT | VK_ACCESS_2_MEMORY_READ_BIT,
-                                    VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT,
-                                    VK_ACCESS_2_MEMORY_WRITE_BIT | VK_ACCESS_2_MEMORY_READ_BIT);
-        }
-    });
-
-    destroyBuffer(uploadBuffer);
+    uploadManager.uploadImage(newImage, data, dataSize, mipmapped);
 
     return newImage;
 }
@@ -92,6 +92,40 @@ PipelineBuilder &PipelineBuilder::setShaders(VkShaderModule vertexShader, VkShad
     return *this;
 }
 
+PipelineBuilder &PipelineBuilder::setMeshShaders(VkShaderModule taskShader, VkShaderModule meshShader,
+                                                 VkShaderModule fragmentShader) {
+    m_shaderStages.clear();
+
+    if (taskShader) {
+        m_shaderStages.push_back(VkInit::pipelineShaderStageCreateInfo(VK_SHADER_STAGE_TASK_BIT_EXT, taskShader));
+    }
+
+    if (meshShader) {
+        m_shaderStages.push_back(VkInit::pipelineShaderStageCreateInfo(VK_SHADER_STAGE_MESH_BIT_EXT, meshShader));
+    } else {
+        std::cerr << "Missing mesh shader module\n";
+    }
+
+    if (fragmentShader) {
+        m_shaderStages.push_back(VkInit::pipelineShaderStageCreateInfo(VK_SHADER_STAGE_FRAGMENT_BIT, fragmentShader));
+    } else {
+        std::cerr << "Missing fragment shader module\n";
+    }
+
+    return *this;
+}
+
+PipelineBuilder &PipelineBuilder::setSpecialization(VkShaderStageFlags stages,
+                                                   const VkSpecializationInfo *specializationInfo) {
+    for (auto &shaderStage: m_shaderStages) {
+        if (shaderStage.stage & stages) {
+            shaderStage.pSpecializationInfo = specializationInfo;
+        }
+    }
+
+    return *this;
+}
+
 PipelineBuilder &PipelineBuilder::setInputTopology(VkPrimitiveTopology topology) {
     m_inputAssembly.topology = topology;
     m_inputAssembly.primitiveRestartEnable = VK_FALSE;
@@ -1,7 +1,14 @@
 #include <Renderer.h>
 
-int main() {
-    Renderer renderer;
+#include <cstdlib>
+
+// vke [model.gltf] [thread count], e.g. vke assets/models/Sponza/glTF/Sponza.gltf 1 to time a load on one thread
+int main(int argc, char **argv) {
+    const char *modelPath = argc > 1 ? argv[1] : "assets/models/helmet/DamagedHelmet.gltf";
+    uint32_t threadCount = argc > 2 ? static_cast<uint32_t>(std::strtoul(argv[2], nullptr, 10))
+                                    : std::thread::hardware_concurrency();
+
+    Renderer renderer(threadCount);
 
     //todo: implement proper lighting system
 
@@ -17,7 +24,7 @@ int main() {
 
 //    uint32_t id = renderer.loadGltf("assets/models/tests/MetalRoughSpheres.gltf");
 //    uint32_t id = renderer.loadGltf("assets/models/cesium_man/CesiumMan.gltf");
-    uint32_t id = renderer.loadGltf("assets/models/helmet/DamagedHelmet.gltf");
+    uint32_t id = renderer.loadGltfAsync(modelPath);
     renderer.addRenderObject({glm::mat4(1.f), id});
 
     renderer.run();